@@ -47,11 +47,20 @@
 #include <unistd.h>
 #include <errno.h>
 #include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include <time.h>
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#endif
 #include <ei.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
 #include <string>
 #include <list>
+#include <vector>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -220,6 +229,141 @@ namespace
     typedef callback_function_lookup lookup_t;
     typedef realloc_ptr<char> buffer_t;
 
+    // monotonic time in microseconds, extrapolated from the CPU timestamp
+    // counter when it runs at a constant rate (invariant TSC), so that the
+    // system clock is only read every resync_interval microseconds
+    class timestamp
+    {
+        public:
+            timestamp() :
+                m_tsc(rdtsc()),
+                m_time(system_us()),
+                m_latest(m_time)
+            {
+            }
+
+            uint64_t microseconds()
+            {
+                uint32_t const mult = tsc_mult();
+                if (mult == 0)
+                    return system_us();
+                uint64_t const tsc = rdtsc();
+                uint64_t const ticks = tsc - m_tsc;
+                // split the multiplication so it can not overflow
+                uint64_t elapsed = (ticks >> 32) * mult +
+                                   (((ticks & 0xffffffff) * mult) >> 32);
+                if (tsc < m_tsc || elapsed > resync_interval)
+                {
+                    m_tsc = tsc;
+                    m_time = system_us();
+                    elapsed = 0;
+                }
+                // calibration inaccuracy must not make the time go back
+                if (m_time + elapsed > m_latest)
+                    m_latest = m_time + elapsed;
+                return m_latest;
+            }
+
+        private:
+            enum
+            {
+                calibration_time = 2000, // microseconds
+                resync_interval = 100000 // microseconds
+            };
+
+            static uint64_t rdtsc()
+            {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+                uint32_t low, high;
+                __asm__ volatile ("rdtsc" : "=a" (low), "=d" (high));
+                return (static_cast<uint64_t>(high) << 32) | low;
+#else
+                return 0;
+#endif
+            }
+
+            static bool tsc_invariant()
+            {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+                // CPUID leaf 0x80000007, EDX bit 8 (Intel and AMD)
+                unsigned int eax, ebx, ecx, edx;
+                if (! __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+                    return false;
+                return (edx & (1 << 8)) != 0;
+#else
+                return false;
+#endif
+            }
+
+            static uint64_t system_us()
+            {
+#if defined(CLOCK_MONOTONIC)
+                struct timespec now;
+                ::clock_gettime(CLOCK_MONOTONIC, &now);
+                return static_cast<uint64_t>(now.tv_sec) * 1000000 +
+                       now.tv_nsec / 1000;
+#else
+                struct timeval now;
+                ::gettimeofday(&now, 0);
+                return static_cast<uint64_t>(now.tv_sec) * 1000000 +
+                       now.tv_usec;
+#endif
+            }
+
+            // read the TSC and the system clock as closely together
+            // as possible
+            static void sample(uint64_t & tsc, uint64_t & time)
+            {
+                uint64_t const before = rdtsc();
+                time = system_us();
+                tsc = before + (rdtsc() - before) / 2;
+            }
+
+            // microseconds per TSC tick, in units of 2^-32 microseconds,
+            // measured against the system clock once per process, the first
+            // time it is needed (0 if the TSC can not be used to measure time)
+            static uint32_t tsc_mult()
+            {
+                // 0 if not calibrated yet, 1 if the TSC can not be used
+                // (threads calibrating at the same time each store their
+                //  own result, any of which will do)
+                static uint32_t volatile rate = 0;
+                uint32_t mult = rate;
+                if (mult > 1)
+                    return mult;
+                if (mult == 1)
+                    return 0;
+                mult = tsc_calibrate();
+                rate = mult;
+                return mult == 1 ? 0 : mult;
+            }
+
+            // returns 1 if the TSC can not be used to measure time
+            static uint32_t tsc_calibrate()
+            {
+                if (! tsc_invariant())
+                    return 1;
+                uint64_t start_tsc, start_time, end_tsc, end_time;
+                sample(start_tsc, start_time);
+                do
+                {
+                    sample(end_tsc, end_time);
+                } while (end_time - start_time < calibration_time);
+                if (end_tsc <= start_tsc)
+                    return 1;
+                uint64_t const mult = ((end_time - start_time) << 32) /
+                                      (end_tsc - start_tsc);
+                // a TSC slower than 1MHz is of no use
+                if (mult <= 1 || mult > 0xffffffff)
+                    return 1;
+                return static_cast<uint32_t>(mult);
+            }
+
+            uint64_t m_tsc;
+            uint64_t m_time;
+            uint64_t m_latest;
+    };
+
     int errno_read()
     {
         switch (errno)
@@ -396,6 +540,71 @@ namespace
         return cloudi_success;
     }
 
+    // a warm OS process was started before the CloudI job needed it,
+    // so the sockets are requested from os_spawn on fd 3, received
+    // (one per message) and then moved to fds [3 .. 3 + thread_count - 1]
+    int warm_receive(unsigned int const thread_count)
+    {
+        char request = 'f';
+        ssize_t i;
+        while ((i = ::write(3, &request, 1)) == -1 && errno == EINTR);
+        if (i == -1)
+            return errno_write();
+        std::vector<int> fds;
+        for (size_t j = 0; j < thread_count; ++j)
+        {
+            char control[CMSG_SPACE(sizeof(int))];
+            char data;
+            struct iovec iov;
+            iov.iov_base = &data;
+            iov.iov_len = 1;
+            struct msghdr message;
+            ::memset(&message, 0, sizeof(message));
+            message.msg_iov = &iov;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            while ((i = ::recvmsg(3, &message, 0)) == -1 && errno == EINTR);
+            if (i == -1)
+                return errno_read();
+            else if (i == 0)
+                return cloudi_error_read_null;
+            struct cmsghdr * header = CMSG_FIRSTHDR(&message);
+            if (header == 0 ||
+                header->cmsg_level != SOL_SOCKET ||
+                header->cmsg_type != SCM_RIGHTS ||
+                header->cmsg_len != CMSG_LEN(sizeof(int)))
+                return cloudi_invalid_input;
+            int fd;
+            ::memcpy(&fd, CMSG_DATA(header), sizeof(int));
+            fds.push_back(fd);
+        }
+
+        // avoid the destination fds before using dup2
+        // (os_spawn keeps them open, unless the program closed them)
+        int const fd_min = 3 + thread_count;
+        for (size_t j = 0; j < thread_count; ++j)
+        {
+            if (fds[j] < fd_min)
+            {
+                int const fd = ::fcntl(fds[j], F_DUPFD, fd_min);
+                if (fd == -1)
+                    return cloudi_invalid_input;
+                ::close(fds[j]);
+                fds[j] = fd;
+            }
+        }
+        for (size_t j = 0; j < thread_count; ++j)
+        {
+            // fd 3 (the control socket) and the fds os_spawn kept open
+            // are closed by dup2
+            if (::dup2(fds[j], 3 + j) == -1)
+                return cloudi_invalid_input;
+            ::close(fds[j]);
+        }
+        return cloudi_success;
+    }
+
 } // anonymous namespace
 
 extern "C" {
@@ -431,6 +640,7 @@ int cloudi_initialize(cloudi_instance_t * p,
     p->buffer_recv_index = 0;
     p->buffer_call = new buffer_t(32768, CLOUDI_MAX_BUFFERSIZE);
     p->prefix = 0;
+    p->timestamp = new timestamp();
 
     ::atexit(&exit_handler);
 
@@ -463,6 +673,7 @@ void cloudi_destroy(cloudi_instance_t * p)
         delete reinterpret_cast<buffer_t *>(p->buffer_send);
         delete reinterpret_cast<buffer_t *>(p->buffer_recv);
         delete reinterpret_cast<buffer_t *>(p->buffer_call);
+        delete reinterpret_cast<timestamp *>(p->timestamp);
         if (p->prefix)
             delete p->prefix;
     }
@@ -477,6 +688,14 @@ int cloudi_initialize_thread_count(unsigned int * const thread_count)
     if (value < 0)
         return cloudi_invalid_input;
     *thread_count = static_cast<unsigned int>(value);
+    if (::getenv("CLOUDI_API_INIT_WARM"))
+    {
+        // block until the CloudI job uses this warm OS process
+        int const status = warm_receive(*thread_count);
+        if (status)
+            return status;
+        ::unsetenv("CLOUDI_API_INIT_WARM");
+    }
     return cloudi_success;
 }
 
@@ -1267,6 +1486,11 @@ int cloudi_poll(cloudi_instance_t * p,
     }
 }
 
+uint64_t cloudi_timestamp_us(cloudi_instance_t * p)
+{
+    return reinterpret_cast<timestamp *>(p->timestamp)->microseconds();
+}
+
 static char const ** binary_key_value_parse(void const * const binary,
                                             uint32_t const binary_size)
 {
@@ -1678,6 +1902,11 @@ int API::poll(int timeout) const
                        timeout);
 }
 
+uint64_t API::timestamp_us() const
+{
+    return cloudi_timestamp_us(m_api);
+}
+
 char const ** API::request_http_qs_parse(void const * const request,
                                          uint32_t const request_size) const
 {
@@ -73,6 +73,7 @@ typedef struct cloudi_instance_t
     uint32_t response_size;
     char * trans_id;          /* always 16 characters (128 bits) length */
     uint32_t trans_id_count;
+    void * timestamp;
 
 } cloudi_instance_t;
 
@@ -239,6 +240,11 @@ int cloudi_recv_async(cloudi_instance_t * p,
 int cloudi_poll(cloudi_instance_t * p,
                 int timeout);
 
+/* monotonic time in microseconds, for timing requests.
+ * cheap when the CPU has an invariant timestamp counter,
+ * otherwise the system clock is read */
+uint64_t cloudi_timestamp_us(cloudi_instance_t * p);
+
 char const ** cloudi_request_http_qs_parse(void const * const request,
                                            uint32_t const request_size);
 void cloudi_request_http_qs_destroy(char const ** p);
@@ -896,6 +896,8 @@ class API
 
         int poll(int timeout = -1) const;
 
+        uint64_t timestamp_us() const;
+
         char const ** request_http_qs_parse(void const * const request,
                                             uint32_t const request_size) const;
         void request_http_qs_destroy(char const ** p) const;
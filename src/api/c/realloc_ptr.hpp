@@ -153,6 +153,20 @@ public:
         return true;
     }
 
+    // release the memory that was reserved after the initial allocation
+    bool shrink()
+    {
+        if (m_size == m_initialSize)
+            return true;
+        T * tmp = reinterpret_cast<T *>(realloc(m_p,
+                                                m_initialSize * sizeof(T)));
+        if (! tmp)
+            return false;
+        m_p = tmp;
+        m_size = m_initialSize;
+        return true;
+    }
+
 private:
     // find a value >= totalSize as a power of 2
     size_t greater_pow2(size_t n)
@@ -161,7 +175,7 @@ private:
         int bits = 0;
         for (size_t div2 = totalSize; div2 > 1; div2 >>= 1)
             bits++;
-        size_t const value = (1 << bits);
+        size_t const value = (static_cast<size_t>(1) << bits);
         if (value == totalSize)
             return value;
         else
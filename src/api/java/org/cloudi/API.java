@@ -43,6 +43,7 @@ package org.cloudi;
 import java.io.FileDescriptor;
 import java.io.FileInputStream;
 import java.io.FileOutputStream;
+import java.io.DataInputStream;
 import java.io.ByteArrayOutputStream;
 import java.io.IOException;
 import java.io.PrintStream;
@@ -51,9 +52,17 @@ import java.util.List;
 import java.util.LinkedList;
 import java.util.ArrayList;
 import java.util.Arrays;
+import java.net.InetAddress;
+import java.net.InetSocketAddress;
+import java.net.Socket;
+import java.net.SocketImpl;
+import java.net.DatagramSocket;
+import java.net.DatagramSocketImpl;
+import java.net.DatagramPacket;
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
 import java.lang.reflect.Constructor;
+import java.lang.reflect.Method;
 import java.lang.reflect.InvocationTargetException;
 import java.lang.Math;
 import com.ericsson.otp.erlang.OtpExternal;
@@ -88,6 +97,11 @@ public class API
     private static final int MESSAGE_RETURNS_ASYNC   = 7;
     private static final int MESSAGE_KEEPALIVE       = 8;
 
+    // sockets connected by a warm OS process (the socket objects are kept
+    // so their file descriptors stay open)
+    private static FileDescriptor[] warm_sockets = null;
+    private static Object[] warm_sockets_open = null;
+
     private FileDescriptor socket;
     private boolean use_header;
     private FileOutputStream output;
@@ -118,7 +132,10 @@ public class API
             System.getenv("CLOUDI_API_INIT_BUFFER_SIZE");
         if (buffer_size_str == null)
             throw new InvalidInputException();
-        this.socket = API.storeFD(thread_index + 3);
+        if (API.warm_sockets != null)
+            this.socket = API.warm_sockets[thread_index];
+        else
+            this.socket = API.storeFD(thread_index + 3);
         assert this.socket != null : (thread_index + 3);
         this.use_header = (protocol.compareTo("tcp") == 0);
         this.output = new FileOutputStream(this.socket);
@@ -146,12 +163,21 @@ public class API
         poll();
     }
 
-    public static int thread_count() throws InvalidInputException
+    public static synchronized int thread_count()
+                                   throws InvalidInputException
     {
         final String s = System.getenv("CLOUDI_API_INIT_THREAD_COUNT");
         if (s == null)
             throw new InvalidInputException();
         final int thread_count = Integer.parseInt(s);
+        if (System.getenv("CLOUDI_API_INIT_WARM") != null &&
+            API.warm_sockets == null)
+        {
+            // block until the CloudI job uses this warm OS process
+            API.warm_sockets = API.warmConnect(thread_count);
+            if (API.warm_sockets == null)
+                throw new InvalidInputException();
+        }
         return thread_count;
     }
 
@@ -986,6 +1012,112 @@ public class API
         return object;
     }
 
+    // a warm OS process was started before the CloudI job needed it,
+    // so the ports are requested from os_spawn on fd 3 and the sockets
+    // are connected here (Java is unable to receive file descriptors)
+    private static FileDescriptor[] warmConnect(final int thread_count)
+    {
+        final FileDescriptor control = API.storeFD(3);
+        if (control == null)
+            return null;
+        final boolean tcp =
+            "tcp".equals(System.getenv("CLOUDI_API_INIT_PROTOCOL"));
+        FileOutputStream control_output = new FileOutputStream(control);
+        DataInputStream control_input =
+            new DataInputStream(new FileInputStream(control));
+        try
+        {
+            control_output.write('p');
+            final int ports_len = control_input.readInt();
+            if (ports_len != thread_count)
+                return null;
+            int[] ports = new int[ports_len];
+            for (int i = 0; i < ports_len; ++i)
+                ports[i] = control_input.readInt();
+            byte[] pid_message = new byte[control_input.readInt()];
+            control_input.readFully(pid_message);
+            control_output.close();
+
+            final InetAddress localhost = InetAddress.getByName("127.0.0.1");
+            FileDescriptor[] sockets = new FileDescriptor[thread_count];
+            Object[] sockets_open = new Object[thread_count];
+            for (int i = 0; i < thread_count; ++i)
+            {
+                if (tcp)
+                {
+                    Socket socket = new Socket();
+                    socket.setTcpNoDelay(true);
+                    socket.connect(new InetSocketAddress(localhost,
+                                                         ports[i]));
+                    // the first socket connection gets the pid message
+                    if (i == 0)
+                        socket.getOutputStream().write(pid_message);
+                    sockets_open[i] = socket;
+                    sockets[i] = API.socketFD(socket, Socket.class,
+                                              SocketImpl.class);
+                }
+                else
+                {
+                    DatagramSocket socket = new DatagramSocket();
+                    socket.connect(localhost, ports[i]);
+                    if (i == 0)
+                        socket.send(new DatagramPacket(pid_message,
+                                                       pid_message.length));
+                    sockets_open[i] = socket;
+                    sockets[i] = API.socketFD(socket, DatagramSocket.class,
+                                              DatagramSocketImpl.class);
+                }
+                if (sockets[i] == null)
+                    return null;
+            }
+            API.warm_sockets_open = sockets_open;
+            return sockets;
+        }
+        catch (IOException e)
+        {
+            e.printStackTrace(API.err);
+            return null;
+        }
+    }
+
+    // the file descriptor of a java.net socket, like storeFD,
+    // requires reflection
+    private static FileDescriptor socketFD(final Object socket,
+                                           final Class<?> socketClass,
+                                           final Class<?> implClass)
+    {
+        try
+        {
+            Method getImpl = socketClass.getDeclaredMethod("getImpl");
+            getImpl.setAccessible(true);
+            final Object impl = getImpl.invoke(socket);
+            Method getFileDescriptor =
+                implClass.getDeclaredMethod("getFileDescriptor");
+            getFileDescriptor.setAccessible(true);
+            return (FileDescriptor) getFileDescriptor.invoke(impl);
+        }
+        catch (SecurityException e)
+        {
+            e.printStackTrace(API.err);
+            return null;
+        }
+        catch (NoSuchMethodException e)
+        {
+            e.printStackTrace(API.err);
+            return null;
+        }
+        catch (IllegalAccessException e)
+        {
+            e.printStackTrace(API.err);
+            return null;
+        }
+        catch (InvocationTargetException e)
+        {
+            e.printStackTrace(API.err);
+            return null;
+        }
+    }
+
     public class Response
     {
         public final byte[] responseInfo;
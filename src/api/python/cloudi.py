@@ -42,7 +42,7 @@
 __all__ = ["API"]
 
 import sys, os, types, struct, socket, select, threading, inspect, \
-       collections, traceback
+       collections, traceback, fcntl
 from erlang import (binary_to_term, term_to_binary,
                     OtpErlangAtom, OtpErlangBinary)
 
@@ -86,7 +86,56 @@ class API(object):
         s = os.getenv('CLOUDI_API_INIT_THREAD_COUNT')
         if s is None:
             raise invalid_input_exception()
-        return int(s)
+        thread_count = int(s)
+        if os.getenv('CLOUDI_API_INIT_WARM') is not None:
+            # block until the CloudI job uses this warm OS process
+            API.__warm_receive(thread_count)
+            del os.environ['CLOUDI_API_INIT_WARM']
+        return thread_count
+
+    # a warm OS process was started before the CloudI job needed it,
+    # so the sockets are requested from os_spawn on fd 3, received
+    # (one per message) and then moved to fds [3 .. 3 + thread_count - 1]
+    @staticmethod
+    def __warm_receive(thread_count):
+        os.write(3, 'f'.encode('ascii'))
+        fds = [API.__warm_receive_fd(3) for i in range(thread_count)]
+        # avoid the destination fds before using dup2
+        # (os_spawn keeps them open, unless the program closed them)
+        fd_min = 3 + thread_count
+        for i in range(thread_count):
+            if fds[i] < fd_min:
+                fd = fcntl.fcntl(fds[i], fcntl.F_DUPFD, fd_min)
+                os.close(fds[i])
+                fds[i] = fd
+        for i in range(thread_count):
+            # fd 3 (the control socket) and the fds os_spawn kept open
+            # are closed by dup2
+            os.dup2(fds[i], 3 + i)
+            os.close(fds[i])
+
+    @staticmethod
+    def __warm_receive_fd(control_fd):
+        if not hasattr(socket.socket, 'recvmsg'):
+            # Python 2 has no recvmsg, but multiprocessing has the same
+            # SCM_RIGHTS receive (a single fd with a single byte)
+            import _multiprocessing
+            return _multiprocessing.recvfd(control_fd)
+        size = struct.calcsize('i')
+        control = socket.fromfd(control_fd, socket.AF_UNIX,
+                                socket.SOCK_STREAM)
+        try:
+            data, ancdata, flags, address = control.recvmsg(
+                1, socket.CMSG_SPACE(size))
+        finally:
+            control.close()
+        if len(data) == 0:
+            raise invalid_input_exception()
+        for level, kind, value in ancdata:
+            if (level == socket.SOL_SOCKET and
+                kind == socket.SCM_RIGHTS and len(value) == size):
+                return struct.unpack('i', value)[0]
+        raise invalid_input_exception()
 
     def subscribe(self, pattern, Function):
         args, varargs, varkw, defaults = inspect.getargspec(Function)
@@ -45,6 +45,8 @@ $stdout.sync = true
 $stderr.sync = true
 
 require 'erlang'
+require 'socket'
+require 'fcntl'
 
 module CloudI
     class API
@@ -68,8 +70,43 @@ module CloudI
 
         def self.thread_count
             s = getenv('CLOUDI_API_INIT_THREAD_COUNT')
-            s.to_i
+            thread_count = s.to_i
+            unless ENV['CLOUDI_API_INIT_WARM'].nil?
+                # block until the CloudI job uses this warm OS process
+                warm_receive(thread_count)
+                ENV.delete('CLOUDI_API_INIT_WARM')
+            end
+            thread_count
+        end
+
+        # a warm OS process was started before the CloudI job needed it,
+        # so the sockets are requested from os_spawn on fd 3, received
+        # (one per message) and then moved to fds [3 .. 3 + thread_count - 1]
+        def self.warm_receive(thread_count)
+            control = UNIXSocket.for_fd(3)
+            control.autoclose = false
+            control.syswrite('f')
+            fds = (0...thread_count).map { control.recv_io(nil) }
+            # avoid the destination fds before using dup2
+            # (os_spawn keeps them open, unless the program closed them)
+            fd_min = 3 + thread_count
+            fds.map! do |fd|
+                if fd < fd_min
+                    io = IO.for_fd(fd)
+                    fd = io.fcntl(Fcntl::F_DUPFD, fd_min)
+                    io.close
+                end
+                fd
+            end
+            fds.each_with_index do |fd, i|
+                # fd 3 (the control socket) and the fds os_spawn kept open
+                # are closed by dup2
+                io = IO.for_fd(fd)
+                IO.for_fd(3 + i, autoclose: false).reopen(io)
+                io.close
+            end
         end
+        private_class_method :warm_receive
 
         def subscribe(pattern, function)
             key = @prefix + pattern
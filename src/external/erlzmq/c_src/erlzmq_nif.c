@@ -30,28 +30,63 @@
 
 #define ERLZMQ_MAX_CONCURRENT_REQUESTS 16384
 
+// messages at least this large are not copied between Erlang and zeromq
+// (smaller messages are copied, since copying is cheaper than keeping a
+//  reference, and smaller binaries are not reference counted)
+#define ERLZMQ_ZERO_COPY_SIZE_MIN       1024
+
 static ErlNifResourceType* erlzmq_nif_resource_context;
 static ErlNifResourceType* erlzmq_nif_resource_socket;
+static ErlNifResourceType* erlzmq_nif_resource_msg;
 
-typedef struct erlzmq_context {
-  void * context_zmq;
+#define ERLZMQ_MAX_POLLING_THREADS 1024
+
+struct erlzmq_context;
+
+typedef struct erlzmq_polling_thread {
+  struct erlzmq_context * context;
   void * thread_socket;
   char * thread_socket_name;
-  int64_t socket_index;
   ErlNifTid polling_tid;
   ErlNifMutex * mutex;
+} erlzmq_polling_thread_t;
+
+typedef struct erlzmq_context {
+  void * context_zmq;
+  int64_t socket_index;
+  ErlNifMutex * mutex;
+  // polling threads that have not terminated (protected by the mutex)
+  int threads_active;
+  int threads_count;
+  // each socket is handled by one polling thread, based on the socket_index
+  erlzmq_polling_thread_t threads[];
 } erlzmq_context_t;
 
 #define ERLZMQ_SOCKET_ACTIVE_OFF        0
 #define ERLZMQ_SOCKET_ACTIVE_PENDING    1
 #define ERLZMQ_SOCKET_ACTIVE_ON         2
 
+// maximum number of frames an active socket sends in a single message
+#define ERLZMQ_MAX_ACTIVE_BATCH 1024
+
 typedef struct erlzmq_socket {
   erlzmq_context_t * context;
+  erlzmq_polling_thread_t * thread;
   int64_t socket_index;
   void * socket_zmq;
   int active;
+  // frames received per polling thread wakeup for an active socket
+  // (with more than 1, single-part messages are sent as a list of binaries)
+  int active_batch;
+  // the last frame received by an active socket had more frames following
+  int active_rcvmore;
   ErlNifMutex * mutex;
+  // index of the socket's pollitem in the polling thread (0 if none)
+  int64_t polling_index;
+  // requests queued to the polling thread (protected by the socket mutex),
+  // which must complete before a direct send/recv to preserve ordering
+  int send_pending;
+  int recv_pending;
 } erlzmq_socket_t;
 
 #define ERLZMQ_THREAD_REQUEST_SEND      1
@@ -91,6 +126,29 @@ typedef struct {
   } data;
 } erlzmq_thread_request_t;
 
+// a polling thread request slot, linked into a socket's pending queue
+// (or the free list when unused)
+typedef struct {
+  erlzmq_thread_request_t request;
+  int64_t next;
+} erlzmq_thread_slot_t;
+
+// the pending requests of a socket, as slot indexes (-1 if empty)
+typedef struct {
+  erlzmq_socket_t * socket;
+  int64_t recv_head;
+  int64_t recv_tail;
+  int64_t send_head;
+  int64_t send_tail;
+} erlzmq_thread_socket_t;
+
+typedef struct {
+  vector_t items_zmq;
+  vector_t sockets;
+  vector_t slots;
+  int64_t slots_free;
+} erlzmq_polling_t;
+
 // Prototypes
 #define NIF(name) \
   ERL_NIF_TERM name(ErlNifEnv* env, int argc, const ERL_NIF_TERM argv[])
@@ -108,12 +166,17 @@ NIF(erlzmq_nif_term);
 NIF(erlzmq_nif_version);
 
 static void * polling_thread(void * handle);
+static int polling_threads_term(erlzmq_context_t * context,
+                                ErlNifEnv* env, ERL_NIF_TERM ref);
 static ERL_NIF_TERM add_active_req(ErlNifEnv* env, erlzmq_socket_t * socket);
+static int msg_init_binary(ErlNifEnv* env, ERL_NIF_TERM term,
+                           ErlNifBinary * binary, zmq_msg_t * msg);
+static ERL_NIF_TERM msg_make_binary(ErlNifEnv* env, zmq_msg_t * msg);
 static ERL_NIF_TERM return_zmq_errno(ErlNifEnv* env, int const value);
 
 static ErlNifFunc nif_funcs[] =
 {
-  {"context", 1, erlzmq_nif_context},
+  {"context", 2, erlzmq_nif_context},
   {"socket", 3, erlzmq_nif_socket},
   {"bind", 2, erlzmq_nif_bind},
   {"connect", 2, erlzmq_nif_connect},
@@ -129,45 +192,79 @@ static ErlNifFunc nif_funcs[] =
 NIF(erlzmq_nif_context)
 {
   int thread_count;
+  int polling_thread_count;
 
   if (! enif_get_int(env, argv[0], &thread_count)) {
     return enif_make_badarg(env);
   }
 
+  if (! enif_get_int(env, argv[1], &polling_thread_count) ||
+      polling_thread_count < 1 ||
+      polling_thread_count > ERLZMQ_MAX_POLLING_THREADS) {
+    return enif_make_badarg(env);
+  }
+
   erlzmq_context_t * context = enif_alloc_resource(erlzmq_nif_resource_context,
-                                                   sizeof(erlzmq_context_t));
+    sizeof(erlzmq_context_t) +
+    polling_thread_count * sizeof(erlzmq_polling_thread_t));
   assert(context);
   context->context_zmq = zmq_init(thread_count);
   if (!context->context_zmq) {
     return return_zmq_errno(env, zmq_errno());
   }
 
-  char thread_socket_id[64];
-  sprintf(thread_socket_id, "inproc://erlzmq-%ld", (long int) context);
-  context->thread_socket = zmq_socket(context->context_zmq, ZMQ_PUSH);
-  assert(context->thread_socket);
   context->mutex = enif_mutex_create("erlzmq_context_t_mutex");
   assert(context->mutex);
-  if (zmq_bind(context->thread_socket, thread_socket_id)) {
-    zmq_close(context->thread_socket);
-    enif_mutex_destroy(context->mutex);
-    zmq_term(context->context_zmq);
-    enif_release_resource(context);
-    return return_zmq_errno(env, zmq_errno());
-  }
-  context->thread_socket_name = strdup(thread_socket_id);
-  assert(context->thread_socket_name);
   context->socket_index = 1;
+  context->threads_active = 0;
+  context->threads_count = 0;
 
-  int const value_errno = enif_thread_create("erlzmq_polling_thread",
-                                             &context->polling_tid,
-                                             polling_thread, context, NULL);
-  if (value_errno) {
-    free(context->thread_socket_name);
-    zmq_close(context->thread_socket);
-    zmq_term(context->context_zmq);
-    enif_release_resource(context);
-    return return_zmq_errno(env, value_errno);
+  int i;
+  for (i = 0; i < polling_thread_count; ++i) {
+    erlzmq_polling_thread_t * thread = &context->threads[i];
+    thread->context = context;
+
+    char thread_socket_id[64];
+    sprintf(thread_socket_id, "inproc://erlzmq-%ld-%d",
+            (long int) context, i);
+    thread->thread_socket = zmq_socket(context->context_zmq, ZMQ_PUSH);
+    assert(thread->thread_socket);
+    thread->mutex = enif_mutex_create("erlzmq_polling_thread_t_mutex");
+    assert(thread->mutex);
+    int value_errno = 0;
+    if (zmq_bind(thread->thread_socket, thread_socket_id)) {
+      value_errno = zmq_errno();
+    }
+    else {
+      thread->thread_socket_name = strdup(thread_socket_id);
+      assert(thread->thread_socket_name);
+      // the thread has a reference to the context
+      enif_keep_resource(context);
+      value_errno = enif_thread_create("erlzmq_polling_thread",
+                                       &thread->polling_tid,
+                                       polling_thread, thread, NULL);
+      if (value_errno) {
+        enif_release_resource(context);
+        free(thread->thread_socket_name);
+      }
+    }
+    if (value_errno) {
+      zmq_close(thread->thread_socket);
+      enif_mutex_destroy(thread->mutex);
+      if (i == 0) {
+        enif_mutex_destroy(context->mutex);
+        zmq_term(context->context_zmq);
+        enif_release_resource(context);
+      }
+      else {
+        // the polling threads already started terminate the context
+        polling_threads_term(context, NULL, 0);
+        enif_release_resource(context);
+      }
+      return return_zmq_errno(env, value_errno);
+    }
+    ++(context->threads_active);
+    ++(context->threads_count);
   }
 
   return enif_make_tuple2(env, enif_make_atom(env, "ok"),
@@ -189,7 +286,8 @@ NIF(erlzmq_nif_socket)
     return enif_make_badarg(env);
   }
 
-  if (! enif_get_int(env, argv[2], &active)) {
+  if (! enif_get_int(env, argv[2], &active) ||
+      active < 0 || active > ERLZMQ_MAX_ACTIVE_BATCH) {
     return enif_make_badarg(env);
   }
   
@@ -198,11 +296,19 @@ NIF(erlzmq_nif_socket)
   assert(socket);
   socket->context = context;
   socket->socket_index = context->socket_index++;
+  socket->thread = &context->threads[socket->socket_index %
+                                     context->threads_count];
   socket->socket_zmq = zmq_socket(context->context_zmq, socket_type);
   if (!socket->socket_zmq) {
     return return_zmq_errno(env, zmq_errno());
   }
-  socket->active = active;
+  socket->active = active ? ERLZMQ_SOCKET_ACTIVE_PENDING :
+                            ERLZMQ_SOCKET_ACTIVE_OFF;
+  socket->active_batch = active;
+  socket->active_rcvmore = 0;
+  socket->polling_index = 0;
+  socket->send_pending = 0;
+  socket->recv_pending = 0;
   socket->mutex = enif_mutex_create("erlzmq_socket_t_mutex");
   assert(socket->mutex);
 
@@ -343,8 +449,10 @@ NIF(erlzmq_nif_setsockopt)
     // int
     case ZMQ_LINGER:
     case ZMQ_RECONNECT_IVL:
+    case ZMQ_RECONNECT_IVL_MAX:
     case ZMQ_BACKLOG:
-      if (! enif_get_int(env, argv[1], &value_int)) {
+    case ZMQ_SWAP_DURABLE:
+      if (! enif_get_int(env, argv[2], &value_int)) {
         return enif_make_badarg(env);
       }
       option_value = &value_int;
@@ -436,6 +544,7 @@ NIF(erlzmq_nif_getsockopt)
     case ZMQ_RECONNECT_IVL:
     case ZMQ_RECONNECT_IVL_MAX:
     case ZMQ_BACKLOG:
+    case ZMQ_SWAP_DURABLE:
     case ZMQ_FD:   // FIXME: ZMQ_FD returns SOCKET on Windows
       enif_mutex_lock(socket->mutex);
       if (zmq_getsockopt(socket->socket_zmq, option_name,
@@ -470,31 +579,42 @@ NIF(erlzmq_nif_send)
     return enif_make_badarg(env);
   }
 
-  if (zmq_msg_init_size(&req.data.send.msg, binary.size)) {
+  if (msg_init_binary(env, argv[1], &binary, &req.data.send.msg)) {
     return return_zmq_errno(env, zmq_errno());
   }
 
-  memcpy(zmq_msg_data(&req.data.send.msg), binary.data, binary.size);
-
+  // try send with noblock, unless earlier sends are still queued
+  // (the polling thread uses an active socket without the socket mutex,
+  //  so an active socket only sends from the polling thread)
   int polling_thread_send = 1;
+  enif_mutex_lock(socket->mutex);
   if (! socket->active) {
-    enif_mutex_lock(socket->mutex);
-    if (zmq_send(socket->socket_zmq, &req.data.send.msg,
-                 req.data.send.flags | ZMQ_NOBLOCK)) {
-      enif_mutex_unlock(socket->mutex);
-      int const error = zmq_errno();
-      if (error != EAGAIN ||
-          (error == EAGAIN && (req.data.send.flags & ZMQ_NOBLOCK))) {
-        zmq_msg_close(&req.data.send.msg);
-        return return_zmq_errno(env, error);
+    if (socket->send_pending == 0) {
+      if (zmq_send(socket->socket_zmq, &req.data.send.msg,
+                   req.data.send.flags | ZMQ_NOBLOCK)) {
+        int const error = zmq_errno();
+        if (error != EAGAIN ||
+            (error == EAGAIN && (req.data.send.flags & ZMQ_NOBLOCK))) {
+          enif_mutex_unlock(socket->mutex);
+          zmq_msg_close(&req.data.send.msg);
+          return return_zmq_errno(env, error);
+        }
+      }
+      else {
+        polling_thread_send = 0;
       }
     }
-    else {
+    else if (req.data.send.flags & ZMQ_NOBLOCK) {
       enif_mutex_unlock(socket->mutex);
-      polling_thread_send = 0;
+      zmq_msg_close(&req.data.send.msg);
+      return return_zmq_errno(env, EAGAIN);
     }
   }
-  
+  if (polling_thread_send) {
+    ++(socket->send_pending);
+  }
+  enif_mutex_unlock(socket->mutex);
+
   if (polling_thread_send) {
     req.type = ERLZMQ_THREAD_REQUEST_SEND;
     req.data.send.env = enif_alloc_env();
@@ -504,28 +624,33 @@ NIF(erlzmq_nif_send)
 
     zmq_msg_t msg;
     if (zmq_msg_init_size(&msg, sizeof(erlzmq_thread_request_t))) {
+      int const error = zmq_errno();
+      enif_mutex_lock(socket->mutex);
+      --(socket->send_pending);
+      enif_mutex_unlock(socket->mutex);
       zmq_msg_close(&req.data.send.msg);
       enif_free_env(req.data.send.env);
-      return return_zmq_errno(env, zmq_errno());
+      return return_zmq_errno(env, error);
     }
 
     memcpy(zmq_msg_data(&msg), &req, sizeof(erlzmq_thread_request_t));
 
-    enif_mutex_lock(socket->context->mutex);
-    if (socket->context->thread_socket_name == NULL) {
-      enif_mutex_unlock(socket->context->mutex);
-      return return_zmq_errno(env, ETERM);
-    }
-    if (zmq_send(socket->context->thread_socket, &msg, 0)) {
-      enif_mutex_unlock(socket->context->mutex);
+    enif_mutex_lock(socket->thread->mutex);
+    int const error = socket->thread->thread_socket_name == NULL ? ETERM :
+      (zmq_send(socket->thread->thread_socket, &msg, 0) ? zmq_errno() : 0);
+    if (error) {
+      enif_mutex_unlock(socket->thread->mutex);
 
+      enif_mutex_lock(socket->mutex);
+      --(socket->send_pending);
+      enif_mutex_unlock(socket->mutex);
       zmq_msg_close(&msg);
       zmq_msg_close(&req.data.send.msg);
       enif_free_env(req.data.send.env);
-      return return_zmq_errno(env, zmq_errno());
+      return return_zmq_errno(env, error);
     }
     else {
-      enif_mutex_unlock(socket->context->mutex);
+      enif_mutex_unlock(socket->thread->mutex);
 
       zmq_msg_close(&msg);
       // each pointer to the socket in a request increments the reference
@@ -565,17 +690,22 @@ NIF(erlzmq_nif_recv)
     return return_zmq_errno(env, zmq_errno());
   }
 
-  // try recv with noblock
+  // try recv with noblock, unless earlier receives are still queued
   enif_mutex_lock(socket->mutex);
-  if (zmq_recv(socket->socket_zmq, &msg, ZMQ_NOBLOCK)) {
-    enif_mutex_unlock(socket->mutex);
-    zmq_msg_close(&msg);
-
-    int const error = zmq_errno();
+  if (socket->recv_pending > 0 ||
+      zmq_recv(socket->socket_zmq, &msg,
+               req.data.recv.flags | ZMQ_NOBLOCK)) {
+    int const error = socket->recv_pending > 0 ? EAGAIN : zmq_errno();
     if (error != EAGAIN ||
         (error == EAGAIN && (req.data.recv.flags & ZMQ_NOBLOCK))) {
+      enif_mutex_unlock(socket->mutex);
+      zmq_msg_close(&msg);
       return return_zmq_errno(env, error);
     }
+    ++(socket->recv_pending);
+    enif_mutex_unlock(socket->mutex);
+    zmq_msg_close(&msg);
+
     req.type = ERLZMQ_THREAD_REQUEST_RECV;
     req.data.recv.env = enif_alloc_env();
     req.data.recv.ref = enif_make_ref(req.data.recv.env);
@@ -583,26 +713,32 @@ NIF(erlzmq_nif_recv)
     req.data.recv.socket = socket;
 
     if (zmq_msg_init_size(&msg, sizeof(erlzmq_thread_request_t))) {
+      int const error = zmq_errno();
+      enif_mutex_lock(socket->mutex);
+      --(socket->recv_pending);
+      enif_mutex_unlock(socket->mutex);
       enif_free_env(req.data.recv.env);
-      return return_zmq_errno(env, zmq_errno());
+      return return_zmq_errno(env, error);
     }
 
     memcpy(zmq_msg_data(&msg), &req, sizeof(erlzmq_thread_request_t));
 
-    enif_mutex_lock(socket->context->mutex);
-    if (socket->context->thread_socket_name == NULL) {
-      enif_mutex_unlock(socket->context->mutex);
-      return return_zmq_errno(env, ETERM);
-    }
-    if (zmq_send(socket->context->thread_socket, &msg, 0)) {
-      enif_mutex_unlock(socket->context->mutex);
+    enif_mutex_lock(socket->thread->mutex);
+    int const error_thread = socket->thread->thread_socket_name == NULL ?
+      ETERM :
+      (zmq_send(socket->thread->thread_socket, &msg, 0) ? zmq_errno() : 0);
+    if (error_thread) {
+      enif_mutex_unlock(socket->thread->mutex);
 
+      enif_mutex_lock(socket->mutex);
+      --(socket->recv_pending);
+      enif_mutex_unlock(socket->mutex);
       zmq_msg_close(&msg);
       enif_free_env(req.data.recv.env);
-      return return_zmq_errno(env, zmq_errno());
+      return return_zmq_errno(env, error_thread);
     }
     else {
-      enif_mutex_unlock(socket->context->mutex);
+      enif_mutex_unlock(socket->thread->mutex);
 
       zmq_msg_close(&msg);
       // each pointer to the socket in a request increments the reference
@@ -614,14 +750,8 @@ NIF(erlzmq_nif_recv)
   else {
     enif_mutex_unlock(socket->mutex);
     
-    ErlNifBinary binary;
-    enif_alloc_binary(zmq_msg_size(&msg), &binary);
-    memcpy(binary.data, zmq_msg_data(&msg), zmq_msg_size(&msg));
-  
-    zmq_msg_close(&msg);
-  
     return enif_make_tuple2(env, enif_make_atom(env, "ok"),
-                            enif_make_binary(env, &binary));
+                            msg_make_binary(env, &msg));
   }
 }
 
@@ -649,8 +779,8 @@ NIF(erlzmq_nif_close)
 
   memcpy(zmq_msg_data(&msg), &req, sizeof(erlzmq_thread_request_t));
 
-  enif_mutex_lock(socket->context->mutex);
-  if (socket->context->thread_socket_name == NULL) {
+  enif_mutex_lock(socket->thread->mutex);
+  if (socket->thread->thread_socket_name == NULL) {
     // context is gone
     enif_mutex_lock(socket->mutex);
     zmq_msg_close(&msg);
@@ -658,17 +788,17 @@ NIF(erlzmq_nif_close)
     enif_mutex_unlock(socket->mutex);
     enif_mutex_destroy(socket->mutex);
     enif_release_resource(socket);
-    enif_mutex_unlock(socket->context->mutex);
+    enif_mutex_unlock(socket->thread->mutex);
     return enif_make_atom(env, "ok");
   }
-  if (zmq_send(socket->context->thread_socket, &msg, 0)) {
-    enif_mutex_unlock(socket->context->mutex);
+  if (zmq_send(socket->thread->thread_socket, &msg, 0)) {
+    enif_mutex_unlock(socket->thread->mutex);
     zmq_msg_close(&msg);
     enif_free_env(req.data.close.env);
     return return_zmq_errno(env, zmq_errno());
   }
   else {
-    enif_mutex_unlock(socket->context->mutex);
+    enif_mutex_unlock(socket->thread->mutex);
     zmq_msg_close(&msg);
     // each pointer to the socket in a request increments the reference
     enif_keep_resource(socket);
@@ -685,33 +815,15 @@ NIF(erlzmq_nif_term)
     return enif_make_badarg(env);
   }
 
-  erlzmq_thread_request_t req;
-  req.type = ERLZMQ_THREAD_REQUEST_TERM;
-  req.data.term.env = enif_alloc_env();
-  req.data.term.ref = enif_make_ref(req.data.term.env);
-  enif_self(env, &req.data.term.pid);
-
-  zmq_msg_t msg;
-  if (zmq_msg_init_size(&msg, sizeof(erlzmq_thread_request_t))) {
-    enif_free_env(req.data.term.env);
-    return return_zmq_errno(env, zmq_errno());
-  }
-
-  memcpy(zmq_msg_data(&msg), &req, sizeof(erlzmq_thread_request_t));
-
-  enif_mutex_lock(context->mutex);
-  if (zmq_send(context->thread_socket, &msg, 0)) {
-    enif_mutex_unlock(context->mutex);
-    zmq_msg_close(&msg);
-    enif_free_env(req.data.term.env);
-    return return_zmq_errno(env, zmq_errno());
+  ERL_NIF_TERM ref = enif_make_ref(env);
+  int const error = polling_threads_term(context, env, ref);
+  if (error) {
+    return return_zmq_errno(env, error);
   }
   else {
-    enif_mutex_unlock(context->mutex);
-    zmq_msg_close(&msg);
-    // thread has a reference to the context, decrement here
+    // threads have a reference to the context, decrement here
     enif_release_resource(context);
-    return enif_make_copy(env, req.data.term.ref);
+    return ref;
   }
 }
 
@@ -724,165 +836,399 @@ NIF(erlzmq_nif_version)
                           enif_make_int(env, patch));
 }
 
+static int64_t polling_slot_alloc(erlzmq_polling_t * polling,
+                                  erlzmq_thread_request_t * r)
+{
+  int64_t i;
+  erlzmq_thread_slot_t * slot;
+  if (polling->slots_free != -1) {
+    i = polling->slots_free;
+    slot = vector_get(erlzmq_thread_slot_t, &polling->slots, i);
+    polling->slots_free = slot->next;
+  }
+  else {
+    erlzmq_thread_slot_t slot_new;
+    int const status = vector_append(erlzmq_thread_slot_t, &polling->slots,
+                                     &slot_new);
+    assert(status == 0);
+    i = vector_count(&polling->slots) - 1;
+    slot = vector_get(erlzmq_thread_slot_t, &polling->slots, i);
+  }
+  memcpy(&slot->request, r, sizeof(erlzmq_thread_request_t));
+  slot->next = -1;
+  return i;
+}
+
+static void polling_slot_free(erlzmq_polling_t * polling, int64_t i)
+{
+  erlzmq_thread_slot_t * slot = vector_get(erlzmq_thread_slot_t,
+                                           &polling->slots, i);
+  slot->next = polling->slots_free;
+  polling->slots_free = i;
+}
+
+// get the index of the socket's pollitem, creating it if necessary
+static size_t polling_socket(erlzmq_polling_t * polling,
+                             erlzmq_socket_t * socket)
+{
+  if (socket->polling_index == 0) {
+    zmq_pollitem_t item_zmq = {socket->socket_zmq, 0, 0, 0};
+    int status = vector_append(zmq_pollitem_t, &polling->items_zmq,
+                               &item_zmq);
+    assert(status == 0);
+    erlzmq_thread_socket_t entry = {socket, -1, -1, -1, -1};
+    status = vector_append(erlzmq_thread_socket_t, &polling->sockets,
+                           &entry);
+    assert(status == 0);
+    socket->polling_index = vector_count(&polling->items_zmq) - 1;
+  }
+  return socket->polling_index;
+}
+
+// add a request to the end of one of the socket's pending queues
+static void polling_queue_push(erlzmq_polling_t * polling,
+                               int64_t * head, int64_t * tail, int64_t i)
+{
+  if (*tail == -1) {
+    *head = i;
+  }
+  else {
+    vector_get(erlzmq_thread_slot_t, &polling->slots, *tail)->next = i;
+  }
+  *tail = i;
+}
+
+// remove the request at the front of one of the socket's pending queues
+static void polling_queue_pop(erlzmq_polling_t * polling,
+                              int64_t * head, int64_t * tail)
+{
+  int64_t const i = *head;
+  *head = vector_get(erlzmq_thread_slot_t, &polling->slots, i)->next;
+  if (*head == -1) {
+    *tail = -1;
+  }
+  polling_slot_free(polling, i);
+}
+
+// update the events the socket's pollitem waits for, removing the
+// pollitem when no requests are pending (returns 1 if it was removed)
+static int polling_socket_update(erlzmq_polling_t * polling, size_t i)
+{
+  zmq_pollitem_t * item = vector_get(zmq_pollitem_t, &polling->items_zmq, i);
+  erlzmq_thread_socket_t * entry = vector_get(erlzmq_thread_socket_t,
+                                              &polling->sockets, i);
+  item->events = 0;
+  if (entry->recv_head != -1) {
+    item->events |= ZMQ_POLLIN;
+  }
+  if (entry->send_head != -1) {
+    item->events |= ZMQ_POLLOUT;
+  }
+  if (item->events) {
+    return 0;
+  }
+  entry->socket->polling_index = 0;
+  int status = vector_remove_swap(&polling->items_zmq, i);
+  assert(status == 0);
+  status = vector_remove_swap(&polling->sockets, i);
+  assert(status == 0);
+  if (i < vector_count(&polling->sockets)) {
+    vector_get(erlzmq_thread_socket_t,
+               &polling->sockets, i)->socket->polling_index = i;
+  }
+  return 1;
+}
+
+static ERL_NIF_TERM active_socket_term(ErlNifEnv* env,
+                                       erlzmq_socket_t * socket)
+{
+  return enif_make_tuple2(env,
+                          enif_make_uint64(env, socket->socket_index),
+                          enif_make_resource(env, socket));
+}
+
+// send the single-part messages received by an active socket as one message
+static void active_batch_send(erlzmq_socket_t * socket,
+                              erlzmq_thread_request_t * r,
+                              ERL_NIF_TERM * batch, unsigned int * batch_count)
+{
+  ErlNifEnv * env = r->data.recv.env;
+  if (*batch_count == 0) {
+    return;
+  }
+  enif_send(NULL, &r->data.recv.pid, env,
+    enif_make_tuple3(env,
+      enif_make_atom(env, "zmq"),
+      active_socket_term(env, socket),
+      enif_make_list_from_array(env, batch, *batch_count)));
+  enif_clear_env(env);
+  *batch_count = 0;
+}
+
+// receive up to active_batch frames for an active socket
+// (the active request always stays pending)
+static void polling_recv_active(erlzmq_socket_t * socket,
+                                erlzmq_thread_request_t * r)
+{
+  ErlNifEnv * env = r->data.recv.env;
+  ERL_NIF_TERM batch[ERLZMQ_MAX_ACTIVE_BATCH];
+  unsigned int batch_count = 0;
+  int frames;
+  for (frames = 0; frames < socket->active_batch; ++frames) {
+    size_t value_len = sizeof(int64_t);
+    int64_t flag_value = 0;
+
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    enif_mutex_lock(socket->mutex);
+    if (zmq_recv(socket->socket_zmq, &msg, ZMQ_NOBLOCK) ||
+        zmq_getsockopt(socket->socket_zmq,
+                       ZMQ_RCVMORE, &flag_value, &value_len)) {
+      int const error = zmq_errno();
+      enif_mutex_unlock(socket->mutex);
+      zmq_msg_close(&msg);
+      active_batch_send(socket, r, batch, &batch_count);
+      if (error != EAGAIN) {
+        enif_send(NULL, &r->data.recv.pid, env,
+          enif_make_tuple3(env,
+            enif_make_atom(env, "zmq"),
+            active_socket_term(env, socket),
+            return_zmq_errno(env, error)));
+        enif_clear_env(env);
+      }
+      return;
+    }
+    enif_mutex_unlock(socket->mutex);
+
+    ERL_NIF_TERM binary = msg_make_binary(env, &msg);
+
+    if (socket->active_batch > 1 &&
+        flag_value == 0 && ! socket->active_rcvmore) {
+      batch[batch_count++] = binary;
+    }
+    else {
+      // multipart messages keep the flags of each frame
+      ERL_NIF_TERM flags_list;
+
+      active_batch_send(socket, r, batch, &batch_count);
+
+      // Should we send the multipart flag
+      if(flag_value == 1) {
+        flags_list = enif_make_list1(env, enif_make_atom(env, "rcvmore"));
+      } else {
+        flags_list = enif_make_list(env, 0);
+      }
+
+      enif_send(NULL, &r->data.recv.pid, env,
+        enif_make_tuple4(env,
+          enif_make_atom(env, "zmq"),
+          active_socket_term(env, socket),
+          binary,
+          flags_list));
+      enif_clear_env(env);
+    }
+    socket->active_rcvmore = (flag_value == 1);
+  }
+  active_batch_send(socket, r, batch, &batch_count);
+}
+
+static void polling_recv(erlzmq_polling_t * polling, size_t i)
+{
+  erlzmq_thread_socket_t * entry = vector_get(erlzmq_thread_socket_t,
+                                              &polling->sockets, i);
+  erlzmq_socket_t * socket = entry->socket;
+  while (entry->recv_head != -1) {
+    erlzmq_thread_request_t * r =
+      &vector_get(erlzmq_thread_slot_t,
+                  &polling->slots, entry->recv_head)->request;
+    if (socket->active == ERLZMQ_SOCKET_ACTIVE_ON) {
+      polling_recv_active(socket, r);
+      return;
+    }
+
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    enif_mutex_lock(socket->mutex);
+    if (zmq_recv(socket->socket_zmq, &msg,
+                 r->data.recv.flags | ZMQ_NOBLOCK)) {
+      int const error = zmq_errno();
+      if (error != EAGAIN) {
+        --(socket->recv_pending);
+      }
+      enif_mutex_unlock(socket->mutex);
+      zmq_msg_close(&msg);
+      if (error == EAGAIN) {
+        return;
+      }
+      enif_send(NULL, &r->data.recv.pid, r->data.recv.env,
+        enif_make_tuple2(r->data.recv.env,
+          enif_make_copy(r->data.recv.env, r->data.recv.ref),
+          return_zmq_errno(r->data.recv.env, error)));
+      enif_free_env(r->data.recv.env);
+      enif_release_resource(socket);
+      polling_queue_pop(polling, &entry->recv_head, &entry->recv_tail);
+      continue;
+    }
+    --(socket->recv_pending);
+    enif_mutex_unlock(socket->mutex);
+
+    ERL_NIF_TERM binary = msg_make_binary(r->data.recv.env, &msg);
+
+    enif_send(NULL, &r->data.recv.pid, r->data.recv.env,
+      enif_make_tuple2(r->data.recv.env,
+        enif_make_copy(r->data.recv.env, r->data.recv.ref),
+        binary));
+
+    enif_free_env(r->data.recv.env);
+    enif_release_resource(socket);
+    polling_queue_pop(polling, &entry->recv_head, &entry->recv_tail);
+  }
+}
+
+static void polling_send(erlzmq_polling_t * polling, size_t i)
+{
+  erlzmq_thread_socket_t * entry = vector_get(erlzmq_thread_socket_t,
+                                              &polling->sockets, i);
+  erlzmq_socket_t * socket = entry->socket;
+  while (entry->send_head != -1) {
+    erlzmq_thread_request_t * r =
+      &vector_get(erlzmq_thread_slot_t,
+                  &polling->slots, entry->send_head)->request;
+
+    enif_mutex_lock(socket->mutex);
+    if (zmq_send(socket->socket_zmq, &r->data.send.msg,
+                 r->data.send.flags | ZMQ_NOBLOCK)) {
+      int const error = zmq_errno();
+      if (error == EAGAIN) {
+        enif_mutex_unlock(socket->mutex);
+        return;
+      }
+      --(socket->send_pending);
+      enif_mutex_unlock(socket->mutex);
+      enif_send(NULL, &r->data.send.pid, r->data.send.env,
+        enif_make_tuple2(r->data.send.env,
+          enif_make_copy(r->data.send.env, r->data.send.ref),
+          return_zmq_errno(r->data.send.env, error)));
+    } else {
+      --(socket->send_pending);
+      enif_mutex_unlock(socket->mutex);
+      enif_send(NULL, &r->data.send.pid, r->data.send.env,
+        enif_make_tuple2(r->data.send.env,
+          enif_make_copy(r->data.send.env, r->data.send.ref),
+          enif_make_atom(r->data.send.env, "ok")));
+    }
+    zmq_msg_close(&r->data.send.msg);
+    enif_free_env(r->data.send.env);
+    enif_release_resource(socket);
+    polling_queue_pop(polling, &entry->send_head, &entry->send_tail);
+  }
+}
+
+// free all the pending requests of a socket (before it is closed)
+static void polling_socket_clear(erlzmq_polling_t * polling, size_t i)
+{
+  erlzmq_thread_socket_t * entry = vector_get(erlzmq_thread_socket_t,
+                                              &polling->sockets, i);
+  while (entry->recv_head != -1) {
+    erlzmq_thread_request_t * r =
+      &vector_get(erlzmq_thread_slot_t,
+                  &polling->slots, entry->recv_head)->request;
+    assert(r->type == ERLZMQ_THREAD_REQUEST_RECV);
+    enif_clear_env(r->data.recv.env);
+    // FIXME
+    // causes crash on R14B01, works fine on R14B02
+    // (repeated enif_send with active receive broken on R14B01)
+    //enif_free_env(r->data.recv.env);
+    enif_release_resource(r->data.recv.socket);
+    polling_queue_pop(polling, &entry->recv_head, &entry->recv_tail);
+  }
+  while (entry->send_head != -1) {
+    erlzmq_thread_request_t * r =
+      &vector_get(erlzmq_thread_slot_t,
+                  &polling->slots, entry->send_head)->request;
+    assert(r->type == ERLZMQ_THREAD_REQUEST_SEND);
+    zmq_msg_close(&(r->data.send.msg));
+    enif_free_env(r->data.send.env);
+    enif_release_resource(r->data.send.socket);
+    polling_queue_pop(polling, &entry->send_head, &entry->send_tail);
+  }
+  int const removed = polling_socket_update(polling, i);
+  assert(removed);
+}
+
 static void * polling_thread(void * handle)
 {
-  erlzmq_context_t * context = (erlzmq_context_t *) handle;
-  enif_keep_resource(context);
+  erlzmq_polling_thread_t * thread = (erlzmq_polling_thread_t *) handle;
+  erlzmq_context_t * context = thread->context;
 
   void * thread_socket = zmq_socket(context->context_zmq, ZMQ_PULL);
   assert(thread_socket);
-  int status = zmq_connect(thread_socket, context->thread_socket_name);
+  int status = zmq_connect(thread_socket, thread->thread_socket_name);
   assert(status == 0);
 
-  vector_t items_zmq;
-  status = vector_initialize_pow2(zmq_pollitem_t, &items_zmq, 1,
+  // pollitems are stored with the pending requests for each socket
+  // (items_zmq and sockets are parallel, with index 0 used for the
+  //  thread socket) and the requests are stored in slots, with a free list
+  erlzmq_polling_t polling;
+  status = vector_initialize_pow2(zmq_pollitem_t, &polling.items_zmq, 1,
                                   ERLZMQ_MAX_CONCURRENT_REQUESTS);
   assert(status == 0);
   zmq_pollitem_t thread_socket_poll_zmq = {thread_socket, 0, ZMQ_POLLIN, 0};
-  status = vector_append(zmq_pollitem_t, &items_zmq, &thread_socket_poll_zmq);
+  status = vector_append(zmq_pollitem_t, &polling.items_zmq,
+                         &thread_socket_poll_zmq);
   assert(status == 0);
 
-  vector_t requests;
-  status = vector_initialize_pow2(erlzmq_thread_request_t, &requests, 1,
+  status = vector_initialize_pow2(erlzmq_thread_socket_t, &polling.sockets, 1,
                                   ERLZMQ_MAX_CONCURRENT_REQUESTS);
   assert(status == 0);
-  erlzmq_thread_request_t request_empty;
-  memset(&request_empty, 0, sizeof(erlzmq_thread_request_t));
-  status = vector_append(erlzmq_thread_request_t, &requests, &request_empty);
+  erlzmq_thread_socket_t socket_empty = {NULL, -1, -1, -1, -1};
+  status = vector_append(erlzmq_thread_socket_t, &polling.sockets,
+                         &socket_empty);
   assert(status == 0);
 
-  int i;
+  status = vector_initialize_pow2(erlzmq_thread_slot_t, &polling.slots, 1,
+                                  ERLZMQ_MAX_CONCURRENT_REQUESTS);
+  assert(status == 0);
+  polling.slots_free = -1;
+
+  size_t i;
   for (;;) {
-    int count = zmq_poll(vector_p(zmq_pollitem_t, &items_zmq),
-                         vector_count(&items_zmq), -1);
+    int count = zmq_poll(vector_p(zmq_pollitem_t, &polling.items_zmq),
+                         vector_count(&polling.items_zmq), -1);
     assert(count != -1);
-    if (vector_get(zmq_pollitem_t, &items_zmq, 0)->revents & ZMQ_POLLIN) {
+    if (vector_get(zmq_pollitem_t, &polling.items_zmq, 0)->revents &
+        ZMQ_POLLIN) {
       --count;
     }
-    for (i = 1; i < vector_count(&items_zmq); ++i) {
-      zmq_pollitem_t * item = vector_get(zmq_pollitem_t, &items_zmq, i);
-      erlzmq_thread_request_t * r = vector_get(erlzmq_thread_request_t,
-                                               &requests, i);
-      if (item->revents & ZMQ_POLLIN) {
-        size_t value_len = sizeof(int64_t);
-        int64_t flag_value = 0;
-        
-        assert(r->type == ERLZMQ_THREAD_REQUEST_RECV);
-        --count;
-
-        zmq_msg_t msg;
-        zmq_msg_init(&msg);
-        enif_mutex_lock(r->data.recv.socket->mutex);
-        if (zmq_recv(r->data.recv.socket->socket_zmq, &msg,
-                     r->data.recv.flags) ||
-            (r->data.recv.socket->active == ERLZMQ_SOCKET_ACTIVE_ON && 
-            zmq_getsockopt(r->data.recv.socket->socket_zmq, 
-                    ZMQ_RCVMORE, &flag_value, &value_len)) )
-        {
-          enif_mutex_unlock(r->data.recv.socket->mutex);
-          if (r->data.recv.socket->active == ERLZMQ_SOCKET_ACTIVE_ON) {
-            enif_send(NULL, &r->data.recv.pid, r->data.recv.env,
-              enif_make_tuple3(r->data.recv.env,
-                enif_make_atom(r->data.recv.env, "zmq"),
-                enif_make_tuple2(r->data.recv.env,
-                  enif_make_uint64(r->data.recv.env,
-                                   r->data.recv.socket->socket_index),
-                  enif_make_resource(r->data.recv.env, r->data.recv.socket)),
-                return_zmq_errno(r->data.recv.env, zmq_errno())));
-            enif_free_env(r->data.recv.env);
-            r->data.recv.env = enif_alloc_env();
-            item->revents = 0;
-          }
-          else {
-            assert(0);
-          }
-        }
-        else {
-          enif_mutex_unlock(r->data.recv.socket->mutex);
-        }
-
-        ErlNifBinary binary;
-        enif_alloc_binary(zmq_msg_size(&msg), &binary);
-        memcpy(binary.data, zmq_msg_data(&msg), zmq_msg_size(&msg));
-        zmq_msg_close(&msg);
-
-        if (r->data.recv.socket->active == ERLZMQ_SOCKET_ACTIVE_ON) {
-          ERL_NIF_TERM flags_list;
-          
-          // Should we send the multipart flag
-          if(flag_value == 1) {
-            flags_list = enif_make_list1(r->data.recv.env, enif_make_atom(r->data.recv.env, "rcvmore"));
-          } else {
-            flags_list = enif_make_list(r->data.recv.env, 0);
-          }
-          
-          enif_send(NULL, &r->data.recv.pid, r->data.recv.env,
-            enif_make_tuple4(r->data.recv.env,
-              enif_make_atom(r->data.recv.env, "zmq"),
-              enif_make_tuple2(r->data.recv.env,
-                enif_make_uint64(r->data.recv.env,
-                                 r->data.recv.socket->socket_index),
-                enif_make_resource(r->data.recv.env, r->data.recv.socket)),
-              enif_make_binary(r->data.recv.env, &binary),
-              flags_list));
-          enif_free_env(r->data.recv.env);
-          r->data.recv.env = enif_alloc_env();
-          item->revents = 0;
-        }
-        else {
-          enif_send(NULL, &r->data.recv.pid, r->data.recv.env,
-            enif_make_tuple2(r->data.recv.env,
-              enif_make_copy(r->data.recv.env, r->data.recv.ref),
-              enif_make_binary(r->data.recv.env, &binary)));
-
-          enif_free_env(r->data.recv.env);
-          enif_release_resource(r->data.recv.socket);
-
-          status = vector_remove(&items_zmq, i);
-          assert(status == 0);
-          status = vector_remove(&requests, i);
-          assert(status == 0);
-          --i;
-        }
+    for (i = 1; count > 0 && i < vector_count(&polling.items_zmq); ++i) {
+      zmq_pollitem_t * item = vector_get(zmq_pollitem_t,
+                                         &polling.items_zmq, i);
+      short const revents = item->revents;
+      if (revents == 0) {
+        continue;
       }
-      else if (item->revents & ZMQ_POLLOUT) {
-        assert(r->type == ERLZMQ_THREAD_REQUEST_SEND);
-        --count;
-
-        enif_mutex_lock(r->data.send.socket->mutex);
-        if (zmq_send(r->data.send.socket->socket_zmq,
-                     &r->data.send.msg, r->data.send.flags)) {
-          enif_mutex_unlock(r->data.send.socket->mutex);
-          enif_send(NULL, &r->data.send.pid, r->data.send.env,
-            enif_make_tuple2(r->data.send.env,
-              enif_make_copy(r->data.send.env, r->data.send.ref),
-              return_zmq_errno(r->data.send.env, zmq_errno())));
-        } else {
-          enif_mutex_unlock(r->data.send.socket->mutex);
-          enif_send(NULL, &r->data.send.pid, r->data.send.env,
-            enif_make_tuple2(r->data.send.env,
-              enif_make_copy(r->data.send.env, r->data.send.ref),
-              enif_make_atom(r->data.send.env, "ok")));
-        }
-        zmq_msg_close(&r->data.send.msg);
-        enif_free_env(r->data.send.env);
-        enif_release_resource(r->data.send.socket);
-
-        status = vector_remove(&items_zmq, i);
-        assert(status == 0);
-        status = vector_remove(&requests, i);
-        assert(status == 0);
+      item->revents = 0;
+      --count;
+      if (revents & ZMQ_POLLIN) {
+        polling_recv(&polling, i);
+      }
+      if (revents & ZMQ_POLLOUT) {
+        polling_send(&polling, i);
+      }
+      if (polling_socket_update(&polling, i)) {
+        // the last pollitem was moved to this index
         --i;
       }
     }
 
-    if (vector_get(zmq_pollitem_t, &items_zmq, 0)->revents & ZMQ_POLLIN) {
-      vector_get(zmq_pollitem_t, &items_zmq, 0)->revents = 0;
+    if (vector_get(zmq_pollitem_t, &polling.items_zmq, 0)->revents &
+        ZMQ_POLLIN) {
+      vector_get(zmq_pollitem_t, &polling.items_zmq, 0)->revents = 0;
       zmq_msg_t msg;
       zmq_msg_init(&msg);
-      enif_mutex_lock(context->mutex);
+      enif_mutex_lock(thread->mutex);
       status = zmq_recv(thread_socket, &msg, 0);
-      enif_mutex_unlock(context->mutex);
+      enif_mutex_unlock(thread->mutex);
       assert(status == 0);
 
       assert(zmq_msg_size(&msg) == sizeof(erlzmq_thread_request_t));
@@ -890,51 +1236,29 @@ static void * polling_thread(void * handle)
       erlzmq_thread_request_t * r =
         (erlzmq_thread_request_t *) zmq_msg_data(&msg);
       if (r->type == ERLZMQ_THREAD_REQUEST_SEND) {
-        zmq_pollitem_t item_zmq = {r->data.send.socket->socket_zmq,
-                                   0, ZMQ_POLLOUT, 0};
-        status = vector_append(zmq_pollitem_t, &items_zmq, &item_zmq);
-        assert(status == 0);
-        status = vector_append(erlzmq_thread_request_t, &requests, r);
-        assert(status == 0);
+        i = polling_socket(&polling, r->data.send.socket);
+        int64_t const slot = polling_slot_alloc(&polling, r);
+        erlzmq_thread_socket_t * entry =
+          vector_get(erlzmq_thread_socket_t, &polling.sockets, i);
+        polling_queue_push(&polling, &entry->send_head, &entry->send_tail,
+                           slot);
+        polling_socket_update(&polling, i);
         zmq_msg_close(&msg);
       }
       else if (r->type == ERLZMQ_THREAD_REQUEST_RECV) {
-        zmq_pollitem_t item_zmq = {r->data.recv.socket->socket_zmq,
-                                   0, ZMQ_POLLIN, 0};
-        status = vector_append(zmq_pollitem_t, &items_zmq, &item_zmq);
-        assert(status == 0);
-        status = vector_append(erlzmq_thread_request_t, &requests, r);
-        assert(status == 0);
+        i = polling_socket(&polling, r->data.recv.socket);
+        int64_t const slot = polling_slot_alloc(&polling, r);
+        erlzmq_thread_socket_t * entry =
+          vector_get(erlzmq_thread_socket_t, &polling.sockets, i);
+        polling_queue_push(&polling, &entry->recv_head, &entry->recv_tail,
+                           slot);
+        polling_socket_update(&polling, i);
         zmq_msg_close(&msg);
       }
       else if (r->type == ERLZMQ_THREAD_REQUEST_CLOSE) {
-        // remove all entries with this socket
-        for (i = vector_count(&items_zmq) - 1; i > 0; --i) {
-          zmq_pollitem_t * item = vector_get(zmq_pollitem_t, &items_zmq, i);
-          if (item->socket == r->data.close.socket->socket_zmq) {
-            erlzmq_thread_request_t * r_old =
-              vector_get(erlzmq_thread_request_t, &requests, i);
-            if (r_old->type == ERLZMQ_THREAD_REQUEST_RECV) {
-              enif_clear_env(r_old->data.recv.env);
-              // FIXME
-              // causes crash on R14B01, works fine on R14B02
-              // (repeated enif_send with active receive broken on R14B01)
-              //enif_free_env(r_old->data.recv.env);
-              enif_release_resource(r_old->data.recv.socket);
-            }
-            else if (r_old->type == ERLZMQ_THREAD_REQUEST_SEND) {
-              zmq_msg_close(&(r_old->data.send.msg));
-              enif_free_env(r_old->data.send.env);
-              enif_release_resource(r_old->data.send.socket);
-            }
-            else {
-              assert(0);
-            }
-            status = vector_remove(&items_zmq, i);
-            assert(status == 0);
-            status = vector_remove(&requests, i);
-            assert(status == 0);
-          }
+        // remove all pending requests with this socket
+        if (r->data.close.socket->polling_index != 0) {
+          polling_socket_clear(&polling, r->data.close.socket->polling_index);
         }
         // close the socket
         enif_mutex_lock(r->data.close.socket->mutex);
@@ -951,46 +1275,53 @@ static void * polling_thread(void * handle)
         zmq_msg_close(&msg);
       }
       else if (r->type == ERLZMQ_THREAD_REQUEST_TERM) {
-        enif_mutex_lock(context->mutex);
-        free(context->thread_socket_name);
+        enif_mutex_lock(thread->mutex);
+        free(thread->thread_socket_name);
         // use this to flag context is over
-        context->thread_socket_name = NULL;
-        enif_mutex_unlock(context->mutex);
+        thread->thread_socket_name = NULL;
+        enif_mutex_unlock(thread->mutex);
         // cleanup pending requests
-        for (i = 1; i < vector_count(&requests); ++i) {
-          erlzmq_thread_request_t * r_old = vector_get(erlzmq_thread_request_t,
-                                                       &requests, i);
-          if (r_old->type == ERLZMQ_THREAD_REQUEST_RECV) {
-            enif_free_env(r_old->data.recv.env);
-            enif_release_resource(r_old->data.recv.socket);
-            zmq_close(r_old->data.recv.socket->socket_zmq);
-          }
-          else if (r_old->type == ERLZMQ_THREAD_REQUEST_SEND) {
-            zmq_msg_close(&r_old->data.send.msg);
-            enif_free_env(r_old->data.send.env);
-            enif_release_resource(r_old->data.send.socket);
-            zmq_close(r_old->data.send.socket->socket_zmq);
-          }
+        while (vector_count(&polling.sockets) > 1) {
+          erlzmq_socket_t * socket =
+            vector_get(erlzmq_thread_socket_t, &polling.sockets,
+                       vector_count(&polling.sockets) - 1)->socket;
+          zmq_close(socket->socket_zmq);
+          polling_socket_clear(&polling, vector_count(&polling.sockets) - 1);
         }
-        // terminate the context
-        enif_mutex_lock(context->mutex);
+        enif_mutex_lock(thread->mutex);
         zmq_close(thread_socket);
-        zmq_close(context->thread_socket);
-        enif_mutex_unlock(context->mutex);
-        zmq_term(context->context_zmq);
+        zmq_close(thread->thread_socket);
+        enif_mutex_unlock(thread->mutex);
+        // the last polling thread terminates the context
         enif_mutex_lock(context->mutex);
+        int const last = (--(context->threads_active) == 0);
         enif_mutex_unlock(context->mutex);
-        enif_mutex_destroy(context->mutex);
+        if (last) {
+          zmq_term(context->context_zmq);
+          for (i = 0; i < (size_t) context->threads_count; ++i) {
+            enif_mutex_lock(context->threads[i].mutex);
+            enif_mutex_unlock(context->threads[i].mutex);
+            enif_mutex_destroy(context->threads[i].mutex);
+          }
+          enif_mutex_lock(context->mutex);
+          enif_mutex_unlock(context->mutex);
+          enif_mutex_destroy(context->mutex);
+          // notify the waiting request
+          if (r->data.term.env) {
+            enif_send(NULL, &r->data.term.pid, r->data.term.env,
+              enif_make_tuple2(r->data.term.env,
+                enif_make_copy(r->data.term.env, r->data.term.ref),
+                enif_make_atom(r->data.term.env, "ok")));
+          }
+        }
         enif_release_resource(context);
-        // notify the waiting request
-        enif_send(NULL, &r->data.term.pid, r->data.term.env,
-          enif_make_tuple2(r->data.term.env,
-            enif_make_copy(r->data.term.env, r->data.term.ref),
-            enif_make_atom(r->data.term.env, "ok")));
-        enif_free_env(r->data.term.env);
+        if (r->data.term.env) {
+          enif_free_env(r->data.term.env);
+        }
         zmq_msg_close(&msg);
-        vector_destroy(&items_zmq);
-        vector_destroy(&requests);
+        vector_destroy(&polling.items_zmq);
+        vector_destroy(&polling.sockets);
+        vector_destroy(&polling.slots);
         return NULL;
       }
       else {
@@ -1001,6 +1332,51 @@ static void * polling_thread(void * handle)
   return NULL;
 }
 
+// send a term request to each polling thread
+// (the last polling thread to terminate notifies the caller, if env is set)
+static int polling_threads_term(erlzmq_context_t * context,
+                                ErlNifEnv* env, ERL_NIF_TERM ref)
+{
+  int i;
+  for (i = 0; i < context->threads_count; ++i) {
+    erlzmq_polling_thread_t * thread = &context->threads[i];
+    erlzmq_thread_request_t req;
+    req.type = ERLZMQ_THREAD_REQUEST_TERM;
+    if (env) {
+      req.data.term.env = enif_alloc_env();
+      req.data.term.ref = enif_make_copy(req.data.term.env, ref);
+      enif_self(env, &req.data.term.pid);
+    }
+    else {
+      req.data.term.env = NULL;
+    }
+
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, sizeof(erlzmq_thread_request_t))) {
+      if (req.data.term.env) {
+        enif_free_env(req.data.term.env);
+      }
+      return zmq_errno();
+    }
+
+    memcpy(zmq_msg_data(&msg), &req, sizeof(erlzmq_thread_request_t));
+
+    enif_mutex_lock(thread->mutex);
+    if (zmq_send(thread->thread_socket, &msg, 0)) {
+      int const error = zmq_errno();
+      enif_mutex_unlock(thread->mutex);
+      zmq_msg_close(&msg);
+      if (req.data.term.env) {
+        enif_free_env(req.data.term.env);
+      }
+      return error;
+    }
+    enif_mutex_unlock(thread->mutex);
+    zmq_msg_close(&msg);
+  }
+  return 0;
+}
+
 static ERL_NIF_TERM add_active_req(ErlNifEnv* env, erlzmq_socket_t * socket)
 {
   socket->active = ERLZMQ_SOCKET_ACTIVE_ON;
@@ -1020,7 +1396,7 @@ static ERL_NIF_TERM add_active_req(ErlNifEnv* env, erlzmq_socket_t * socket)
 
   memcpy(zmq_msg_data(&msg), &req, sizeof(erlzmq_thread_request_t));
 
-  if (zmq_send(socket->context->thread_socket, &msg, 0)) {
+  if (zmq_send(socket->thread->thread_socket, &msg, 0)) {
     zmq_msg_close(&msg);
     enif_free_env(req.data.recv.env);
     return return_zmq_errno(env, zmq_errno());
@@ -1033,6 +1409,70 @@ static ERL_NIF_TERM add_active_req(ErlNifEnv* env, erlzmq_socket_t * socket)
   }
 }
 
+static void msg_free_binary(void * data, void * hint)
+{
+  // release the reference to the Erlang binary
+  enif_free_env((ErlNifEnv *) hint);
+}
+
+static int msg_init_binary(ErlNifEnv* env, ERL_NIF_TERM term,
+                           ErlNifBinary * binary, zmq_msg_t * msg)
+{
+  if (binary->size >= ERLZMQ_ZERO_COPY_SIZE_MIN &&
+      enif_is_binary(env, term)) {
+    // the binary is kept in a process independent environment
+    // until zeromq is done sending the message
+    ErlNifEnv * binary_env = enif_alloc_env();
+    ERL_NIF_TERM binary_term = enif_make_copy(binary_env, term);
+    if (! enif_inspect_binary(binary_env, binary_term, binary)) {
+      enif_free_env(binary_env);
+      errno = EINVAL;
+      return -1;
+    }
+    if (zmq_msg_init_data(msg, binary->data, binary->size,
+                          msg_free_binary, binary_env)) {
+      enif_free_env(binary_env);
+      return -1;
+    }
+    return 0;
+  }
+  if (zmq_msg_init_size(msg, binary->size)) {
+    return -1;
+  }
+  memcpy(zmq_msg_data(msg), binary->data, binary->size);
+  return 0;
+}
+
+static void msg_destructor(ErlNifEnv* env, void * resource)
+{
+  zmq_msg_close((zmq_msg_t *) resource);
+}
+
+static ERL_NIF_TERM msg_make_binary(ErlNifEnv* env, zmq_msg_t * msg)
+{
+  size_t const size = zmq_msg_size(msg);
+  if (size >= ERLZMQ_ZERO_COPY_SIZE_MIN) {
+    // the binary refers to the message data,
+    // which is closed when the binary is garbage collected
+    zmq_msg_t * resource = enif_alloc_resource(erlzmq_nif_resource_msg,
+                                               sizeof(zmq_msg_t));
+    assert(resource);
+    zmq_msg_init(resource);
+    zmq_msg_move(resource, msg);
+    zmq_msg_close(msg);
+    ERL_NIF_TERM binary = enif_make_resource_binary(env, resource,
+                                                    zmq_msg_data(resource),
+                                                    size);
+    enif_release_resource(resource);
+    return binary;
+  }
+  ErlNifBinary binary;
+  enif_alloc_binary(size, &binary);
+  memcpy(binary.data, zmq_msg_data(msg), size);
+  zmq_msg_close(msg);
+  return enif_make_binary(env, &binary);
+}
+
 static ERL_NIF_TERM return_zmq_errno(ErlNifEnv* env, int const value)
 {
   switch (value) {
@@ -1269,6 +1709,12 @@ static int on_load(ErlNifEnv* env, void** priv_data, ERL_NIF_TERM load_info)
                             NULL,
                             ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER,
                             0);
+  erlzmq_nif_resource_msg =
+    enif_open_resource_type(env, "erlzmq_nif",
+                            "erlzmq_nif_resource_msg",
+                            msg_destructor,
+                            ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER,
+                            0);
   return 0;
 }
 
@@ -149,6 +149,22 @@ int vector_remove(vector_t * v, size_t i)
     }
 }
 
+/* remove without preserving the order of elements
+ * (the last element is moved into the removed element's position)
+ */
+int vector_remove_swap(vector_t * v, size_t i)
+{
+    if (i >= v->count)
+        return VECTOR_FAILURE;
+    if ((i + 1) != v->count) {
+        memcpy(&(((char *) v->p)[i * v->element_size]),
+               &(((char *) v->p)[(v->count - 1) * v->element_size]),
+               v->element_size);
+    }
+    --(v->count);
+    return VECTOR_SUCCESS;
+}
+
 /* find a value >= totalSize as a power of 2
  */
 static size_t greater_pow2(size_t total_size)
@@ -75,6 +75,7 @@ int vector_move(vector_t * v, size_t i_dst, size_t i_src, size_t count_src);
     vector_append_element(V, OBJ, sizeof(TYPE))
 int vector_append_element(vector_t * v, void * p, size_t size);
 int vector_remove(vector_t * v, size_t i);
+int vector_remove_swap(vector_t * v, size_t i);
 #define vector_has(V, I)             ((I) < (V)->count)
 #define vector_p(TYPE, V)            ((TYPE *) ((V)->p))
 #define vector_get(TYPE, V, I)       (&(vector_p(TYPE, V)[I]))
@@ -51,6 +51,12 @@ context() ->
 
 %% @doc Create a new erlzmq context with the specified number of io threads.
 %% <br />
+%% Options may be provided instead of the number of io threads, as
+%% {io_threads, pos_integer()} (1 by default) and
+%% {polling_threads, pos_integer()} (1 by default).  The polling threads
+%% handle the blocking send/recv calls and the active sockets, with each
+%% socket of the context assigned to one polling thread.
+%% <br />
 %% If the context can be created an 'ok' tuple containing an
 %% {@type erlzmq_context()} handle to the created context is returned;
 %% if not, it returns an 'error' tuple with an {@type erlzmq_type_error()}
@@ -61,11 +67,19 @@ context() ->
 %% <i>For more information see
 %% <a href="http://api.zeromq.org/master:zmq-init">zmq_init</a></i>
 %% @end
--spec context(Threads :: pos_integer()) ->
+-spec context(Threads :: pos_integer() |
+                         list({io_threads, pos_integer()} |
+                              {polling_threads, pos_integer()})) ->
     {ok, erlzmq_context()} |
     erlzmq_error().
 context(Threads) when is_integer(Threads) ->
-    erlzmq_nif:context(Threads).
+    erlzmq_nif:context(Threads, 1);
+context(Options) when is_list(Options) ->
+    Threads = proplists:get_value(io_threads, Options, 1),
+    PollingThreads = proplists:get_value(polling_threads, Options, 1),
+    true = is_integer(Threads),
+    true = is_integer(PollingThreads) and (PollingThreads > 0),
+    erlzmq_nif:context(Threads, PollingThreads).
 
 
 %% @doc Create a socket.
@@ -83,13 +97,17 @@ context(Threads) when is_integer(Threads) ->
 %% throughput for small message sizes. Active sockets on the contrary give
 %% the highest throughput for messages above 32k. A benchmarking tool is
 %% included in the source distribution.<br />
+%% An active socket created with {active, N} (N > 1) receives up to N frames
+%% each time the socket becomes readable, and sends the single-part messages
+%% as {zmq, Socket, [Binary]} (frames of multipart messages are still sent as
+%% {zmq, Socket, Binary, Flags}).<br />
 %% <i>For more information see
 %% <a href="http://api.zeromq.org/master:zmq_socket">zmq_socket</a>.</i>
 %% @end
 -spec socket(Context :: erlzmq_context(),
              Type :: erlzmq_socket_type() |
                      list(erlzmq_socket_type() |
-                          {active, boolean()})) ->
+                          {active, boolean() | pos_integer()})) ->
                     {ok, erlzmq_socket()} |
                     erlzmq_error().
 socket(Context, Type) when is_atom(Type) ->
@@ -99,6 +117,10 @@ socket(Context, [H | _] = L) ->
         {value, {active, Active}, [Type]} when Active =:= true ->
             true = (Type =/= pub) and (Type =/= push) and (Type =/= xpub),
             erlzmq_nif:socket(Context, socket_type(Type), 1);
+        {value, {active, Active}, [Type]} when is_integer(Active),
+                                              Active > 0 ->
+            true = (Type =/= pub) and (Type =/= push) and (Type =/= xpub),
+            erlzmq_nif:socket(Context, socket_type(Type), Active);
         {value, {active, Active}, [Type]} when Active =:= false ->
             erlzmq_nif:socket(Context, socket_type(Type), 0);
         false when H =:= pub; H =:= push; H =:= xpub ->
@@ -382,5 +404,7 @@ option_name(backlog) ->
 option_name(recovery_ivl_msec) ->
     ?'ZMQ_RECOVERY_IVL_MSEC';
 option_name(reconnect_ivl_max) ->
-    ?'ZMQ_RECONNECT_IVL_MAX'.
+    ?'ZMQ_RECONNECT_IVL_MAX';
+option_name(swap_durable) ->
+    ?'ZMQ_SWAP_DURABLE'.
 
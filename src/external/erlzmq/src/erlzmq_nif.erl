@@ -1,7 +1,7 @@
 %% @hidden
 -module(erlzmq_nif).
 
--export([context/1,
+-export([context/2,
          socket/3,
          bind/2,
          connect/2,
@@ -34,7 +34,7 @@ init() ->
             end
     end.
 
-context(_Threads) ->
+context(_Threads, _PollingThreads) ->
     erlang:nif_error(not_loaded).
 
 socket(_Context, _Type, _Active) ->
@@ -55,12 +55,119 @@ reqrep_tcp_test() ->
     basic_tests("tcp://127.0.0.1:5556", req, rep, active),
     basic_tests("tcp://127.0.0.1:5557", req, rep, passive).
 
+large_message_inproc_test() ->
+    basic_tests("inproc://tester", pair, pair, active, large_message()),
+    basic_tests("inproc://tester", pair, pair, passive, large_message()).
+
+large_message_tcp_test() ->
+    basic_tests("tcp://127.0.0.1:5559", pair, pair, active, large_message()),
+    basic_tests("tcp://127.0.0.1:5560", pair, pair, passive, large_message()).
+
 bad_init_test() ->
     ?assertEqual({error, einval}, erlzmq:context(-1)).
 
+polling_threads_test() ->
+    {ok, C} = erlzmq:context([{polling_threads, 4}]),
+    Sockets = lists:map(fun(I) ->
+        Endpoint = "inproc://polling_threads" ++ integer_to_list(I),
+        {ok, S1} = erlzmq:socket(C, [pair, {active, true}]),
+        ok = erlzmq:bind(S1, Endpoint),
+        {ok, S2} = erlzmq:socket(C, [pair, {active, false}]),
+        ok = erlzmq:connect(S2, Endpoint),
+        {S1, S2}
+    end, lists:seq(1, 8)),
+    lists:foreach(fun({S1, S2}) ->
+        ok = erlzmq:send(S2, <<"message">>),
+        receive
+            {zmq, S1, <<"message">>, []} ->
+                ok
+        end,
+        ok = erlzmq:close(S1),
+        ok = erlzmq:close(S2)
+    end, Sockets),
+    ?assertEqual(ok, erlzmq:term(C)).
+
 shutdown_stress_test() ->
     ?assertMatch(ok, shutdown_stress_loop(10)).
 
+active_batch_test() ->
+    {ok, C} = erlzmq:context(),
+    {ok, S1} = erlzmq:socket(C, [pull, {active, 16}]),
+    ok = erlzmq:bind(S1, "inproc://active_batch"),
+    {ok, S2} = erlzmq:socket(C, [push, {active, false}]),
+    ok = erlzmq:connect(S2, "inproc://active_batch"),
+    Messages = [erlang:list_to_binary(integer_to_list(I))
+                || I <- lists:seq(1, 100)],
+    lists:foreach(fun(Msg) ->
+        ok = erlzmq:send(S2, Msg)
+    end, Messages),
+    ok = erlzmq:send(S2, <<"part1">>, [sndmore]),
+    ok = erlzmq:send(S2, <<"part2">>),
+    ?assertEqual(Messages, active_batch_recv(S1, [])),
+    receive
+        {zmq, S1, <<"part1">>, [rcvmore]} ->
+            ok
+    end,
+    receive
+        {zmq, S1, <<"part2">>, []} ->
+            ok
+    end,
+    ok = erlzmq:close(S1),
+    ok = erlzmq:close(S2),
+    ok = erlzmq:term(C).
+
+active_batch_recv(_, L) when length(L) == 100 ->
+    L;
+active_batch_recv(S, L) ->
+    receive
+        {zmq, S, Batch} when is_list(Batch) ->
+            true = length(Batch) =< 16,
+            active_batch_recv(S, L ++ Batch)
+    end.
+
+active_send_test() ->
+    {ok, C} = erlzmq:context(),
+    {ok, S1} = erlzmq:socket(C, [pair, {active, true}]),
+    ok = erlzmq:bind(S1, "tcp://127.0.0.1:5859"),
+    {ok, S2} = erlzmq:socket(C, [pair, {active, false}]),
+    ok = erlzmq:connect(S2, "tcp://127.0.0.1:5859"),
+    Messages = [erlang:list_to_binary(integer_to_list(I))
+                || I <- lists:seq(1, 1000)],
+    Self = self(),
+    % messages keep arriving on the active socket while it sends
+    Pid = erlang:spawn_link(fun() ->
+        lists:foreach(fun(Msg) ->
+            ok = erlzmq:send(S2, Msg)
+        end, Messages),
+        Self ! {sent, self(), [element(2, erlzmq:recv(S2))
+                               || _ <- Messages]}
+    end),
+    lists:foreach(fun(Msg) ->
+        ok = erlzmq:send(S1, Msg)
+    end, Messages),
+    ?assertEqual(Messages, active_send_recv(S1, Messages)),
+    receive
+        {sent, Pid, Received} ->
+            ?assertEqual(Messages, Received)
+    after
+        5000 ->
+            ?assertMatch({sent, Pid}, timeout)
+    end,
+    ok = erlzmq:close(S1),
+    ok = erlzmq:close(S2),
+    ok = erlzmq:term(C).
+
+active_send_recv(_, []) ->
+    [];
+active_send_recv(S, [Msg | Messages]) ->
+    receive
+        {zmq, S, Msg, []} ->
+            [Msg | active_send_recv(S, Messages)]
+    after
+        5000 ->
+            ?assertMatch({ok, Msg}, timeout)
+    end.
+
 version_test() ->
     {Major, Minor, Patch} = erlzmq:version(),
     ?assert(is_integer(Major) andalso is_integer(Minor) andalso is_integer(Patch)).
@@ -190,10 +297,16 @@ ping_pong({S1, S2}, Msg, passive) ->
     ok.
 
 basic_tests(Transport, Type1, Type2, Mode) ->
+    basic_tests(Transport, Type1, Type2, Mode, <<"XXX">>).
+
+basic_tests(Transport, Type1, Type2, Mode, Msg) ->
     {ok, C} = erlzmq:context(1),
     {S1, S2} = create_bound_pair(C, Type1, Type2, Mode, Transport),
-    ping_pong({S1, S2}, <<"XXX">>, Mode),
+    ping_pong({S1, S2}, Msg, Mode),
     ok = erlzmq:close(S1),
     ok = erlzmq:close(S2),
     ok = erlzmq:term(C).
 
+% large enough to avoid copying the message data
+large_message() ->
+    list_to_binary(lists:duplicate(65536, $X)).
@@ -211,6 +211,14 @@ ZMQ_EXPORT int zmq_term (void *context);
 #define ZMQ_BACKLOG 19
 #define ZMQ_RECOVERY_IVL_MSEC 20   /*  opt. recovery time, reconcile in 3.x   */
 #define ZMQ_RECONNECT_IVL_MAX 21
+#define ZMQ_SWAP_DURABLE 22
+#define ZMQ_BALANCE 23
+#define ZMQ_RCVWEIGHT 24
+
+/*  Load-balancing strategies for ZMQ_BALANCE.                                */
+#define ZMQ_BALANCE_ROUND_ROBIN 0
+#define ZMQ_BALANCE_LEAST_QUEUED 1
+#define ZMQ_BALANCE_TWO_CHOICES 2
     
 /*  Send/recv options.                                                        */
 #define ZMQ_NOBLOCK 1
@@ -258,6 +266,8 @@ ZMQ_EXPORT int zmq_poll (zmq_pollitem_t *items, int nitems, long timeout);
 #define ZMQ_QUEUE 3
 
 ZMQ_EXPORT int zmq_device (int device, void * insocket, void* outsocket);
+ZMQ_EXPORT int zmq_device_sharded (int device, void **insockets,
+    void **outsockets, int count);
 
 #undef ZMQ_EXPORT
 
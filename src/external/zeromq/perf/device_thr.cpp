@@ -0,0 +1,299 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../src/platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures the throughput of streamer devices. Each shard consists of
+//  a pusher, a streamer device and a puller, all of them connected via
+//  inproc. The devices of all the shards are run by zmq_device_sharded;
+//  the pushers and pullers run in threads of their own. With a shard count
+//  of 0, a single pusher sends directly to the puller, which gives the
+//  raw inproc rate to compare with.
+
+static void *ctx;
+static int message_count;
+static size_t message_size;
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall pusher (void *arg_)
+#else
+static void *pusher (void *arg_)
+#endif
+{
+    const char *endpoint = (const char*) arg_;
+    zmq_msg_t msg;
+
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    int rc = zmq_connect (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (int i = 0; i != message_count; i++) {
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_send (s, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        zmq_msg_close (&msg);
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    return NULL;
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall puller (void *arg_)
+#else
+static void *puller (void *arg_)
+#endif
+{
+    void *s = arg_;
+    zmq_msg_t msg;
+
+    zmq_msg_init (&msg);
+    for (int i = 0; i != message_count; i++) {
+        int rc = zmq_recv (s, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            exit (1);
+        }
+    }
+    zmq_msg_close (&msg);
+
+    return NULL;
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall devices (void *arg_)
+#else
+static void *devices (void *arg_)
+#endif
+{
+    std::vector <void*> *sockets = (std::vector <void*>*) arg_;
+    int count = (int) sockets->size () / 2;
+
+    //  Returns once the context is terminated.
+    zmq_device_sharded (ZMQ_STREAMER, &(*sockets) [0], &(*sockets) [count],
+        count);
+
+    for (int i = 0; i != count * 2; i++)
+        zmq_close ((*sockets) [i]);
+
+    return NULL;
+}
+
+static void *bind_socket (int type_, const char *endpoint_)
+{
+    void *s = zmq_socket (ctx, type_);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    int rc = zmq_bind (s, endpoint_);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    return s;
+}
+
+int main (int argc, char *argv [])
+{
+    int shard_count;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+    double megabits;
+
+    if (argc != 4) {
+        printf ("usage: device_thr <shard-count> <message-size> "
+            "<message-count>\n");
+        return 1;
+    }
+    shard_count = atoi (argv [1]);
+    message_size = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int lanes = shard_count ? shard_count : 1;
+    std::vector <void*> pullers (lanes);
+    std::vector <void*> device_sockets (shard_count * 2);
+    std::vector <char*> endpoints (lanes);
+
+    for (int i = 0; i != lanes; i++) {
+        char in [64];
+        char out [64];
+        sprintf (in, "inproc://device_thr_in_%d", i);
+        sprintf (out, "inproc://device_thr_out_%d", i);
+        endpoints [i] = strdup (in);
+        if (shard_count) {
+            device_sockets [i] = bind_socket (ZMQ_PULL, in);
+            device_sockets [shard_count + i] = bind_socket (ZMQ_PUSH, out);
+            pullers [i] = zmq_socket (ctx, ZMQ_PULL);
+            if (!pullers [i] || zmq_connect (pullers [i], out) != 0) {
+                printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+                return -1;
+            }
+        }
+        else
+            pullers [i] = bind_socket (ZMQ_PULL, in);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE device_thread = NULL;
+    if (shard_count)
+        device_thread = (HANDLE) _beginthreadex (NULL, 0, devices,
+            &device_sockets, 0 , NULL);
+    std::vector <HANDLE> threads;
+    for (int i = 0; i != lanes; i++) {
+        threads.push_back ((HANDLE) _beginthreadex (NULL, 0, pusher,
+            endpoints [i], 0 , NULL));
+        threads.push_back ((HANDLE) _beginthreadex (NULL, 0, puller,
+            pullers [i], 0 , NULL));
+    }
+#else
+    pthread_t device_thread;
+    int rc;
+    if (shard_count) {
+        rc = pthread_create (&device_thread, NULL, devices, &device_sockets);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+    std::vector <pthread_t> threads (lanes * 2);
+    for (int i = 0; i != lanes; i++) {
+        rc = pthread_create (&threads [i * 2], NULL, pusher, endpoints [i]);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+        rc = pthread_create (&threads [i * 2 + 1], NULL, puller,
+            pullers [i]);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+#endif
+
+    //  The clock runs while all the messages make their way through.
+    watch = zmq_stopwatch_start ();
+
+#if defined ZMQ_HAVE_WINDOWS
+    for (int i = 0; i != lanes * 2; i++) {
+        WaitForSingleObject (threads [i], INFINITE);
+        CloseHandle (threads [i]);
+    }
+#else
+    for (int i = 0; i != lanes * 2; i++) {
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+#endif
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    throughput = (unsigned long)
+        ((double) message_count * lanes / (double) elapsed * 1000000);
+    megabits = (double) (throughput * message_size * 8) / 1000000;
+
+    printf ("shard count: %d\n", shard_count);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", (int) message_count * lanes);
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
+
+    for (int i = 0; i != lanes; i++) {
+        zmq_close (pullers [i]);
+        free (endpoints [i]);
+    }
+
+    //  Terminating the context makes the devices return and close their
+    //  sockets, which in turn lets the termination finish.
+    int trc = zmq_term (ctx);
+    if (trc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    if (device_thread) {
+        WaitForSingleObject (device_thread, INFINITE);
+        CloseHandle (device_thread);
+    }
+#else
+    if (shard_count) {
+        rc = pthread_join (device_thread, NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../src/platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures the throughput of inproc fan-in: producer-count threads, each
+//  with a PUSH socket of its own, send message-count messages each to
+//  a single PULL socket.
+
+static void *ctx;
+static int message_count;
+static size_t message_size;
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall producer (void *arg_)
+#else
+static void *producer (void *arg_)
+#endif
+{
+    zmq_msg_t msg;
+
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    int rc = zmq_connect (s, "inproc://fanin_thr");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (int i = 0; i != message_count; i++) {
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_send (s, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        zmq_msg_close (&msg);
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    return NULL;
+}
+
+int main (int argc, char *argv [])
+{
+    int producer_count;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+    double megabits;
+    zmq_msg_t msg;
+    int rc;
+
+    if (argc != 4) {
+        printf ("usage: inproc_fanin_thr <producer-count> <message-size> "
+            "<message-count>\n");
+        return 1;
+    }
+    producer_count = atoi (argv [1]);
+    message_size = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, "inproc://fanin_thr");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    watch = zmq_stopwatch_start ();
+
+#if defined ZMQ_HAVE_WINDOWS
+    std::vector <HANDLE> threads (producer_count);
+    for (int i = 0; i != producer_count; i++)
+        threads [i] = (HANDLE) _beginthreadex (NULL, 0, producer, NULL,
+            0 , NULL);
+#else
+    std::vector <pthread_t> threads (producer_count);
+    for (int i = 0; i != producer_count; i++) {
+        rc = pthread_create (&threads [i], NULL, producer, NULL);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+#endif
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int total = producer_count * message_count;
+    for (int i = 0; i != total; i++) {
+        rc = zmq_recv (s, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    for (int i = 0; i != producer_count; i++) {
+#if defined ZMQ_HAVE_WINDOWS
+        WaitForSingleObject (threads [i], INFINITE);
+        CloseHandle (threads [i]);
+#else
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    throughput = (unsigned long)
+        ((double) total / (double) elapsed * 1000000);
+    megabits = (double) (throughput * message_size * 8) / 1000000;
+
+    printf ("producer count: %d\n", producer_count);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", total);
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures the throughput of a PUB socket fanning the messages out to
+//  subscribers that are each subscribed to a different topic. The messages
+//  are published to the topics in turn, so that each subscriber gets its
+//  share of them only.
+
+static void *ctx;
+static int subscriber_count;
+static int message_count;
+
+static void topic (char *buffer_, size_t size_, int i_)
+{
+    snprintf (buffer_, size_, "/cloudi/api/service%d/get", i_);
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *arg_)
+#else
+static void *worker (void *arg_)
+#endif
+{
+    int id = (int) (size_t) arg_;
+    void *s;
+    void *sync;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    char buffer [256];
+
+    s = zmq_socket (ctx, ZMQ_SUB);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    topic (buffer, sizeof (buffer), id);
+    rc = zmq_setsockopt (s, ZMQ_SUBSCRIBE, buffer, strlen (buffer));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, "inproc://pub_thr_test");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    //  Let the publisher know the subscriber is connected.
+    sync = zmq_socket (ctx, ZMQ_PUSH);
+    if (!sync) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_connect (sync, "inproc://pub_thr_sync");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_send (sync, &msg, 0);
+    if (rc != 0) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    //  Only the messages published to the subscriber's topic are received.
+    for (i = 0; i != message_count / subscriber_count; i++) {
+        rc = zmq_recv (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        if (zmq_msg_size (&msg) != strlen (buffer) ||
+              memcmp (zmq_msg_data (&msg), buffer, strlen (buffer)) != 0) {
+            printf ("unexpected message received\n");
+            exit (1);
+        }
+    }
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_close (sync);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE *threads;
+#else
+    pthread_t *threads;
+#endif
+    void *s;
+    void *sync;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+    char buffer [256];
+
+    if (argc != 3) {
+        printf ("usage: inproc_pub_thr <subscriber-count> "
+            "<message-count>\n");
+        return 1;
+    }
+
+    subscriber_count = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    if (subscriber_count < 1 || message_count < subscriber_count) {
+        printf ("subscriber-count must be >= 1, "
+            "message-count >= subscriber-count\n");
+        return 1;
+    }
+    message_count -= message_count % subscriber_count;
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    s = zmq_socket (ctx, ZMQ_PUB);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, "inproc://pub_thr_test");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    sync = zmq_socket (ctx, ZMQ_PULL);
+    if (!sync) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (sync, "inproc://pub_thr_sync");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    threads = (HANDLE*) malloc (subscriber_count * sizeof (HANDLE));
+#else
+    threads = (pthread_t*) malloc (subscriber_count * sizeof (pthread_t));
+#endif
+    if (!threads) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    for (i = 0; i != subscriber_count; i++) {
+#if defined ZMQ_HAVE_WINDOWS
+        threads [i] = (HANDLE) _beginthreadex (NULL, 0,
+            worker, (void*) (size_t) i, 0 , NULL);
+        if (threads [i] == 0) {
+            printf ("error in _beginthreadex\n");
+            return -1;
+        }
+#else
+        rc = pthread_create (&threads [i], NULL, worker, (void*) (size_t) i);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Wait for all the subscribers to connect. Give the subscriptions
+    //  a moment to get through as well.
+    for (i = 0; i != subscriber_count; i++) {
+        rc = zmq_recv (sync, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    zmq_sleep (1);
+
+    printf ("subscriber count: %d\n", (int) subscriber_count);
+    printf ("message count: %d\n", (int) message_count);
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != message_count; i++) {
+        topic (buffer, sizeof (buffer), i % subscriber_count);
+        size_t size = strlen (buffer);
+        rc = zmq_msg_init_size (&msg, size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        memcpy (zmq_msg_data (&msg), buffer, size);
+
+        rc = zmq_send (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    //  The test is done once all the subscribers got their messages.
+    for (i = 0; i != subscriber_count; i++) {
+#if defined ZMQ_HAVE_WINDOWS
+        DWORD rc2 = WaitForSingleObject (threads [i], INFINITE);
+        if (rc2 == WAIT_FAILED) {
+            printf ("error in WaitForSingleObject\n");
+            return -1;
+        }
+        BOOL rc3 = CloseHandle (threads [i]);
+        if (rc3 == 0) {
+            printf ("error in CloseHandle\n");
+            return -1;
+        }
+#else
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    free (threads);
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (sync);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    throughput = (unsigned long)
+        ((double) message_count / (double) elapsed * 1000000);
+
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+
+    return 0;
+}
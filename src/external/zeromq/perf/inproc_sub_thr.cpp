@@ -0,0 +1,266 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures the subscription filtering throughput of a SUB socket with
+//  many subscriptions that share long prefixes (like CloudI service names).
+//  Every other message published doesn't match any subscription.
+
+static int subscription_count;
+static int message_count;
+
+static const char *areas [] = {"db", "http", "queue", "tests", "zeromq"};
+
+static void topic (char *buffer_, size_t size_, int i_, bool match_)
+{
+    snprintf (buffer_, size_, "/cloudi/api/%s/%s%d/%s",
+        areas [i_ % 5], match_ ? "service" : "servicf",
+        i_ % subscription_count, match_ ? "get" : "put");
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    char buffer [256];
+
+    s = zmq_socket (ctx_, ZMQ_PUB);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, "inproc://sub_thr_test");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != message_count; i++) {
+
+        topic (buffer, sizeof (buffer), i / 2, i % 2 == 0);
+        size_t size = strlen (buffer);
+        rc = zmq_msg_init_size (&msg, size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        memcpy (zmq_msg_data (&msg), buffer, size);
+
+        rc = zmq_send (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_msg_close (&msg);
+        if (rc != 0) {
+            printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    void *ctx;
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+    char buffer [256];
+
+    if (argc != 3) {
+        printf ("usage: inproc_sub_thr <subscription-count> "
+            "<message-count>\n");
+        return 1;
+    }
+
+    subscription_count = atoi (argv [1]);
+    message_count = atoi (argv [2]) & ~1;
+    if (subscription_count < 1 || message_count < 4) {
+        printf ("subscription-count must be >= 1, message-count >= 4\n");
+        return 1;
+    }
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    s = zmq_socket (ctx, ZMQ_SUB);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    for (i = 0; i != subscription_count; i++) {
+        snprintf (buffer, sizeof (buffer), "/cloudi/api/%s/service%d/",
+            areas [i % 5], i);
+        rc = zmq_setsockopt (s, ZMQ_SUBSCRIBE, buffer, strlen (buffer));
+        if (rc != 0) {
+            printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    rc = zmq_bind (s, "inproc://sub_thr_test");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, ctx, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    printf ("subscription count: %d\n", (int) subscription_count);
+    printf ("message count: %d\n", (int) message_count);
+
+    rc = zmq_recv (s, &msg, 0);
+    if (rc < 0) {
+        printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    watch = zmq_stopwatch_start ();
+
+    //  Only the matching half of the messages is received.
+    for (i = 0; i != message_count / 2 - 1; i++) {
+        rc = zmq_recv (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        topic (buffer, sizeof (buffer), i + 1, true);
+        if (zmq_msg_size (&msg) != strlen (buffer) ||
+              memcmp (zmq_msg_data (&msg), buffer, strlen (buffer)) != 0) {
+            printf ("unexpected message received\n");
+            return -1;
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Both matching and non-matching messages are filtered.
+    throughput = (unsigned long)
+        ((double) (message_count - 2) / (double) elapsed * 1000000);
+
+    printf ("mean filtering throughput: %d [msg/s]\n", (int) throughput);
+
+    return 0;
+}
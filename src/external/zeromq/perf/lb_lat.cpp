@@ -0,0 +1,326 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "../src/platform.hpp"
+#include "../src/stdint.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+//  Shows how the load-balancing strategy of a PUSH socket copes with a slow
+//  consumer. The PUSH socket sends message-count messages, one every
+//  interval microseconds, to consumer-count PULL sockets over inproc. One
+//  of the consumers sleeps for delay microseconds after each message. Each
+//  message carries the time it was sent at; the consumers record how long
+//  it took to arrive. The latency percentiles and the share of messages
+//  each consumer got are printed at the end.
+
+static void *ctx;
+static int delay;
+static int interval;
+
+struct consumer_t
+{
+    int index;
+    std::vector <uint64_t> latencies;
+};
+
+static uint64_t now_us ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    LARGE_INTEGER ticks_per_second;
+    QueryPerformanceFrequency (&ticks_per_second);
+    LARGE_INTEGER tick;
+    QueryPerformanceCounter (&tick);
+    return (uint64_t) (tick.QuadPart * 1000000 / ticks_per_second.QuadPart);
+#else
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static void sleep_us (int us_)
+{
+    //  Sleeping rather than spinning leaves the CPU to the other threads,
+    //  so that the test gives sensible results on few cores.
+#if defined ZMQ_HAVE_WINDOWS
+    Sleep (us_ / 1000);
+#else
+    usleep (us_);
+#endif
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall consumer (void *arg_)
+#else
+static void *consumer (void *arg_)
+#endif
+{
+    consumer_t *self = (consumer_t*) arg_;
+    zmq_msg_t msg;
+    int rc;
+
+    void *data = zmq_socket (ctx, ZMQ_PULL);
+    if (!data) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    //  An inproc pipe only has a high watermark if both ends set one.
+    uint64_t hwm = 1;
+    rc = zmq_setsockopt (data, ZMQ_HWM, &hwm, sizeof (hwm));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_connect (data, "inproc://lb_lat");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    //  The control socket tells the consumer that all the messages were
+    //  sent.
+    void *control = zmq_socket (ctx, ZMQ_SUB);
+    if (!control) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_setsockopt (control, ZMQ_SUBSCRIBE, "", 0);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_connect (control, "inproc://lb_lat_control");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    zmq_pollitem_t items [2];
+    items [0].socket = data;
+    items [0].events = ZMQ_POLLIN;
+    items [1].socket = control;
+    items [1].events = ZMQ_POLLIN;
+
+    zmq_msg_init (&msg);
+    bool done = false;
+    while (true) {
+
+        //  Once the producer is done, drain what's left without waiting.
+        if (!done) {
+            rc = zmq_poll (items, 2, -1);
+            if (rc < 0) {
+                printf ("error in zmq_poll: %s\n", zmq_strerror (errno));
+                exit (1);
+            }
+            done = items [1].revents & ZMQ_POLLIN;
+        }
+
+        rc = zmq_recv (data, &msg, ZMQ_NOBLOCK);
+        if (rc != 0) {
+            if (errno != EAGAIN) {
+                printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+                exit (1);
+            }
+            if (done)
+                break;
+            continue;
+        }
+
+        uint64_t sent;
+        memcpy (&sent, zmq_msg_data (&msg), sizeof (sent));
+        self->latencies.push_back (now_us () - sent);
+        if (self->index == 0)
+            sleep_us (delay);
+    }
+    zmq_msg_close (&msg);
+
+    zmq_close (data);
+    zmq_close (control);
+
+    return NULL;
+}
+
+int main (int argc, char *argv [])
+{
+    int balance;
+    int consumer_count;
+    int message_count;
+    uint64_t hwm;
+    int rc;
+
+    if (argc != 7) {
+        printf ("usage: lb_lat <balance> <consumer-count> <message-count> "
+            "<hwm> <delay-us> <interval-us>\n");
+        printf ("balance: 0 round robin, 1 least queued, 2 two choices\n");
+        return 1;
+    }
+    balance = atoi (argv [1]);
+    consumer_count = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+    hwm = atoi (argv [4]);
+    delay = atoi (argv [5]);
+    interval = atoi (argv [6]);
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_setsockopt (s, ZMQ_BALANCE, &balance, sizeof (balance));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_setsockopt (s, ZMQ_HWM, &hwm, sizeof (hwm));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_bind (s, "inproc://lb_lat");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *control = zmq_socket (ctx, ZMQ_PUB);
+    if (!control) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    rc = zmq_bind (control, "inproc://lb_lat_control");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    std::vector <consumer_t> consumers (consumer_count);
+#if defined ZMQ_HAVE_WINDOWS
+    std::vector <HANDLE> threads (consumer_count);
+#else
+    std::vector <pthread_t> threads (consumer_count);
+#endif
+    for (int i = 0; i != consumer_count; i++) {
+        consumers [i].index = i;
+#if defined ZMQ_HAVE_WINDOWS
+        threads [i] = (HANDLE) _beginthreadex (NULL, 0, consumer,
+            &consumers [i], 0 , NULL);
+#else
+        rc = pthread_create (&threads [i], NULL, consumer, &consumers [i]);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+    }
+
+    //  Give the consumers time to connect.
+    zmq_sleep (1);
+
+    zmq_msg_t msg;
+    for (int i = 0; i != message_count; i++) {
+        rc = zmq_msg_init_size (&msg, sizeof (uint64_t));
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        uint64_t sent = now_us ();
+        memcpy (zmq_msg_data (&msg), &sent, sizeof (sent));
+        rc = zmq_send (s, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        zmq_msg_close (&msg);
+        if (interval)
+            sleep_us (interval);
+    }
+
+    zmq_msg_init (&msg);
+    rc = zmq_send (control, &msg, 0);
+    if (rc != 0) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    std::vector <uint64_t> latencies;
+    for (int i = 0; i != consumer_count; i++) {
+#if defined ZMQ_HAVE_WINDOWS
+        WaitForSingleObject (threads [i], INFINITE);
+        CloseHandle (threads [i]);
+#else
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+#endif
+        latencies.insert (latencies.end (), consumers [i].latencies.begin (),
+            consumers [i].latencies.end ());
+    }
+    std::sort (latencies.begin (), latencies.end ());
+
+    printf ("balance: %d\n", balance);
+    printf ("message count: %d\n", (int) latencies.size ());
+    if (!latencies.empty ()) {
+        size_t n = latencies.size ();
+        printf ("latency p50: %d [us]\n", (int) latencies [n / 2]);
+        printf ("latency p99: %d [us]\n", (int) latencies [n * 99 / 100]);
+        printf ("latency p99.9: %d [us]\n",
+            (int) latencies [n * 999 / 1000]);
+        printf ("latency max: %d [us]\n", (int) latencies [n - 1]);
+    }
+    for (int i = 0; i != consumer_count; i++)
+        printf ("consumer %d%s: %d messages\n", i, i == 0 ? " (slow)" : "",
+            (int) consumers [i].latencies.size ());
+
+    zmq_close (control);
+    zmq_close (s);
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures the rate of allocating and releasing message contents, with
+//  zmq_msg_init_size/zmq_msg_close and, for comparison, with malloc/free
+//  of a block of the same size. Messages are released in FIFO order with
+//  a window of batch_size messages in flight, either by the allocating
+//  thread or by another thread, as when messages pass between an
+//  application thread and an I/O thread.
+
+static int message_count;
+static size_t message_size;
+
+enum { batch_size = 1000 };
+
+struct batch_t
+{
+    bool use_malloc;
+    zmq_msg_t msgs [batch_size];
+    void *blocks [batch_size];
+};
+
+static batch_t batches [2];
+
+static void fill (batch_t *batch_, int count_)
+{
+    for (int i = 0; i != count_; i++) {
+        if (batch_->use_malloc) {
+            batch_->blocks [i] = malloc (message_size + 32);
+            if (!batch_->blocks [i]) {
+                printf ("error in malloc\n");
+                exit (1);
+            }
+            *(char*) batch_->blocks [i] = 0;
+        }
+        else {
+            int rc = zmq_msg_init_size (&batch_->msgs [i], message_size);
+            if (rc != 0) {
+                printf ("error in zmq_msg_init_size: %s\n",
+                    zmq_strerror (errno));
+                exit (1);
+            }
+            *(char*) zmq_msg_data (&batch_->msgs [i]) = 0;
+        }
+    }
+}
+
+static void release (batch_t *batch_, int count_)
+{
+    for (int i = 0; i != count_; i++) {
+        if (batch_->use_malloc)
+            free (batch_->blocks [i]);
+        else {
+            int rc = zmq_msg_close (&batch_->msgs [i]);
+            if (rc != 0) {
+                printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+                exit (1);
+            }
+        }
+    }
+}
+
+static void send_ptr (void *s_, void *ptr_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, sizeof (void*));
+    if (rc != 0) {
+        printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    memcpy (zmq_msg_data (&msg), &ptr_, sizeof (void*));
+    rc = zmq_send (s_, &msg, 0);
+    if (rc != 0) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    zmq_msg_close (&msg);
+}
+
+static void *recv_ptr (void *s_)
+{
+    zmq_msg_t msg;
+    void *ptr;
+    zmq_msg_init (&msg);
+    int rc = zmq_recv (s_, &msg, 0);
+    if (rc != 0) {
+        printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    memcpy (&ptr, zmq_msg_data (&msg), sizeof (void*));
+    zmq_msg_close (&msg);
+    return ptr;
+}
+
+//  Releases the batches it receives and hands them back.
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s = zmq_socket (ctx_, ZMQ_PAIR);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    int rc = zmq_connect (s, "inproc://msg_alloc_thr");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    while (true) {
+        batch_t *batch = (batch_t*) recv_ptr (s);
+        if (!batch)
+            break;
+        release (batch, batch_size);
+        send_ptr (s, batch);
+    }
+
+    zmq_close (s);
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static void same_thread (bool use_malloc_, const char *name_)
+{
+    batch_t *batch = &batches [0];
+    batch->use_malloc = use_malloc_;
+
+    void *watch = zmq_stopwatch_start ();
+    int rounds = message_count / batch_size;
+    for (int i = 0; i != rounds; i++) {
+        fill (batch, batch_size);
+        release (batch, batch_size);
+    }
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    printf ("%s, same thread: %d [msg/s]\n", name_,
+        (int) ((double) rounds * batch_size / elapsed * 1000000));
+}
+
+static void cross_thread (void *s_, bool use_malloc_, const char *name_)
+{
+    batches [0].use_malloc = use_malloc_;
+    batches [1].use_malloc = use_malloc_;
+
+    void *watch = zmq_stopwatch_start ();
+    int rounds = message_count / batch_size;
+    for (int i = 0; i != rounds; i++) {
+        batch_t *batch = &batches [i % 2];
+        if (i >= 2)
+            batch = (batch_t*) recv_ptr (s_);
+        fill (batch, batch_size);
+        send_ptr (s_, batch);
+    }
+    for (int i = 0; i != 2 && i != rounds; i++)
+        recv_ptr (s_);
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    printf ("%s, cross thread: %d [msg/s]\n", name_,
+        (int) ((double) rounds * batch_size / elapsed * 1000000));
+}
+
+int main (int argc, char *argv [])
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    void *ctx;
+    void *s;
+    int rc;
+
+    if (argc != 3) {
+        printf ("usage: msg_alloc_thr <message-size> <message-count>\n");
+        return 1;
+    }
+
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    s = zmq_socket (ctx, ZMQ_PAIR);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, "inproc://msg_alloc_thr");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, ctx, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", (int) message_count);
+
+    same_thread (false, "zmq_msg_init_size");
+    same_thread (true, "malloc");
+    cross_thread (s, false, "zmq_msg_init_size");
+    cross_thread (s, true, "malloc");
+
+    send_ptr (s, NULL);
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
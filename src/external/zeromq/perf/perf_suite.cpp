@@ -0,0 +1,596 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../src/platform.hpp"
+#include "../src/stdint.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+//  Runs latency and throughput tests over a sweep of message sizes, high
+//  watermarks and I/O thread counts, with both ends of the test in this
+//  process. For each combination it reports the latency percentiles, the
+//  throughput, and the CPU time, read/write system calls and context
+//  switches of the whole process per message, either as a table or in
+//  a machine-readable format for tracking results over time.
+//
+//  Latency is measured with REQ/REP ping-pong and, like in local_lat, is
+//  half of the round trip; the per-message figures of the latency test
+//  count both messages of a round trip. Throughput is measured with
+//  PUSH/PULL.
+
+static void usage ()
+{
+    printf ("usage: perf_suite [options]\n"
+        "  -t lat|thr|all     tests to run (default all)\n"
+        "  -e endpoint        endpoint to use (default inproc://perf_suite)\n"
+        "  -s size,...        message sizes in bytes (default 1,100,1024)\n"
+        "  -w hwm,...         high watermarks, 0 for none (default 0,1000)\n"
+        "  -i threads,...     I/O thread counts (default 1)\n"
+        "  -n count           round trips or messages per run "
+            "(default 100000)\n"
+        "  -f text|csv|json   output format (default text)\n");
+}
+
+//  Latency histogram with logarithmic buckets, each split into linear
+//  sub-buckets as in HdrHistogram. Values below 128 are exact; above that
+//  each bucket spans at most 1/64 of its value.
+class histogram_t
+{
+public:
+
+    histogram_t () :
+        counts (bucket_count, 0),
+        total (0),
+        max (0)
+    {
+    }
+
+    void record (uint64_t value_)
+    {
+        counts [index (value_)]++;
+        total++;
+        if (value_ > max)
+            max = value_;
+    }
+
+    //  Returns the value below or at which the fraction q_ of the recorded
+    //  values lies. The value is the upper bound of its bucket.
+    uint64_t percentile (double q_)
+    {
+        if (!total)
+            return 0;
+        uint64_t rank = (uint64_t) (q_ * total);
+        if (rank < 1)
+            rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i != counts.size (); i++) {
+            seen += counts [i];
+            if (seen >= rank) {
+                uint64_t upper = highest (i);
+                return upper < max ? upper : max;
+            }
+        }
+        return max;
+    }
+
+    uint64_t maximum ()
+    {
+        return max;
+    }
+
+private:
+
+    enum {
+        sub_bits = 7,
+        half = 1 << (sub_bits - 1),
+        bucket_count = (1 << sub_bits) + (64 - sub_bits) * half
+    };
+
+    static size_t index (uint64_t value_)
+    {
+        if (value_ < (1 << sub_bits))
+            return (size_t) value_;
+        int msb = 63;
+        while (!(value_ >> msb))
+            msb--;
+        int shift = msb - (sub_bits - 1);
+        return (1 << sub_bits) + (shift - 1) * half +
+            (size_t) ((value_ >> shift) - half);
+    }
+
+    static uint64_t highest (size_t index_)
+    {
+        if (index_ < (1 << sub_bits))
+            return index_;
+        size_t shift = (index_ - (1 << sub_bits)) / half + 1;
+        uint64_t mantissa = (index_ - (1 << sub_bits)) % half + half;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::vector <uint64_t> counts;
+    uint64_t total;
+    uint64_t max;
+};
+
+//  Snapshot of the resources the process has used so far.
+struct usage_t
+{
+    uint64_t cpu_us;
+    int64_t rw_calls;
+    int64_t switches;
+};
+
+static uint64_t now_ns ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    LARGE_INTEGER ticks_per_second;
+    QueryPerformanceFrequency (&ticks_per_second);
+    LARGE_INTEGER tick;
+    QueryPerformanceCounter (&tick);
+    return (uint64_t) ((double) tick.QuadPart * 1000000000 /
+        ticks_per_second.QuadPart);
+#elif defined CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000000 + (uint64_t) tv.tv_usec * 1000;
+#endif
+}
+
+static usage_t get_usage ()
+{
+    usage_t usage;
+    usage.rw_calls = -1;
+    usage.switches = -1;
+
+#if defined ZMQ_HAVE_WINDOWS
+    FILETIME creation, exited, kernel, user;
+    GetProcessTimes (GetCurrentProcess (), &creation, &exited, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    usage.cpu_us = (k.QuadPart + u.QuadPart) / 10;
+#else
+    struct rusage ru;
+    int rc = getrusage (RUSAGE_SELF, &ru);
+    if (rc != 0) {
+        printf ("error in getrusage: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    usage.cpu_us =
+        (uint64_t) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+        ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+    usage.switches = ru.ru_nvcsw + ru.ru_nivcsw;
+#endif
+
+#if defined ZMQ_HAVE_LINUX
+    //  The kernel counts the read and write family calls of all the threads
+    //  of the process. Polling calls are not included.
+    FILE *io = fopen ("/proc/self/io", "r");
+    if (io) {
+        char line [64];
+        long long value;
+        usage.rw_calls = 0;
+        while (fgets (line, sizeof (line), io)) {
+            if (sscanf (line, "syscr: %lld", &value) == 1 ||
+                  sscanf (line, "syscw: %lld", &value) == 1)
+                usage.rw_calls += value;
+        }
+        fclose (io);
+    }
+#endif
+
+    return usage;
+}
+
+static std::vector <int> parse_list (const char *list_)
+{
+    std::vector <int> values;
+    const char *pos = list_;
+    while (*pos) {
+        values.push_back (atoi (pos));
+        pos = strchr (pos, ',');
+        if (!pos)
+            break;
+        pos++;
+    }
+    return values;
+}
+
+struct config_t
+{
+    std::string endpoint;
+    int size;
+    uint64_t hwm;
+    int io_threads;
+    int count;
+};
+
+struct result_t
+{
+    const char *test;
+    uint64_t elapsed_us;
+    uint64_t messages;
+    bool has_latency;
+    double p50_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+    usage_t usage;
+};
+
+static void *make_socket (void *ctx_, int type_, const config_t &config_)
+{
+    void *s = zmq_socket (ctx_, type_);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    int rc = zmq_setsockopt (s, ZMQ_HWM, &config_.hwm, sizeof (config_.hwm));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    return s;
+}
+
+static void send_msg (void *s_, int size_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size_);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    memset (zmq_msg_data (&msg), 0, size_);
+    rc = zmq_send (s_, &msg, 0);
+    if (rc != 0) {
+        printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    zmq_msg_close (&msg);
+}
+
+static void recv_msg (void *s_, int size_)
+{
+    zmq_msg_t msg;
+    zmq_msg_init (&msg);
+    int rc = zmq_recv (s_, &msg, 0);
+    if (rc != 0) {
+        printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    if ((int) zmq_msg_size (&msg) != size_) {
+        printf ("message of incorrect size received\n");
+        exit (1);
+    }
+    zmq_msg_close (&msg);
+}
+
+//  The peer of a test runs in a thread of its own. It connects to the
+//  endpoint and either echoes or sends the messages.
+struct peer_t
+{
+    void *ctx;
+    const config_t *config;
+    int type;
+    int messages;
+};
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall peer_routine (void *arg_)
+#else
+static void *peer_routine (void *arg_)
+#endif
+{
+    peer_t *peer = (peer_t*) arg_;
+    void *s = make_socket (peer->ctx, peer->type, *peer->config);
+    int rc = zmq_connect (s, peer->config->endpoint.c_str ());
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (int i = 0; i != peer->messages; i++) {
+        if (peer->type == ZMQ_REP) {
+            recv_msg (s, peer->config->size);
+            send_msg (s, peer->config->size);
+        }
+        else
+            send_msg (s, peer->config->size);
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    return 0;
+}
+
+static result_t run (const char *test_, const config_t &config_)
+{
+    bool lat = strcmp (test_, "lat") == 0;
+
+    void *ctx = zmq_init (config_.io_threads);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    void *s = make_socket (ctx, lat ? ZMQ_REQ : ZMQ_PULL, config_);
+    int rc = zmq_bind (s, config_.endpoint.c_str ());
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    //  The first round trips are not measured so that connecting and warming
+    //  up the caches doesn't skew the results. The throughput test has to
+    //  measure the sender from its start instead, otherwise it would mostly
+    //  measure draining the messages already queued.
+    int warmup = config_.count / 10 < 1000 ? config_.count / 10 : 1000;
+    if (!lat)
+        warmup = 0;
+    usage_t before = get_usage ();
+    uint64_t start = now_ns ();
+
+    peer_t peer = {ctx, &config_, lat ? ZMQ_REP : ZMQ_PUSH,
+        warmup + config_.count};
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE thread = (HANDLE) _beginthreadex (NULL, 0, peer_routine, &peer,
+        0 , NULL);
+#else
+    pthread_t thread;
+    rc = pthread_create (&thread, NULL, peer_routine, &peer);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    histogram_t histogram;
+    if (lat) {
+        for (int i = 0; i != warmup; i++) {
+            send_msg (s, config_.size);
+            recv_msg (s, config_.size);
+        }
+        before = get_usage ();
+        start = now_ns ();
+    }
+    for (int i = 0; i != config_.count; i++) {
+        if (lat) {
+            uint64_t sent = now_ns ();
+            send_msg (s, config_.size);
+            recv_msg (s, config_.size);
+            histogram.record (now_ns () - sent);
+        }
+        else
+            recv_msg (s, config_.size);
+    }
+    uint64_t end = now_ns ();
+    usage_t after = get_usage ();
+
+#if defined ZMQ_HAVE_WINDOWS
+    WaitForSingleObject (thread, INFINITE);
+    CloseHandle (thread);
+#else
+    rc = pthread_join (thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    result_t result;
+    result.test = lat ? "lat" : "thr";
+    result.elapsed_us = (end - start) / 1000;
+    if (result.elapsed_us == 0)
+        result.elapsed_us = 1;
+    result.messages = lat ? (uint64_t) config_.count * 2 : config_.count;
+    result.has_latency = lat;
+    result.p50_us = histogram.percentile (0.5) / 2000.0;
+    result.p99_us = histogram.percentile (0.99) / 2000.0;
+    result.p999_us = histogram.percentile (0.999) / 2000.0;
+    result.max_us = histogram.maximum () / 2000.0;
+    result.usage.cpu_us = after.cpu_us - before.cpu_us;
+    result.usage.rw_calls = after.rw_calls < 0 ? -1 :
+        after.rw_calls - before.rw_calls;
+    result.usage.switches = after.switches < 0 ? -1 :
+        after.switches - before.switches;
+    return result;
+}
+
+static void print (const char *format_, const config_t &config_,
+    const result_t &result_, bool first_)
+{
+    double msgs = (double) result_.messages;
+    double msg_per_s = msgs * 1000000 / result_.elapsed_us;
+    double mbit_per_s = msg_per_s * config_.size * 8 / 1000000;
+    double cpu_per_msg = result_.usage.cpu_us / msgs;
+    double rw_per_msg = result_.usage.rw_calls < 0 ? -1 :
+        result_.usage.rw_calls / msgs;
+    double csw_per_msg = result_.usage.switches < 0 ? -1 :
+        result_.usage.switches / msgs;
+
+    if (strcmp (format_, "json") == 0) {
+        printf ("{\"test\": \"%s\", \"endpoint\": \"%s\", \"size\": %d, "
+            "\"hwm\": %d, \"io_threads\": %d, \"count\": %d, "
+            "\"elapsed_us\": %llu, \"msg_per_s\": %.0f, "
+            "\"mbit_per_s\": %.3f, ",
+            result_.test, config_.endpoint.c_str (), config_.size,
+            (int) config_.hwm, config_.io_threads, config_.count,
+            (unsigned long long) result_.elapsed_us, msg_per_s, mbit_per_s);
+        if (result_.has_latency)
+            printf ("\"lat_p50_us\": %.3f, \"lat_p99_us\": %.3f, "
+                "\"lat_p999_us\": %.3f, \"lat_max_us\": %.3f, ",
+                result_.p50_us, result_.p99_us, result_.p999_us,
+                result_.max_us);
+        else
+            printf ("\"lat_p50_us\": null, \"lat_p99_us\": null, "
+                "\"lat_p999_us\": null, \"lat_max_us\": null, ");
+        printf ("\"cpu_us_per_msg\": %.4f, \"rw_calls_per_msg\": %.4f, "
+            "\"csw_per_msg\": %.4f}\n",
+            cpu_per_msg, rw_per_msg, csw_per_msg);
+    }
+    else if (strcmp (format_, "csv") == 0) {
+        if (first_)
+            printf ("test,endpoint,size,hwm,io_threads,count,elapsed_us,"
+                "msg_per_s,mbit_per_s,lat_p50_us,lat_p99_us,lat_p999_us,"
+                "lat_max_us,cpu_us_per_msg,rw_calls_per_msg,csw_per_msg\n");
+        printf ("%s,%s,%d,%d,%d,%d,%llu,%.0f,%.3f,", result_.test,
+            config_.endpoint.c_str (), config_.size, (int) config_.hwm,
+            config_.io_threads, config_.count,
+            (unsigned long long) result_.elapsed_us, msg_per_s, mbit_per_s);
+        if (result_.has_latency)
+            printf ("%.3f,%.3f,%.3f,%.3f,", result_.p50_us, result_.p99_us,
+                result_.p999_us, result_.max_us);
+        else
+            printf (",,,,");
+        printf ("%.4f,%.4f,%.4f\n", cpu_per_msg, rw_per_msg, csw_per_msg);
+    }
+    else {
+        if (first_)
+            printf ("%-4s %7s %6s %3s %10s %10s %9s %9s %9s %9s %8s %8s "
+                "%8s\n", "test", "size", "hwm", "io", "msg/s", "Mb/s",
+                "p50[us]", "p99[us]", "p99.9[us]", "max[us]", "cpu[us]", "rw",
+                "csw");
+        printf ("%-4s %7d %6d %3d %10.0f %10.3f ", result_.test, config_.size,
+            (int) config_.hwm, config_.io_threads, msg_per_s, mbit_per_s);
+        if (result_.has_latency)
+            printf ("%9.2f %9.2f %9.2f %9.2f ", result_.p50_us,
+                result_.p99_us, result_.p999_us, result_.max_us);
+        else
+            printf ("%9s %9s %9s %9s ", "-", "-", "-", "-");
+        printf ("%8.3f %8.3f %8.3f\n", cpu_per_msg, rw_per_msg,
+            csw_per_msg);
+    }
+    fflush (stdout);
+}
+
+int main (int argc, char *argv [])
+{
+    const char *tests = "all";
+    const char *format = "text";
+    std::string endpoint = "inproc://perf_suite";
+    std::vector <int> sizes = parse_list ("1,100,1024");
+    std::vector <int> hwms = parse_list ("0,1000");
+    std::vector <int> io_threads = parse_list ("1");
+    int count = 100000;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv [i][0] != '-' || argv [i][1] == 0 || argv [i][2] != 0 ||
+              i + 1 == argc) {
+            usage ();
+            return 1;
+        }
+        const char *value = argv [++i];
+        switch (argv [i - 1][1]) {
+        case 't':
+            tests = value;
+            break;
+        case 'e':
+            endpoint = value;
+            break;
+        case 's':
+            sizes = parse_list (value);
+            break;
+        case 'w':
+            hwms = parse_list (value);
+            break;
+        case 'i':
+            io_threads = parse_list (value);
+            break;
+        case 'n':
+            count = atoi (value);
+            break;
+        case 'f':
+            format = value;
+            break;
+        default:
+            usage ();
+            return 1;
+        }
+    }
+
+    if ((strcmp (tests, "lat") != 0 && strcmp (tests, "thr") != 0 &&
+          strcmp (tests, "all") != 0) ||
+          (strcmp (format, "text") != 0 && strcmp (format, "csv") != 0 &&
+          strcmp (format, "json") != 0) || count <= 0) {
+        usage ();
+        return 1;
+    }
+
+    bool first = true;
+    for (int t = 0; t != 2; t++) {
+        const char *test = t == 0 ? "lat" : "thr";
+        if (strcmp (tests, "all") != 0 && strcmp (tests, test) != 0)
+            continue;
+        for (size_t i = 0; i != io_threads.size (); i++) {
+            for (size_t w = 0; w != hwms.size (); w++) {
+                for (size_t s = 0; s != sizes.size (); s++) {
+                    config_t config;
+                    config.endpoint = endpoint;
+                    config.size = sizes [s];
+                    config.hwm = hwms [w];
+                    config.io_threads = io_threads [i];
+                    config.count = count;
+                    result_t result = run (test, config);
+                    print (format, config, result, first);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../src/platform.hpp"
+#include "../src/stdint.hpp"
+#include "../src/uuid.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined ZMQ_HAVE_LINUX || defined ZMQ_HAVE_SOLARIS ||\
+    defined ZMQ_HAVE_OSX || defined ZMQ_HAVE_CYGWIN
+#include <uuid/uuid.h>
+#define UUID_THR_LIBUUID
+#endif
+
+//  Measures the rate of generating UUIDs with zmq::uuid_t, which libzmq
+//  uses to name anonymous peers: thread-count threads generate uuid-count
+//  UUIDs each. Each thread checks that its timestamps strictly increase.
+//  For comparison, the rate of the system's uuid_generate is measured
+//  in a single thread where it is available.
+
+static int uuid_count;
+
+struct result_t
+{
+    unsigned long elapsed;
+    bool ordered;
+};
+
+static uint64_t timestamp (const unsigned char *blob_)
+{
+    return ((uint64_t) (blob_ [6] & 0x0f) << 56) |
+        ((uint64_t) blob_ [7] << 48) | ((uint64_t) blob_ [4] << 40) |
+        ((uint64_t) blob_ [5] << 32) | ((uint64_t) blob_ [0] << 24) |
+        ((uint64_t) blob_ [1] << 16) | ((uint64_t) blob_ [2] << 8) |
+        (uint64_t) blob_ [3];
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *arg_)
+#else
+static void *worker (void *arg_)
+#endif
+{
+    result_t *result = (result_t*) arg_;
+    result->ordered = true;
+
+    uint64_t last = 0;
+    void *watch = zmq_stopwatch_start ();
+    for (int i = 0; i != uuid_count; i++) {
+        zmq::uuid_t uuid;
+        uint64_t time = timestamp (uuid.to_blob ());
+        if (time <= last)
+            result->ordered = false;
+        last = time;
+    }
+    result->elapsed = zmq_stopwatch_stop (watch);
+    if (result->elapsed == 0)
+        result->elapsed = 1;
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int main (int argc, char *argv [])
+{
+    int thread_count;
+    int rc;
+
+    if (argc != 3) {
+        printf ("usage: uuid_thr <thread-count> <uuid-count>\n");
+        return 1;
+    }
+    thread_count = atoi (argv [1]);
+    uuid_count = atoi (argv [2]);
+
+    std::vector <result_t> results (thread_count);
+    void *watch = zmq_stopwatch_start ();
+
+#if defined ZMQ_HAVE_WINDOWS
+    std::vector <HANDLE> threads (thread_count);
+    for (int i = 0; i != thread_count; i++)
+        threads [i] = (HANDLE) _beginthreadex (NULL, 0, worker,
+            &results [i], 0 , NULL);
+    for (int i = 0; i != thread_count; i++) {
+        WaitForSingleObject (threads [i], INFINITE);
+        CloseHandle (threads [i]);
+    }
+#else
+    std::vector <pthread_t> threads (thread_count);
+    for (int i = 0; i != thread_count; i++) {
+        rc = pthread_create (&threads [i], NULL, worker, &results [i]);
+        if (rc != 0) {
+            printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+    for (int i = 0; i != thread_count; i++) {
+        rc = pthread_join (threads [i], NULL);
+        if (rc != 0) {
+            printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+            return -1;
+        }
+    }
+#endif
+
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    double per_thread = 0;
+    for (int i = 0; i != thread_count; i++) {
+        if (!results [i].ordered) {
+            printf ("timestamps out of order\n");
+            return -1;
+        }
+        per_thread += (double) uuid_count / results [i].elapsed * 1000000;
+    }
+    per_thread /= thread_count;
+
+    printf ("thread count: %d\n", thread_count);
+    printf ("uuid count: %d\n", thread_count * uuid_count);
+    printf ("mean throughput per thread: %d [uuid/s]\n", (int) per_thread);
+    printf ("mean throughput: %d [uuid/s]\n",
+        (int) ((double) thread_count * uuid_count / elapsed * 1000000));
+
+#if defined UUID_THR_LIBUUID
+    watch = zmq_stopwatch_start ();
+    for (int i = 0; i != uuid_count; i++) {
+        ::uuid_t uuid;
+        uuid_generate (uuid);
+    }
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+    printf ("uuid_generate throughput: %d [uuid/s]\n",
+        (int) ((double) uuid_count / elapsed * 1000000));
+#endif
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+//  Measures how fast an XREP socket routes messages as the number of peers
+//  grows. A single XREQ socket connects to the XREP socket peer-count
+//  times, each connection being a separate anonymous peer. The XREP socket
+//  learns the peer identities from one message per peer and then sends
+//  message-count messages to the peers in turn. The peers don't read, so
+//  once their pipes are full the messages are dropped after the routing
+//  lookup; what is measured is the routing itself.
+
+int main (int argc, char *argv [])
+{
+    const char *connect_to = "tcp://127.0.0.1:5560";
+    void *ctx;
+    void *router;
+    void *dealer;
+    int rc;
+    int peer_count;
+    int message_count;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    unsigned long throughput;
+
+    if (argc != 3) {
+        printf ("usage: xrep_route_thr <peer-count> <message-count>\n");
+        return 1;
+    }
+    peer_count = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+
+    ctx = zmq_init (1);
+    if (!ctx) {
+        printf ("error in zmq_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    router = zmq_socket (ctx, ZMQ_XREP);
+    if (!router) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    uint64_t hwm = 100;
+    rc = zmq_setsockopt (router, ZMQ_HWM, &hwm, sizeof (hwm));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int backlog = peer_count;
+    rc = zmq_setsockopt (router, ZMQ_BACKLOG, &backlog, sizeof (backlog));
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (router, connect_to);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    dealer = zmq_socket (ctx, ZMQ_XREQ);
+    if (!dealer) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    for (int i = 0; i != peer_count; i++) {
+        rc = zmq_connect (dealer, connect_to);
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    //  XREQ sends to its connections in turn, so one message reaches each
+    //  of the peers.
+    for (int i = 0; i != peer_count; i++) {
+        rc = zmq_msg_init_size (&msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_send (dealer, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        zmq_msg_close (&msg);
+    }
+
+    //  Collect the identities of the peers.
+    std::vector <zmq_msg_t> identities (peer_count);
+    for (int i = 0; i != peer_count; i++) {
+        zmq_msg_init (&identities [i]);
+        rc = zmq_recv (router, &identities [i], 0);
+        if (rc != 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        zmq_msg_init (&msg);
+        rc = zmq_recv (router, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        zmq_msg_close (&msg);
+    }
+
+    printf ("peer count: %d\n", peer_count);
+    printf ("message count: %d\n", message_count);
+
+    watch = zmq_stopwatch_start ();
+
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t *identity = &identities [i % peer_count];
+        zmq_msg_init_size (&msg, zmq_msg_size (identity));
+        memcpy (zmq_msg_data (&msg), zmq_msg_data (identity),
+            zmq_msg_size (identity));
+        rc = zmq_send (router, &msg, ZMQ_SNDMORE);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        zmq_msg_init_size (&msg, 0);
+        rc = zmq_send (router, &msg, 0);
+        if (rc != 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    zmq_msg_close (&msg);
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    throughput = (unsigned long)
+        ((double) message_count / (double) elapsed * 1000000);
+
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+
+    for (int i = 0; i != peer_count; i++)
+        zmq_msg_close (&identities [i]);
+
+    int linger = 0;
+    zmq_setsockopt (router, ZMQ_LINGER, &linger, sizeof (linger));
+    zmq_setsockopt (dealer, ZMQ_LINGER, &linger, sizeof (linger));
+
+    rc = zmq_close (dealer);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (router);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
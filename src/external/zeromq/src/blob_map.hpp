@@ -0,0 +1,195 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_BLOB_MAP_HPP_INCLUDED__
+#define __ZMQ_BLOB_MAP_HPP_INCLUDED__
+
+#include <vector>
+#include <string.h>
+
+#include "blob.hpp"
+#include "stdint.hpp"
+#include "err.hpp"
+
+namespace zmq
+{
+
+    //  Map from binary keys to values, implemented as an open-addressing
+    //  hash table with linear probing. Entries are stored densely so that
+    //  they can be iterated over by index; the table itself holds only
+    //  indices into the entries. Hash values are cached in the entries, so
+    //  a lookup compares keys only on a full hash match and the table
+    //  never has to rehash a key when it grows. Lookups take the key as
+    //  a plain buffer so that no blob has to be built for them.
+
+    template <typename T> class blob_map_t
+    {
+    public:
+
+        typedef typename std::vector <T>::size_type size_type;
+
+        inline blob_map_t () :
+            mask (0)
+        {
+        }
+
+        inline size_type size ()
+        {
+            return entries.size ();
+        }
+
+        inline bool empty ()
+        {
+            return entries.empty ();
+        }
+
+        //  Access to the entries by index, in no particular order.
+        inline const blob_t &key (size_type index_)
+        {
+            return entries [index_].key;
+        }
+
+        inline T &value (size_type index_)
+        {
+            return entries [index_].value;
+        }
+
+        //  Returns the value stored under the key, NULL if there's none.
+        inline T *find (const unsigned char *data_, size_t size_)
+        {
+            if (entries.empty ())
+                return NULL;
+            uint32_t hash = hash_key (data_, size_);
+            for (size_type i = hash & mask; slots [i]; i = (i + 1) & mask) {
+                entry_t &entry = entries [slots [i] - 1];
+                if (entry.hash == hash && entry.key.size () == size_ &&
+                      memcmp (entry.key.data (), data_, size_) == 0)
+                    return &entry.value;
+            }
+            return NULL;
+        }
+
+        //  Stores the value under the key, as the entry with the highest
+        //  index. Returns false if the key is already present.
+        inline bool insert (const blob_t &key_, const T &value_)
+        {
+            if (find (key_.data (), key_.size ()))
+                return false;
+
+            //  Keep the load factor at or below 1/2.
+            if ((entries.size () + 1) * 2 > slots.size ())
+                grow ();
+
+            entry_t entry = {key_, hash_key (key_.data (), key_.size ()),
+                value_};
+            entries.push_back (entry);
+            slots [free_slot (entry.hash)] = (uint32_t) entries.size ();
+            return true;
+        }
+
+        //  Removes the entry at the index. The last entry takes its place.
+        inline void erase (size_type index_)
+        {
+            //  Remove the slot, shifting back the entries that probed past
+            //  it so that no probe sequence is broken.
+            size_type i = slot_of (index_);
+            for (size_type j = (i + 1) & mask; slots [j]; j = (j + 1) & mask) {
+                size_type home = entries [slots [j] - 1].hash & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    slots [i] = slots [j];
+                    i = j;
+                }
+            }
+            slots [i] = 0;
+
+            size_type last = entries.size () - 1;
+            if (index_ != last) {
+                slots [slot_of (last)] = (uint32_t) (index_ + 1);
+                entries [index_].key.swap (entries [last].key);
+                entries [index_].hash = entries [last].hash;
+                entries [index_].value = entries [last].value;
+            }
+            entries.pop_back ();
+        }
+
+    private:
+
+        struct entry_t
+        {
+            blob_t key;
+            uint32_t hash;
+            T value;
+        };
+
+        //  FNV-1a.
+        static inline uint32_t hash_key (const unsigned char *data_,
+            size_t size_)
+        {
+            uint32_t hash = 2166136261U;
+            for (size_t i = 0; i != size_; i++) {
+                hash ^= data_ [i];
+                hash *= 16777619U;
+            }
+            return hash;
+        }
+
+        inline size_type free_slot (uint32_t hash_)
+        {
+            size_type i = hash_ & mask;
+            while (slots [i])
+                i = (i + 1) & mask;
+            return i;
+        }
+
+        inline size_type slot_of (size_type index_)
+        {
+            size_type i = entries [index_].hash & mask;
+            while (slots [i] != index_ + 1) {
+                zmq_assert (slots [i]);
+                i = (i + 1) & mask;
+            }
+            return i;
+        }
+
+        inline void grow ()
+        {
+            size_type capacity = slots.empty () ? 16 : slots.size () * 2;
+            slots.assign (capacity, 0);
+            mask = capacity - 1;
+            for (size_type i = 0; i != entries.size (); i++)
+                slots [free_slot (entries [i].hash)] = (uint32_t) (i + 1);
+        }
+
+        typedef std::vector <entry_t> entries_t;
+        entries_t entries;
+
+        //  Open-addressing table of indices into entries, plus one.
+        //  Zero marks an empty slot.
+        typedef std::vector <uint32_t> slots_t;
+        slots_t slots;
+        size_type mask;
+
+        blob_map_t (const blob_map_t&);
+        const blob_map_t &operator = (const blob_map_t&);
+    };
+
+}
+
+#endif
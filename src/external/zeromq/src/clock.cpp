@@ -22,6 +22,7 @@
 #include "platform.hpp"
 #include "likely.hpp"
 #include "config.hpp"
+#include "atomic_counter.hpp"
 #include "err.hpp"
 
 #include <stddef.h>
@@ -30,6 +31,10 @@
 #include <intrin.h>
 #endif
 
+#if (defined __GNUC__ && (defined __i386__ || defined __x86_64__))
+#include <cpuid.h>
+#endif
+
 #if !defined ZMQ_HAVE_WINDOWS
 #include <sys/time.h>
 #endif
@@ -38,9 +43,23 @@
 #include <time.h>
 #endif
 
+//  Calibrated rate of the timestamp counter as returned by tsc_mult.
+//  0 if it wasn't calibrated yet, 1 if it can't be used to measure time.
+static zmq::atomic_counter_t tsc_rate;
+
+//  Reads the timestamp counter and the system clock at the same moment,
+//  as closely as possible.
+static void sample_clocks (uint64_t *tsc_, uint64_t *us_)
+{
+    uint64_t before = zmq::clock_t::rdtsc ();
+    *us_ = zmq::clock_t::now_us ();
+    *tsc_ = before + (zmq::clock_t::rdtsc () - before) / 2;
+}
+
 zmq::clock_t::clock_t () :
     last_tsc (rdtsc ()),
-    last_time (now_us () / 1000)
+    last_time (now_us ()),
+    latest_time (last_time)
 {
 }
 
@@ -92,15 +111,100 @@ uint64_t zmq::clock_t::now_ms ()
     if (!tsc)
         return now_us () / 1000;
 
+    //  If TSC is invariant, the time can be computed from it.
+    uint32_t mult = tsc_mult ();
+    if (mult)
+        return extrapolate (tsc, mult) / 1000;
+
     //  If TSC haven't jumped back (in case of migration to a different
     //  CPU core) and if not too much time elapsed since last measurement,
     //  we can return cached time value.
     if (likely (tsc - last_tsc <= (clock_precision / 2) && tsc >= last_tsc))
-        return last_time;
+        return last_time / 1000;
 
     last_tsc = tsc;
-    last_time = now_us () / 1000;
-    return last_time;
+    last_time = now_us ();
+    return last_time / 1000;
+}
+
+uint64_t zmq::clock_t::extrapolate (uint64_t tsc_, uint32_t mult_)
+{
+    //  Convert the ticks elapsed since the last measurement to microseconds.
+    //  The multiplication is split in two so that it can't overflow.
+    uint64_t ticks = tsc_ - last_tsc;
+    uint64_t elapsed = (ticks >> 32) * mult_ +
+        (((ticks & 0xffffffff) * mult_) >> 32);
+
+    //  If TSC have jumped back (the cores may not be synchronised) or if
+    //  the extrapolation went too far, measure the time anew.
+    if (unlikely (tsc_ < last_tsc || elapsed > tsc_resync_interval)) {
+        last_tsc = tsc_;
+        last_time = now_us ();
+        elapsed = 0;
+    }
+
+    //  With the calibration being slightly off, the measured time can lag
+    //  behind the time extrapolated before. Don't let the clock go back.
+    if (likely (last_time + elapsed > latest_time))
+        latest_time = last_time + elapsed;
+    return latest_time;
+}
+
+uint32_t zmq::clock_t::tsc_mult ()
+{
+    uint32_t mult = tsc_rate.get ();
+    if (likely (mult > 1))
+        return mult;
+    if (mult == 1)
+        return 0;
+
+    //  Measure the rate of TSC against the system clock. If several threads
+    //  get here at the same time, each of them does the measurement; any of
+    //  the results will do.
+    mult = 1;
+    if (tsc_invariant ()) {
+        uint64_t start_tsc;
+        uint64_t start_us;
+        uint64_t end_tsc;
+        uint64_t end_us;
+        sample_clocks (&start_tsc, &start_us);
+        do {
+            sample_clocks (&end_tsc, &end_us);
+        } while (end_us - start_us < tsc_calibration_time);
+
+        if (end_tsc > start_tsc) {
+            uint64_t rate = ((end_us - start_us) << 32) /
+                (end_tsc - start_tsc);
+
+            //  A counter slower than 1MHz is of no use.
+            if (rate > 1 && rate <= 0xffffffff)
+                mult = (uint32_t) rate;
+        }
+    }
+    tsc_rate.set (mult);
+
+    return mult == 1 ? 0 : mult;
+}
+
+bool zmq::clock_t::tsc_invariant ()
+{
+    //  Both Intel and AMD CPUs report invariant TSC in bit 8 of EDX
+    //  returned by the extended CPUID leaf 0x80000007.
+#if (defined _MSC_VER && (defined _M_IX86 || defined _M_X64))
+    int regs [4];
+    __cpuid (regs, (int) 0x80000000);
+    if ((unsigned int) regs [0] < 0x80000007)
+        return false;
+    __cpuid (regs, (int) 0x80000007);
+    return (regs [3] & (1 << 8)) != 0;
+#elif (defined __GNUC__ && (defined __i386__ || defined __x86_64__))
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid (0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (edx & (1 << 8)) != 0;
+#else
+    return false;
+#endif
 }
 
 uint64_t zmq::clock_t::rdtsc ()
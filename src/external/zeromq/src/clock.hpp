@@ -36,6 +36,11 @@ namespace zmq
         //  CPU's timestamp counter. Returns 0 if it's not available.
         static uint64_t rdtsc ();
 
+        //  Returns true if the CPU's timestamp counter runs at a constant
+        //  rate regardless of frequency scaling and sleep states, so that it
+        //  can be used to measure time.
+        static bool tsc_invariant ();
+
         //  High precision timestamp.
         static uint64_t now_us ();
 
@@ -45,12 +50,24 @@ namespace zmq
 
     private:
 
+        //  Microseconds per tick of the timestamp counter, in units of
+        //  2^-32 microseconds. The counter is calibrated against the system
+        //  clock the first time it's needed. Returns 0 if the counter can't
+        //  be used to measure time.
+        static uint32_t tsc_mult ();
+
+        //  Extrapolates the time from the timestamp counter.
+        uint64_t extrapolate (uint64_t tsc_, uint32_t mult_);
+
         //  TSC timestamp of when last time measurement was made.
         uint64_t last_tsc;
 
-        //  Physical time corresponding to the TSC above (in milliseconds).
+        //  Physical time corresponding to the TSC above (in microseconds).
         uint64_t last_time;
 
+        //  The latest time extrapolated from the TSC (in microseconds).
+        uint64_t latest_time;
+
         clock_t (const clock_t&);
         const clock_t &operator = (const clock_t&);
     };
@@ -42,6 +42,7 @@ namespace zmq
             bind,
             activate_reader,
             activate_writer,
+            hiccup,
             pipe_term,
             pipe_term_ack,
             term_req,
@@ -96,6 +97,13 @@ namespace zmq
                 uint64_t msgs_read;
             } activate_writer;
 
+            //  Sent by pipe reader to pipe writer when the peer the reader
+            //  passes the messages to was replaced, e.g. by reconnecting.
+            //  Whatever state the writer has passed so far may have been
+            //  lost on the way.
+            struct {
+            } hiccup;
+
             //  Sent by pipe reader to pipe writer to ask it to terminate
             //  its end of the pipe.
             struct {
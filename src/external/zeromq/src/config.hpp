@@ -36,9 +36,6 @@ namespace zmq
         //  memory allocation by approximately 99.6%
         message_pipe_granularity = 256,
 
-        //  Commands in pipe per allocation event.
-        command_pipe_granularity = 16,
-
         //  Size in bytes of the largest message that is still copied around
         //  rather than being reference-counted.
         max_vsm_size = 29,
@@ -63,12 +60,48 @@ namespace zmq
         //  unnecessary network stack traversals.
         out_batch_size = 8192,
 
+        //  Engines write batches as a vector of chunks. Message parts of at
+        //  least out_batch_copy_min bytes are written directly from the
+        //  message rather than being copied into the batch buffer, and up to
+        //  out_batch_iov chunks are written by a single 'writev' call.
+        out_batch_copy_min = 1024,
+        out_batch_iov = 64,
+
+        //  Maximal size of a vectored batch. Engines adapt the batch size
+        //  between out_batch_size and this value depending on how much data
+        //  the socket accepted in the previous write.
+        out_batch_size_max = 262144,
+
+        //  Message contents up to this size, in bytes, header included, are
+        //  allocated from the message pool. Must match the largest size
+        //  class of the pool (64 << 7).
+        msg_pool_max_size = 8192,
+
+        //  Number of blocks per size class a thread keeps cached, and the
+        //  number of blocks exchanged with the central free list at once.
+        msg_pool_cache_size = 128,
+        msg_pool_batch = 32,
+
+        //  Maximum number of blocks per size class in the central free
+        //  list. Blocks beyond that are returned to the system.
+        msg_pool_central_size = 4096,
+
+        //  Number of bytes a pipe of weight 1 is credited with in each turn
+        //  when fair-queueing inbound messages. A message that doesn't fit
+        //  is still delivered whole and the overrun is paid back in the
+        //  pipe's following turns.
+        fq_quantum = 8192,
+
+        //  Maximum number of messages a device forwards in one direction
+        //  per wakeup before it turns to the other direction.
+        device_batch_size = 256,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
-        //  Swap inteligently batches data for writing to disk. The size of
-        //  the batch in bytes is specified by this option.
-        swap_block_size = 8192,
+        //  Size of the header at the start of the swap file, in bytes.
+        //  The ring buffer that follows it stays page-aligned.
+        swap_header_size = 4096,
 
         //  Maximum number of events the I/O thread can process in one go.
         max_io_events = 256,
@@ -86,6 +119,16 @@ namespace zmq
         //  possible latencies.
         clock_precision = 1000000,
 
+        //  Time in microseconds spent measuring the rate of the CPU's
+        //  timestamp counter against the system clock. The measurement is
+        //  done once per process, the first time the clock is needed.
+        tsc_calibration_time = 2000,
+
+        //  Maximal time in microseconds the clock is extrapolated from the
+        //  timestamp counter before it's synchronised with the system clock
+        //  again. It bounds the error due to the inaccurate calibration.
+        tsc_resync_interval = 100000,
+
         //  Maximum transport data unit size for PGM (TPDU).
         pgm_max_tpdu = 1500
     };
@@ -18,6 +18,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <new>
 #include <stddef.h>
 
 #include "platform.hpp"
@@ -38,9 +39,56 @@
 
 #include "device.hpp"
 #include "socket_base.hpp"
+#include "thread.hpp"
+#include "config.hpp"
 #include "likely.hpp"
 #include "err.hpp"
 
+//  Forwards messages from one socket to the other. Whole messages are
+//  forwarded until either there's no message immediately available or
+//  device_batch_size messages were forwarded. Message parts are passed on
+//  as they are, i.e. the content is handed over to the destination socket
+//  without being copied.
+static int forward (zmq::socket_base_t *from_, zmq::socket_base_t *to_,
+    zmq_msg_t *msg_)
+{
+    int64_t more;
+    size_t moresz;
+
+    for (int i = 0; i != zmq::device_batch_size; i++) {
+
+        //  Parts of a multi-part message arrive at once, so it's only the
+        //  first part that may not be available.
+        int rc = from_->recv (msg_, ZMQ_NOBLOCK);
+        if (rc < 0) {
+            if (errno == EAGAIN)
+                return 0;
+            return -1;
+        }
+
+        while (true) {
+
+            moresz = sizeof (more);
+            rc = from_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
+            if (unlikely (rc < 0))
+                return -1;
+
+            rc = to_->send (msg_, more ? ZMQ_SNDMORE : 0);
+            if (unlikely (rc < 0))
+                return -1;
+
+            if (!more)
+                break;
+
+            rc = from_->recv (msg_, 0);
+            if (unlikely (rc < 0))
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
 int zmq::device (class socket_base_t *insocket_,
         class socket_base_t *outsocket_)
 {
@@ -51,9 +99,6 @@ int zmq::device (class socket_base_t *insocket_,
         return -1;
     }
 
-    int64_t more;
-    size_t moresz;
-
     zmq_pollitem_t items [2];
     items [0].socket = insocket_;
     items [0].fd = 0;
@@ -75,55 +120,23 @@ int zmq::device (class socket_base_t *insocket_,
         //  The algorithm below asumes ratio of request and replies processed
         //  under full load to be 1:1. Although processing requests replies
         //  first is tempting it is suspectible to DoS attacks (overloading
-        //  the system with unsolicited replies).
+        //  the system with unsolicited replies). Each wakeup drains a batch
+        //  of messages in both directions so that the cost of the poll is
+        //  amortised over many messages.
 
-        //  Process a request.
+        //  Process requests.
         if (items [0].revents & ZMQ_POLLIN) {
-            while (true) {
-
-                rc = insocket_->recv (&msg, 0);
-                if (unlikely (rc < 0)) {
-                    return -1;
-                }
-
-                moresz = sizeof (more);
-                rc = insocket_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
-                if (unlikely (rc < 0)) {
-                    return -1;
-                }
-
-                rc = outsocket_->send (&msg, more ? ZMQ_SNDMORE : 0);
-                if (unlikely (rc < 0)) {
-                    return -1;
-                }
-
-                if (!more)
-                    break;
+            rc = forward (insocket_, outsocket_, &msg);
+            if (unlikely (rc < 0)) {
+                return -1;
             }
         }
 
-        //  Process a reply.
+        //  Process replies.
         if (items [1].revents & ZMQ_POLLIN) {
-            while (true) {
-
-                rc = outsocket_->recv (&msg, 0);
-                if (unlikely (rc < 0)) {
-                    return -1;
-                }
-
-                moresz = sizeof (more);
-                rc = outsocket_->getsockopt (ZMQ_RCVMORE, &more, &moresz);
-                if (unlikely (rc < 0)) {
-                    return -1;
-                }
-
-                rc = insocket_->send (&msg, more ? ZMQ_SNDMORE : 0);
-                if (unlikely (rc < 0)) {
-                    return -1;
-                }
-
-                if (!more)
-                    break;
+            rc = forward (outsocket_, insocket_, &msg);
+            if (unlikely (rc < 0)) {
+                return -1;
             }
         }
 
@@ -132,3 +145,61 @@ int zmq::device (class socket_base_t *insocket_,
     return 0;
 }
 
+namespace zmq
+{
+
+    struct device_shard_t
+    {
+        socket_base_t *insocket;
+        socket_base_t *outsocket;
+        int rc;
+        int err;
+        thread_t thread;
+    };
+
+}
+
+static void device_routine (void *arg_)
+{
+    zmq::device_shard_t *shard = (zmq::device_shard_t*) arg_;
+    shard->rc = zmq::device (shard->insocket, shard->outsocket);
+    shard->err = errno;
+}
+
+int zmq::device (class socket_base_t **insockets_,
+    class socket_base_t **outsockets_, int count_)
+{
+    device_shard_t *shards = new (std::nothrow) device_shard_t [count_];
+    alloc_assert (shards);
+
+    for (int i = 0; i != count_; i++) {
+        shards [i].insocket = insockets_ [i];
+        shards [i].outsocket = outsockets_ [i];
+        shards [i].rc = 0;
+        shards [i].err = 0;
+    }
+
+    //  The first pair of sockets is served by the calling thread, each of
+    //  the others by a thread of its own. Starting the thread acts as
+    //  a full memory barrier, so the sockets can be migrated safely.
+    for (int i = 1; i != count_; i++)
+        shards [i].thread.start (device_routine, &shards [i]);
+    device_routine (&shards [0]);
+    for (int i = 1; i != count_; i++)
+        shards [i].thread.stop ();
+
+    //  Report the first error encountered.
+    int rc = 0;
+    int err = 0;
+    for (int i = 0; i != count_; i++) {
+        if (shards [i].rc != 0) {
+            rc = shards [i].rc;
+            err = shards [i].err;
+            break;
+        }
+    }
+
+    delete [] shards;
+    errno = err;
+    return rc;
+}
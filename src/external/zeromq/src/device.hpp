@@ -27,6 +27,11 @@ namespace zmq
     int device (class socket_base_t *insocket_,
         class socket_base_t *outsocket_);
 
+    //  Runs count_ devices in parallel, one per pair of sockets. The first
+    //  one runs in the calling thread. Returns when all of them are done.
+    int device (class socket_base_t **insockets_,
+        class socket_base_t **outsockets_, int count_);
+
 }
 
 #endif
@@ -28,6 +28,7 @@
 #include "likely.hpp"
 
 zmq::dist_t::dist_t (own_t *sink_) :
+    matching (0),
     active (0),
     eligible (0),
     more (false),
@@ -41,9 +42,9 @@ zmq::dist_t::~dist_t ()
     zmq_assert (pipes.empty ());
 }
 
-void zmq::dist_t::attach (writer_t *pipe_)
+void zmq::dist_t::attach (writer_t *pipe_, i_writer_events *events_)
 {
-    pipe_->set_event_sink (this);
+    pipe_->set_event_sink (events_ ? events_ : this);
 
     //  If we are in the middle of sending a message, we'll add new pipe
     //  into the list of eligible pipes. Otherwise we add it to the list
@@ -78,8 +79,10 @@ void zmq::dist_t::terminate ()
 
 void zmq::dist_t::terminated (writer_t *pipe_)
 {
-    //  Remove the pipe from the list; adjust number of active and/or
+    //  Remove the pipe from the list; adjust number of matching, active and/or
     //  eligible pipes accordingly.
+    if (pipes.index (pipe_) < matching)
+        matching--;
     if (pipes.index (pipe_) < active)
         active--;
     if (pipes.index (pipe_) < eligible)
@@ -104,12 +107,39 @@ void zmq::dist_t::activated (writer_t *pipe_)
     }
 }
 
+void zmq::dist_t::match (writer_t *pipe_)
+{
+    //  If pipe is already matching do nothing.
+    if (pipes.index (pipe_) < matching)
+        return;
+
+    //  If the pipe isn't active, ignore it.
+    if (pipes.index (pipe_) >= active)
+        return;
+
+    //  Mark the pipe as matching.
+    pipes.swap (pipes.index (pipe_), matching);
+    matching++;
+}
+
+void zmq::dist_t::unmatch ()
+{
+    matching = 0;
+}
+
 int zmq::dist_t::send (zmq_msg_t *msg_, int flags_)
+{
+    //  Send the message to all the pipes that are active.
+    matching = active;
+    return send_to_matching (msg_, flags_);
+}
+
+int zmq::dist_t::send_to_matching (zmq_msg_t *msg_, int flags_)
 {
     //  Is this end of a multipart message?
     bool msg_more = msg_->flags & ZMQ_MSG_MORE;
 
-    //  Push the message to active pipes.
+    //  Push the message to matching pipes.
     distribute (msg_, flags_);
 
     //  If multipart message is fully sent, activate all the eligible pipes.
@@ -123,8 +153,8 @@ int zmq::dist_t::send (zmq_msg_t *msg_, int flags_)
 
 void zmq::dist_t::distribute (zmq_msg_t *msg_, int flags_)
 {
-    //  If there are no active pipes available, simply drop the message.
-    if (active == 0) {
+    //  If there are no matching pipes available, simply drop the message.
+    if (matching == 0) {
         int rc = zmq_msg_close (msg_);
         zmq_assert (rc == 0);
         rc = zmq_msg_init (msg_);
@@ -136,7 +166,7 @@ void zmq::dist_t::distribute (zmq_msg_t *msg_, int flags_)
 
     //  For VSMs the copying is straighforward.
     if (content == (msg_content_t*) ZMQ_VSM) {
-        for (pipes_t::size_type i = 0; i < active;)
+        for (pipes_t::size_type i = 0; i < matching;)
             if (write (pipes [i], msg_))
                 i++;
         int rc = zmq_msg_init (msg_);
@@ -147,7 +177,7 @@ void zmq::dist_t::distribute (zmq_msg_t *msg_, int flags_)
     //  Optimisation for the case when there's only a single pipe
     //  to send the message to - no refcount adjustment i.e. no atomic
     //  operations are needed.
-    if (active == 1) {
+    if (matching == 1) {
         if (!write (pipes [0], msg_)) {
             int rc = zmq_msg_close (msg_);
             zmq_assert (rc == 0);
@@ -161,14 +191,14 @@ void zmq::dist_t::distribute (zmq_msg_t *msg_, int flags_)
     //  to deal with reference counting. First add N-1 references to
     //  the content (we are holding one reference anyway, that's why -1).
     if (msg_->flags & ZMQ_MSG_SHARED)
-        content->refcnt.add (active - 1);
+        content->refcnt.add (matching - 1);
     else {
-        content->refcnt.set (active);
+        content->refcnt.set (matching);
         msg_->flags |= ZMQ_MSG_SHARED;
     }
 
     //  Push the message to all destinations.
-    for (pipes_t::size_type i = 0; i < active;) {
+    for (pipes_t::size_type i = 0; i < matching;) {
         if (!write (pipes [i], msg_))
             content->refcnt.sub (1);
         else
@@ -188,6 +218,8 @@ bool zmq::dist_t::has_out ()
 bool zmq::dist_t::write (class writer_t *pipe_, zmq_msg_t *msg_)
 {
     if (!pipe_->write (msg_)) {
+        pipes.swap (pipes.index (pipe_), matching - 1);
+        matching--;
         pipes.swap (pipes.index (pipe_), active - 1);
         active--;
         pipes.swap (active, eligible - 1);
@@ -38,9 +38,25 @@ namespace zmq
         dist_t (class own_t *sink_);
         ~dist_t ();
 
-        void attach (writer_t *pipe_);
+        //  Pipe events go to the distributor itself unless events_ is
+        //  specified. In that case it's up to the object receiving the
+        //  events to pass them on to the distributor.
+        void attach (writer_t *pipe_, i_writer_events *events_ = NULL);
         void terminate ();
+
+        //  Mark the pipe as matching. Subsequent call to send_to_matching
+        //  will send message also to this pipe.
+        void match (writer_t *pipe_);
+
+        //  Mark all pipes as non-matching.
+        void unmatch ();
+
+        //  Send the message to all the outbound pipes.
         int send (zmq_msg_t *msg_, int flags_);
+
+        //  Send the message to the matching outbound pipes.
+        int send_to_matching (zmq_msg_t *msg_, int flags_);
+
         bool has_out ();
 
         //  i_writer_events interface implementation.
@@ -53,13 +69,18 @@ namespace zmq
         //  fails. In such a case false is returned.
         bool write (class writer_t *pipe_, zmq_msg_t *msg_);
 
-        //  Put the message to all active pipes.
+        //  Put the message to all matching pipes.
         void distribute (zmq_msg_t *msg_, int flags_);
 
         //  List of outbound pipes.
         typedef array_t <class writer_t> pipes_t;
         pipes_t pipes;
 
+        //  Number of all the pipes to send the next message to. All the
+        //  matching pipes are located at the beginning of the pipes array,
+        //  within the active ones.
+        pipes_t::size_type matching;
+
         //  Number of active pipes. All the active pipes are located at the
         //  beginning of the pipes array. These are the pipes the messages
         //  can be sent to at the moment.
@@ -24,7 +24,8 @@
 
 zmq::encoder_t::encoder_t (size_t bufsize_) :
     encoder_base_t <encoder_t> (bufsize_),
-    source (NULL)
+    source (NULL),
+    retained_count (0)
 {
     zmq_msg_init (&in_progress);
 
@@ -34,6 +35,7 @@ zmq::encoder_t::encoder_t (size_t bufsize_) :
 
 zmq::encoder_t::~encoder_t ()
 {
+    release ();
     zmq_msg_close (&in_progress);
 }
 
@@ -42,6 +44,26 @@ void zmq::encoder_t::set_inout (i_inout *source_)
     source = source_;
 }
 
+bool zmq::encoder_t::retain ()
+{
+    //  Message bodies are only referenced when they are larger than
+    //  max_vsm_size, so the copy shares the message content.
+    if (retained_count == out_batch_iov)
+        return false;
+    zmq_msg_init (&retained [retained_count]);
+    int rc = zmq_msg_copy (&retained [retained_count], &in_progress);
+    errno_assert (rc == 0);
+    retained_count++;
+    return true;
+}
+
+void zmq::encoder_t::release ()
+{
+    for (int i = 0; i != retained_count; i++)
+        zmq_msg_close (&retained [i]);
+    retained_count = 0;
+}
+
 bool zmq::encoder_t::size_ready ()
 {
     //  Write message body into the buffer.
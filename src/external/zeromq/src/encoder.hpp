@@ -27,6 +27,8 @@
 #include <algorithm>
 
 #include "err.hpp"
+#include "fd.hpp"
+#include "config.hpp"
 
 #include "../include/zmq.h"
 
@@ -124,6 +126,70 @@ namespace zmq
             }
         }
 
+        //  The function returns a batch of binary data as a vector of up to
+        //  *iovcnt_ chunks, stopping once the batch reaches size_max_ bytes.
+        //  Small chunks are copied into the encoder's buffer while chunks of
+        //  at least out_batch_copy_min bytes are referenced in place; the
+        //  derived class has to retain their messages (retain function)
+        //  until the whole batch is written.
+        inline void get_iovec (iovec *iov_, int *iovcnt_, size_t *size_,
+            size_t size_max_)
+        {
+            int iovcnt = 0;
+            size_t pos = 0;
+            size_t size = 0;
+
+            while (size < size_max_) {
+
+                //  If there are no more data to return, run the state machine.
+                if (!to_write) {
+                    if (!(static_cast <T*> (this)->*next) ())
+                        break;
+                    beginning = false;
+                    continue;
+                }
+
+                //  Large chunks are written directly from the message.
+                if (to_write >= out_batch_copy_min) {
+                    if (iovcnt == *iovcnt_ ||
+                          !static_cast <T*> (this)->retain ())
+                        break;
+                    iov_ [iovcnt].iov_base = write_pos;
+                    iov_ [iovcnt].iov_len = to_write;
+                    iovcnt++;
+                    size += to_write;
+                    write_pos = NULL;
+                    to_write = 0;
+                    continue;
+                }
+
+                //  Copy data to the buffer, extending the last chunk if it
+                //  ends where the copied data start. If the buffer is full,
+                //  return.
+                size_t to_copy = std::min (to_write, bufsize - pos);
+                if (!to_copy)
+                    break;
+                if (iovcnt && (unsigned char*) iov_ [iovcnt - 1].iov_base +
+                      iov_ [iovcnt - 1].iov_len == buf + pos)
+                    iov_ [iovcnt - 1].iov_len += to_copy;
+                else {
+                    if (iovcnt == *iovcnt_)
+                        break;
+                    iov_ [iovcnt].iov_base = buf + pos;
+                    iov_ [iovcnt].iov_len = to_copy;
+                    iovcnt++;
+                }
+                memcpy (buf + pos, write_pos, to_copy);
+                pos += to_copy;
+                size += to_copy;
+                write_pos += to_copy;
+                to_write -= to_copy;
+            }
+
+            *iovcnt_ = iovcnt;
+            *size_ = size;
+        }
+
     protected:
 
         //  Prototype of state machine action.
@@ -166,6 +232,14 @@ namespace zmq
 
         void set_inout (struct i_inout *source_);
 
+        //  Keeps the message in progress alive while its data are referenced
+        //  by a batch returned from get_iovec. Returns false if no more
+        //  messages can be retained.
+        bool retain ();
+
+        //  Releases the messages retained for the last batch.
+        void release ();
+
     private:
 
         bool size_ready ();
@@ -175,6 +249,10 @@ namespace zmq
         ::zmq_msg_t in_progress;
         unsigned char tmpbuf [10];
 
+        //  Messages referenced by the last batch returned from get_iovec.
+        ::zmq_msg_t retained [out_batch_iov];
+        int retained_count;
+
         encoder_t (const encoder_t&);
         const encoder_t &operator = (const encoder_t&);
     };
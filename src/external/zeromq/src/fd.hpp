@@ -25,6 +25,17 @@
 
 #ifdef ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
+#else
+#include <sys/uio.h>
+#endif
+
+#ifdef ZMQ_HAVE_WINDOWS
+//  Buffer descriptor for vectored socket writes (converted to WSABUF).
+struct iovec
+{
+    void *iov_base;
+    size_t iov_len;
+};
 #endif
 
 namespace zmq
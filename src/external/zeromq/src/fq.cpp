@@ -24,10 +24,12 @@
 #include "pipe.hpp"
 #include "err.hpp"
 #include "own.hpp"
+#include "config.hpp"
 
 zmq::fq_t::fq_t (own_t *sink_) :
     active (0),
     current (0),
+    credited (NULL),
     more (false),
     sink (sink_),
     terminating (false)
@@ -62,6 +64,8 @@ void zmq::fq_t::terminated (reader_t *pipe_)
 
     //  Remove the pipe from the list; adjust number of active pipes
     //  accordingly.
+    if (pipe_ == credited)
+        credited = NULL;
     if (pipes.index (pipe_) < active) {
         active--;
         if (current == active)
@@ -99,12 +103,28 @@ int zmq::fq_t::recv (zmq_msg_t *msg_, int flags_)
     //  Deallocate old content of the message.
     zmq_msg_close (msg_);
 
-    //  Round-robin over the pipes to get the next message.
-    for (int count = active; count != 0; count--) {
+    //  Round-robin over the pipes to get the next message. The current pipe
+    //  keeps its turn until it has used up its credit.
+    int count = active;
+    while (count != 0) {
+
+        //  Start the turn of the current pipe. A pipe that is still in debt
+        //  from its previous turns passes the turn without reading.
+        reader_t *pipe = pipes [current];
+        if (pipe != credited) {
+            credited = pipe;
+            if (!pipe->start_turn (fq_quantum)) {
+                credited = NULL;
+                current++;
+                if (current >= active)
+                    current = 0;
+                continue;
+            }
+        }
 
         //  Try to fetch new message. If we've already read part of the message
         //  subsequent part should be immediately available.
-        bool fetched = pipes [current]->read (msg_);
+        bool fetched = pipe->read (msg_);
 
         //  Check the atomicity of the message. If we've already received the
         //  first part of the message we should get the remaining parts
@@ -116,7 +136,8 @@ int zmq::fq_t::recv (zmq_msg_t *msg_, int flags_)
         //  the 'current' pointer.
         if (fetched) {
             more = msg_->flags & ZMQ_MSG_MORE;
-            if (!more) {
+            if (!pipe->charge (zmq_msg_size (msg_)) && !more) {
+                credited = NULL;
                 current++;
                 if (current >= active)
                     current = 0;
@@ -124,10 +145,13 @@ int zmq::fq_t::recv (zmq_msg_t *msg_, int flags_)
             return 0;
         }
         else {
+            pipe->end_turn ();
+            credited = NULL;
             active--;
             pipes.swap (current, active);
             if (current == active)
                 current = 0;
+            count--;
         }
     }
 
@@ -153,6 +177,9 @@ bool zmq::fq_t::has_in ()
             return true;
 
         //  Deactivate the pipe.
+        pipes [current]->end_turn ();
+        if (pipes [current] == credited)
+            credited = NULL;
         active--;
         pipes.swap (current, active);
         if (current == active)
@@ -29,7 +29,11 @@ namespace zmq
 
     //  Class manages a set of inbound pipes. On receive it performs fair
     //  queueing (RFC970) so that senders gone berserk won't cause denial of
-    //  service for decent senders.
+    //  service for decent senders. The pipes are served in deficit round
+    //  robin: each turn credits the pipe with fq_quantum bytes times its
+    //  weight and lasts until the credit is used up or the pipe runs out
+    //  of messages. A message is always delivered whole; what it overruns
+    //  is paid back from the pipe's following turns.
     class fq_t : public i_reader_events
     {
     public:
@@ -61,6 +65,9 @@ namespace zmq
         //  Index of the next bound pipe to read a message from.
         pipes_t::size_type current;
 
+        //  The pipe whose turn is in progress, if any.
+        reader_t *credited;
+
         //  If true, part of a multipart message was already received, but
         //  there are following parts still waiting in the current pipe.
         bool more;
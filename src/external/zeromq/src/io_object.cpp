@@ -81,6 +81,22 @@ void zmq::io_object_t::reset_pollout (handle_t handle_)
     poller->reset_pollout (handle_);
 }
 
+#if defined ZMQ_FORCE_IO_URING
+
+void zmq::io_object_t::async_recv (handle_t handle_, void *buf_,
+    size_t size_, int *result_)
+{
+    poller->async_recv (handle_, buf_, size_, result_);
+}
+
+void zmq::io_object_t::async_writev (handle_t handle_, const iovec *iov_,
+    int iovcnt_, int *result_)
+{
+    poller->async_writev (handle_, iov_, iovcnt_, result_);
+}
+
+#endif
+
 void zmq::io_object_t::add_timer (int timeout_, int id_)
 {
     poller->add_timer (timeout_, this, id_);
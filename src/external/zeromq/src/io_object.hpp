@@ -57,6 +57,12 @@ namespace zmq
         void reset_pollin (handle_t handle_);
         void set_pollout (handle_t handle_);
         void reset_pollout (handle_t handle_);
+#if defined ZMQ_FORCE_IO_URING
+        void async_recv (handle_t handle_, void *buf_, size_t size_,
+            int *result_);
+        void async_writev (handle_t handle_, const iovec *iov_, int iovcnt_,
+            int *result_);
+#endif
         void add_timer (int timout_, int id_);
         void cancel_timer (int id_);
 
@@ -0,0 +1,635 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_LINUX && defined ZMQ_FORCE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+
+#include "io_uring.hpp"
+#include "err.hpp"
+#include "config.hpp"
+#include "i_poll_events.hpp"
+
+//  The low bits of the user data of a request tell what it is for. Zero
+//  user data marks the requests that remove or cancel other requests.
+enum
+{
+    tag_poll = 1,
+    tag_recv = 2,
+    tag_send = 3,
+    tag_mask = 3
+};
+
+zmq::io_uring_t::io_uring_t () :
+    ring_fd (retired_fd),
+    epoll_fd (retired_fd),
+    sq_pending (0),
+    stopping (false)
+{
+    if (!setup_ring ()) {
+        epoll_fd = epoll_create (1);
+        errno_assert (epoll_fd != -1);
+    }
+}
+
+zmq::io_uring_t::~io_uring_t ()
+{
+    //  Wait till the worker thread exits.
+    worker.stop ();
+
+    if (ring_fd != retired_fd) {
+        munmap (sqes, sqes_size);
+        if (cq_size)
+            munmap (cq_ptr, cq_size);
+        munmap (sq_ptr, sq_size);
+        close (ring_fd);
+    }
+    else
+        close (epoll_fd);
+    for (retired_t::iterator it = retired.begin (); it != retired.end (); ++it)
+        delete *it;
+}
+
+bool zmq::io_uring_t::setup_ring ()
+{
+    io_uring_params params;
+    memset (&params, 0, sizeof (params));
+    int fd = (int) syscall (__NR_io_uring_setup, max_io_events, &params);
+    if (fd == -1)
+        return false;
+
+    //  Timeouts are passed directly to io_uring_enter, and completions
+    //  must not be dropped when the completion ring is full.
+    if (!(params.features & IORING_FEAT_EXT_ARG) ||
+          !(params.features & IORING_FEAT_NODROP)) {
+        close (fd);
+        return false;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+    cq_size = params.cq_off.cqes +
+        params.cq_entries * sizeof (io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size)
+            sq_size = cq_size;
+        cq_size = 0;
+    }
+
+    sq_ptr = mmap (NULL, sq_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        close (fd);
+        return false;
+    }
+    if (cq_size) {
+        cq_ptr = mmap (NULL, cq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            munmap (sq_ptr, sq_size);
+            close (fd);
+            return false;
+        }
+    }
+    else
+        cq_ptr = sq_ptr;
+    sqes_size = params.sq_entries * sizeof (io_uring_sqe);
+    sqes = (io_uring_sqe*) mmap (NULL, sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_size)
+            munmap (cq_ptr, cq_size);
+        munmap (sq_ptr, sq_size);
+        close (fd);
+        return false;
+    }
+
+    unsigned char *sq = (unsigned char*) sq_ptr;
+    sq_head = (unsigned*) (sq + params.sq_off.head);
+    sq_tail = (unsigned*) (sq + params.sq_off.tail);
+    sq_array = (unsigned*) (sq + params.sq_off.array);
+    sq_mask = *(unsigned*) (sq + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+
+    unsigned char *cq = (unsigned char*) cq_ptr;
+    cq_head = (unsigned*) (cq + params.cq_off.head);
+    cq_tail = (unsigned*) (cq + params.cq_off.tail);
+    cq_mask = *(unsigned*) (cq + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    ring_fd = fd;
+    return true;
+}
+
+zmq::io_uring_t::handle_t zmq::io_uring_t::add_fd (fd_t fd_,
+    i_poll_events *events_)
+{
+    poll_entry_t *pe = new (std::nothrow) poll_entry_t;
+    alloc_assert (pe);
+
+    //  The memset is not actually needed. It's here to prevent debugging
+    //  tools to complain about using uninitialised memory.
+    memset (pe, 0, sizeof (poll_entry_t));
+
+    pe->fd = fd_;
+    pe->events = events_;
+
+    if (epoll_fd != retired_fd) {
+        epoll_event ev;
+        ev.events = 0;
+        ev.data.ptr = pe;
+        int rc = epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd_, &ev);
+        errno_assert (rc != -1);
+    }
+
+    //  Increase the load metric of the thread.
+    adjust_load (1);
+
+    return pe;
+}
+
+void zmq::io_uring_t::rm_fd (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+
+    //  The buffers of the requests belong to the owner, so the kernel has
+    //  to be done with them before the owner gets the control back.
+    bool submitted = cancel (pe, pe->recv, POLLIN);
+    submitted = cancel (pe, pe->send, POLLOUT) || submitted;
+    if (submitted) {
+        while (pe->recv.result || pe->send.result) {
+            enter (true, 0);
+            reap ();
+        }
+    }
+
+    if (epoll_fd != retired_fd) {
+        epoll_event ev;
+        int rc = epoll_ctl (epoll_fd, EPOLL_CTL_DEL, pe->fd, &ev);
+        errno_assert (rc != -1);
+        pe->armed_mask = 0;
+    }
+
+    //  The entry is destroyed once the kernel no longer references it.
+    else if (pe->armed_mask && !pe->cancelling) {
+        io_uring_sqe *sqe = get_sqe ();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t) (uintptr_t) pe | tag_poll;
+        sqe->user_data = 0;
+        pe->cancelling = true;
+    }
+    pe->fd = retired_fd;
+    pe->events_mask = 0;
+    retired.push_back (pe);
+
+    //  Decrease the load metric of the thread.
+    adjust_load (-1);
+}
+
+void zmq::io_uring_t::set_pollin (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->events_mask |= POLLIN;
+    change (pe);
+}
+
+void zmq::io_uring_t::reset_pollin (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->events_mask &= ~((unsigned int) POLLIN);
+    change (pe);
+}
+
+void zmq::io_uring_t::set_pollout (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->events_mask |= POLLOUT;
+    change (pe);
+}
+
+void zmq::io_uring_t::reset_pollout (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->events_mask &= ~((unsigned int) POLLOUT);
+    change (pe);
+}
+
+void zmq::io_uring_t::async_recv (handle_t handle_, void *buf_,
+    size_t size_, int *result_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    zmq_assert (!pe->recv.result);
+    pe->recv.result = result_;
+    pe->recv.buf = buf_;
+    pe->recv.size = size_;
+    *result_ = request_pending;
+    change (pe);
+}
+
+void zmq::io_uring_t::async_writev (handle_t handle_, const iovec *iov_,
+    int iovcnt_, int *result_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    zmq_assert (!pe->send.result);
+    pe->send.result = result_;
+    memset (&pe->send.msg, 0, sizeof (msghdr));
+    pe->send.msg.msg_iov = (iovec*) iov_;
+    pe->send.msg.msg_iovlen = iovcnt_;
+    *result_ = request_pending;
+    change (pe);
+}
+
+void zmq::io_uring_t::start ()
+{
+    worker.start (worker_routine, this);
+}
+
+void zmq::io_uring_t::stop ()
+{
+    stopping = true;
+}
+
+void zmq::io_uring_t::change (poll_entry_t *pe_)
+{
+    if (!pe_->changed) {
+        pe_->changed = true;
+        changed.push_back (pe_);
+    }
+}
+
+void zmq::io_uring_t::make_ready (poll_entry_t *pe_)
+{
+    if (!pe_->ready) {
+        pe_->ready = true;
+        ready.push_back (pe_);
+    }
+}
+
+void zmq::io_uring_t::arm ()
+{
+    //  Entries can be added while arming, as requests performed straight
+    //  away in epoll mode complete here.
+    for (changed_t::size_type i = 0; i != changed.size (); i++) {
+        poll_entry_t *pe = changed [i];
+        pe->changed = false;
+        if (pe->fd == retired_fd)
+            continue;
+        if (epoll_fd != retired_fd) {
+            arm_epoll (pe);
+            continue;
+        }
+
+        if (pe->recv.result && !pe->recv.submitted) {
+            io_uring_sqe *sqe = get_sqe ();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = pe->fd;
+            sqe->addr = (uint64_t) (uintptr_t) pe->recv.buf;
+            sqe->len = (unsigned) pe->recv.size;
+            sqe->user_data = (uint64_t) (uintptr_t) pe | tag_recv;
+            pe->recv.submitted = true;
+        }
+        if (pe->send.result && !pe->send.submitted) {
+            io_uring_sqe *sqe = get_sqe ();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = pe->fd;
+            sqe->addr = (uint64_t) (uintptr_t) &pe->send.msg;
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            sqe->user_data = (uint64_t) (uintptr_t) pe | tag_send;
+            pe->send.submitted = true;
+        }
+        if (pe->cancelling)
+            continue;
+
+        //  Events that are no longer wanted are filtered out when the
+        //  armed request completes. Only when new events are wanted the
+        //  armed request has to be cancelled; it is re-armed with the
+        //  full mask once its completion arrives.
+        if (pe->armed_mask) {
+            if (pe->events_mask & ~pe->armed_mask) {
+                io_uring_sqe *sqe = get_sqe ();
+                sqe->opcode = IORING_OP_POLL_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = (uint64_t) (uintptr_t) pe | tag_poll;
+                sqe->user_data = 0;
+                pe->cancelling = true;
+            }
+        }
+        else if (pe->events_mask) {
+            io_uring_sqe *sqe = get_sqe ();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = pe->fd;
+            sqe->poll32_events = pe->events_mask;
+            sqe->user_data = (uint64_t) (uintptr_t) pe | tag_poll;
+            pe->armed_mask = pe->events_mask;
+        }
+    }
+    changed.clear ();
+}
+
+void zmq::io_uring_t::arm_epoll (poll_entry_t *pe_)
+{
+    //  Try the requests straight away, the fd is likely to be ready.
+    if (pe_->recv.result)
+        perform (pe_, pe_->recv, POLLIN);
+    if (pe_->send.result)
+        perform (pe_, pe_->send, POLLOUT);
+
+    //  Requests that are left wait for the fd to become ready.
+    unsigned int mask = pe_->events_mask;
+    if (pe_->recv.result)
+        mask |= POLLIN;
+    if (pe_->send.result)
+        mask |= POLLOUT;
+    if (mask != pe_->armed_mask) {
+        epoll_event ev;
+        ev.events = mask;
+        ev.data.ptr = pe_;
+        int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, pe_->fd, &ev);
+        errno_assert (rc != -1);
+        pe_->armed_mask = mask;
+    }
+}
+
+void zmq::io_uring_t::perform (poll_entry_t *pe_, request_t &request_,
+    unsigned int event_)
+{
+    ssize_t nbytes;
+    if (event_ == POLLIN)
+        nbytes = recv (pe_->fd, request_.buf, request_.size, MSG_DONTWAIT);
+    else
+        nbytes = sendmsg (pe_->fd, &request_.msg,
+            MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+    complete (pe_, request_, event_, nbytes == -1 ? -errno : (int) nbytes);
+}
+
+void zmq::io_uring_t::complete (poll_entry_t *pe_, request_t &request_,
+    unsigned int event_, int result_)
+{
+    *request_.result = result_;
+    request_.result = NULL;
+    request_.submitted = false;
+    pe_->completed |= event_;
+    change (pe_);
+    make_ready (pe_);
+}
+
+bool zmq::io_uring_t::cancel (poll_entry_t *pe_, request_t &request_,
+    unsigned int event_)
+{
+    if (!request_.result)
+        return false;
+    if (!request_.submitted) {
+        complete (pe_, request_, event_, -ECANCELED);
+        return false;
+    }
+    io_uring_sqe *sqe = get_sqe ();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t) (uintptr_t) pe_ |
+        (event_ == POLLIN ? tag_recv : tag_send);
+    sqe->user_data = 0;
+    return true;
+}
+
+io_uring_sqe *zmq::io_uring_t::get_sqe ()
+{
+    unsigned tail = *sq_tail;
+    if (tail - __atomic_load_n (sq_head, __ATOMIC_ACQUIRE) == sq_entries) {
+        enter (false, 0);
+        tail = *sq_tail;
+        zmq_assert (tail - __atomic_load_n (sq_head, __ATOMIC_ACQUIRE) <
+            sq_entries);
+    }
+
+    unsigned index = tail & sq_mask;
+    io_uring_sqe *sqe = &sqes [index];
+    memset (sqe, 0, sizeof (io_uring_sqe));
+    sq_array [index] = index;
+    __atomic_store_n (sq_tail, tail + 1, __ATOMIC_RELEASE);
+    sq_pending++;
+    return sqe;
+}
+
+void zmq::io_uring_t::enter (bool wait_, int timeout_)
+{
+    unsigned flags = 0;
+    void *arg = NULL;
+    size_t arg_size = 0;
+    io_uring_getevents_arg getevents_arg;
+    __kernel_timespec ts;
+
+    if (wait_) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_) {
+            ts.tv_sec = timeout_ / 1000;
+            ts.tv_nsec = (timeout_ % 1000) * 1000000;
+            memset (&getevents_arg, 0, sizeof (getevents_arg));
+            getevents_arg.sigmask_sz = _NSIG / 8;
+            getevents_arg.ts = (uint64_t) (uintptr_t) &ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            arg = &getevents_arg;
+            arg_size = sizeof (getevents_arg);
+        }
+    }
+
+    while (true) {
+        int rc = (int) syscall (__NR_io_uring_enter, ring_fd, sq_pending,
+            wait_ ? 1 : 0, flags, arg, arg_size);
+        if (rc >= 0) {
+            sq_pending -= rc;
+            if (!sq_pending)
+                return;
+
+            //  Submit the rest without waiting again.
+            wait_ = false;
+            flags = 0;
+            arg = NULL;
+            arg_size = 0;
+            continue;
+        }
+        if (errno == ETIME)
+            return;
+        if (errno == EINTR) {
+            if (wait_)
+                return;
+            continue;
+        }
+        errno_assert (errno == EAGAIN || errno == EBUSY);
+
+        //  The completion ring is full. Let the caller drain it.
+        return;
+    }
+}
+
+void zmq::io_uring_t::reap ()
+{
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        io_uring_cqe *cqe = &cqes [head & cq_mask];
+        unsigned int tag = (unsigned int) (cqe->user_data & tag_mask);
+        poll_entry_t *pe = (poll_entry_t*) (uintptr_t)
+            (cqe->user_data & ~((uint64_t) tag_mask));
+        int res = cqe->res;
+
+        //  The requests are complete as soon as the kernel is done with
+        //  them, even if their owner has to wait till dispatch.
+        if (tag == tag_recv)
+            complete (pe, pe->recv, POLLIN, res);
+        else if (tag == tag_send)
+            complete (pe, pe->send, POLLOUT, res);
+
+        //  The one-shot poll request is gone; re-arm with what is wanted now.
+        else if (tag == tag_poll) {
+            pe->armed_mask = 0;
+            pe->cancelling = false;
+            if (pe->fd == retired_fd)
+                continue;
+            change (pe);
+            if (res > 0) {
+                pe->revents |= res;
+                make_ready (pe);
+            }
+        }
+    }
+    __atomic_store_n (cq_head, head, __ATOMIC_RELEASE);
+}
+
+void zmq::io_uring_t::wait_epoll (int timeout_)
+{
+    epoll_event ev_buf [max_io_events];
+
+    //  Don't wait if some requests are done already.
+    int n = epoll_wait (epoll_fd, &ev_buf [0], max_io_events,
+        !ready.empty () ? 0 : timeout_ ? timeout_ : -1);
+    if (n == -1 && errno == EINTR)
+        return;
+    errno_assert (n != -1);
+
+    for (int i = 0; i < n; i ++) {
+        poll_entry_t *pe = ((poll_entry_t*) ev_buf [i].data.ptr);
+        unsigned int events = ev_buf [i].events;
+
+        if (pe->fd == retired_fd)
+            continue;
+        if (pe->recv.result && (events & (POLLIN | POLLERR | POLLHUP)))
+            perform (pe, pe->recv, POLLIN);
+        if (pe->send.result && (events & (POLLOUT | POLLERR | POLLHUP)))
+            perform (pe, pe->send, POLLOUT);
+        if (events & (pe->events_mask | POLLERR | POLLHUP)) {
+            pe->revents |= events;
+            make_ready (pe);
+        }
+    }
+}
+
+void zmq::io_uring_t::dispatch ()
+{
+    //  Entries can be added while dispatching, as rm_fd waits for the
+    //  completion of cancelled requests.
+    for (ready_t::size_type i = 0; i != ready.size (); i++) {
+        poll_entry_t *pe = ready [i];
+        unsigned int revents = pe->revents;
+        unsigned int completed = pe->completed;
+        pe->revents = 0;
+        pe->completed = 0;
+        pe->ready = false;
+
+        if (pe->fd == retired_fd)
+            continue;
+        if (revents & (POLLERR | POLLHUP))
+            pe->events->in_event ();
+        if (pe->fd == retired_fd)
+           continue;
+        if ((revents & pe->events_mask & POLLOUT) || (completed & POLLOUT))
+            pe->events->out_event ();
+        if (pe->fd == retired_fd)
+            continue;
+        if ((revents & pe->events_mask & POLLIN) || (completed & POLLIN))
+            pe->events->in_event ();
+    }
+    ready.clear ();
+}
+
+void zmq::io_uring_t::loop ()
+{
+    while (!stopping) {
+
+        //  Execute any due timers.
+        int timeout = (int) execute_timers ();
+
+        //  Queue the requests the last iteration asked for.
+        arm ();
+
+        if (epoll_fd != retired_fd)
+            wait_epoll (timeout);
+        else {
+
+            //  Submit the requests together with the wait for completions,
+            //  unless there is something to dispatch already.
+            bool wait = ready.empty () &&
+                *cq_head == __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE);
+            if (wait || sq_pending)
+                enter (wait, timeout);
+            reap ();
+
+            //  If the completion ring was full, submit the rest now that
+            //  there is room.
+            while (sq_pending) {
+                enter (false, 0);
+                reap ();
+            }
+        }
+
+        dispatch ();
+
+        //  Destroy retired event sources the kernel no longer refers to.
+        retired_t::size_type kept = 0;
+        for (retired_t::size_type i = 0; i != retired.size (); i++) {
+            poll_entry_t *pe = retired [i];
+            if (pe->armed_mask || pe->changed || pe->ready)
+                retired [kept++] = pe;
+            else
+                delete pe;
+        }
+        retired.resize (kept);
+    }
+}
+
+void zmq::io_uring_t::worker_routine (void *arg_)
+{
+    ((io_uring_t*) arg_)->loop ();
+}
+
+#endif
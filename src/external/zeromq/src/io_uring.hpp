@@ -0,0 +1,251 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_IO_URING_HPP_INCLUDED__
+#define __ZMQ_IO_URING_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_LINUX && defined ZMQ_FORCE_IO_URING
+
+#include <vector>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "fd.hpp"
+#include "thread.hpp"
+#include "poller_base.hpp"
+
+namespace zmq
+{
+
+    //  This class implements socket polling mechanism using the Linux-specific
+    //  io_uring interface. Readiness is requested with one-shot poll
+    //  requests that are queued in the submission ring when the poll set
+    //  changes and are submitted in a single batch together with the wait
+    //  for completions, so changing the poll set costs no system call.
+    //
+    //  Engines don't poll; they queue their reads and writes with
+    //  async_recv and async_writev instead. The requests are submitted in
+    //  the same batch, so a single io_uring_enter call does the I/O of all
+    //  the connections of the thread. Once a request completes, its result
+    //  (the number of bytes or -errno) is stored where the caller asked and
+    //  in_event or out_event is called.
+    //
+    //  Kernels without a usable io_uring (older than 5.11, or with io_uring
+    //  disabled) get epoll instead, and the requests are done with
+    //  non-blocking system calls once the fd is ready.
+
+    class io_uring_t : public poller_base_t
+    {
+    public:
+
+        typedef void* handle_t;
+
+        //  Values of a request result other than a byte count or -errno.
+        enum
+        {
+            request_none = INT_MIN,
+            request_pending = INT_MIN + 1
+        };
+
+        io_uring_t ();
+        ~io_uring_t ();
+
+        //  "poller" concept.
+        handle_t add_fd (fd_t fd_, struct i_poll_events *events_);
+        void rm_fd (handle_t handle_);
+        void set_pollin (handle_t handle_);
+        void reset_pollin (handle_t handle_);
+        void set_pollout (handle_t handle_);
+        void reset_pollout (handle_t handle_);
+        void start ();
+        void stop ();
+
+        //  Queue a read into buf_ or a write of iov_, at most one of each
+        //  per fd. Until the result is stored to result_ (which rm_fd
+        //  forces, storing -ECANCELED if the request never started) it is
+        //  request_pending, and the buffers have to stay valid.
+        void async_recv (handle_t handle_, void *buf_, size_t size_,
+            int *result_);
+        void async_writev (handle_t handle_, const iovec *iov_, int iovcnt_,
+            int *result_);
+
+    private:
+
+        //  Main worker thread routine.
+        static void worker_routine (void *arg_);
+
+        //  Main event loop.
+        void loop ();
+
+        struct request_t
+        {
+            //  Where to store the result, NULL if there is no request.
+            int *result;
+
+            //  True if the request is in the submission ring.
+            bool submitted;
+
+            //  Buffer of a read.
+            void *buf;
+            size_t size;
+
+            //  Chunks of a write.
+            msghdr msg;
+        };
+
+        struct poll_entry_t
+        {
+            fd_t fd;
+
+            //  Events the owner is interested in.
+            unsigned int events_mask;
+
+            //  Events of the poll request currently in the ring, zero if
+            //  there is none. With epoll, the events registered for the fd.
+            unsigned int armed_mask;
+
+            //  True if the armed poll request is being cancelled.
+            bool cancelling;
+
+            //  True if the entry is in the list of changed entries.
+            bool changed;
+
+            //  Poll events and completed requests (POLLIN for the read,
+            //  POLLOUT for the write) to be dispatched, and whether the
+            //  entry is in the list of ready entries.
+            unsigned int revents;
+            unsigned int completed;
+            bool ready;
+
+            request_t recv;
+            request_t send;
+
+            struct i_poll_events *events;
+        };
+
+        //  Set up the rings, returning false if io_uring can't be used.
+        bool setup_ring ();
+
+        //  Mark the entry as needing its poll request updated.
+        void change (poll_entry_t *pe_);
+
+        //  Add the entry to the list of ready entries.
+        void make_ready (poll_entry_t *pe_);
+
+        //  Queue poll requests and I/O requests for all the changed
+        //  entries.
+        void arm ();
+
+        //  Same with epoll: do the requests and register the events.
+        void arm_epoll (poll_entry_t *pe_);
+
+        //  Do a request with a non-blocking system call. If the fd is not
+        //  ready, the request is left for when it is.
+        void perform (poll_entry_t *pe_, request_t &request_,
+            unsigned int event_);
+
+        //  Store the result of a request.
+        void complete (poll_entry_t *pe_, request_t &request_,
+            unsigned int event_, int result_);
+
+        //  Cancel a request. Returns true if it was submitted, in which case
+        //  its completion has to be waited for.
+        bool cancel (poll_entry_t *pe_, request_t &request_,
+            unsigned int event_);
+
+        //  Get a free submission queue entry, submitting the queued
+        //  entries first if the ring is full.
+        struct io_uring_sqe *get_sqe ();
+
+        //  Submit the queued entries, waiting for at least one completion
+        //  if wait_ is true. Timeout is in milliseconds, zero meaning
+        //  infinite.
+        void enter (bool wait_, int timeout_);
+
+        //  Process all the completions in the completion ring.
+        void reap ();
+
+        //  Wait for events with epoll. Timeout as above.
+        void wait_epoll (int timeout_);
+
+        //  Call the owners of the ready entries.
+        void dispatch ();
+
+        //  The io_uring file descriptor, retired_fd if epoll is used.
+        fd_t ring_fd;
+
+        //  The epoll file descriptor, retired_fd if io_uring is used.
+        fd_t epoll_fd;
+
+        //  Mapped rings.
+        void *sq_ptr;
+        size_t sq_size;
+        void *cq_ptr;
+        size_t cq_size;
+        struct io_uring_sqe *sqes;
+        size_t sqes_size;
+
+        //  Submission ring.
+        unsigned *sq_head;
+        unsigned *sq_tail;
+        unsigned *sq_array;
+        unsigned sq_mask;
+        unsigned sq_entries;
+
+        //  Number of queued entries not yet submitted to the kernel.
+        unsigned sq_pending;
+
+        //  Completion ring.
+        unsigned *cq_head;
+        unsigned *cq_tail;
+        unsigned cq_mask;
+        struct io_uring_cqe *cqes;
+
+        //  List of event sources whose requests need updating.
+        typedef std::vector <poll_entry_t*> changed_t;
+        changed_t changed;
+
+        //  List of event sources with events to dispatch.
+        typedef std::vector <poll_entry_t*> ready_t;
+        ready_t ready;
+
+        //  List of retired event sources.
+        typedef std::vector <poll_entry_t*> retired_t;
+        retired_t retired;
+
+        //  If true, thread is in the process of shutting down.
+        bool stopping;
+
+        //  Handle of the physical thread doing the I/O work.
+        thread_t worker;
+
+        io_uring_t (const io_uring_t&);
+        const io_uring_t &operator = (const io_uring_t&);
+    };
+
+}
+
+#endif
+
+#endif
@@ -25,11 +25,13 @@
 #include "err.hpp"
 #include "own.hpp"
 
-zmq::lb_t::lb_t (own_t *sink_) :
+zmq::lb_t::lb_t (own_t *sink_, const options_t &options_) :
     active (0),
     current (0),
     more (false),
     dropping (false),
+    options (options_),
+    seed ((uint32_t) (size_t) this | 1),
     sink (sink_),
     terminating (false)
 {
@@ -111,6 +113,12 @@ int zmq::lb_t::send (zmq_msg_t *msg_, int flags_)
     }
 
     while (active > 0) {
+
+        //  The pipe is chosen at the start of each message; the remaining
+        //  parts follow the first one.
+        if (!more)
+            select ();
+
         if (pipes [current]->write (msg_)) {
             more = msg_->flags & ZMQ_MSG_MORE;
             break;
@@ -131,7 +139,9 @@ int zmq::lb_t::send (zmq_msg_t *msg_, int flags_)
     }
 
     //  If it's final part of the message we can fluch it downstream and
-    //  continue round-robinning (load balance).
+    //  continue round-robinning (load balance). The other strategies start
+    //  looking from the next pipe as well, so that equally loaded pipes
+    //  are used in turn.
     if (!more) {
         pipes [current]->flush ();
         current = (current + 1) % active;
@@ -172,3 +182,49 @@ bool zmq::lb_t::has_out ()
     return false;
 }
 
+void zmq::lb_t::select ()
+{
+    zmq_assert (active > 0);
+
+    switch (options.balance) {
+
+    case ZMQ_BALANCE_LEAST_QUEUED:
+        {
+            pipes_t::size_type best = current;
+            uint64_t best_depth = pipes [current]->depth ();
+            for (pipes_t::size_type i = 1; i < active && best_depth; i++) {
+                pipes_t::size_type index = (current + i) % active;
+                uint64_t depth = pipes [index]->depth ();
+                if (depth < best_depth) {
+                    best = index;
+                    best_depth = depth;
+                }
+            }
+            current = best;
+        }
+        return;
+
+    case ZMQ_BALANCE_TWO_CHOICES:
+        if (active > 1) {
+            pipes_t::size_type first = random () % active;
+            pipes_t::size_type second = random () % (active - 1);
+            if (second >= first)
+                second++;
+            current = pipes [second]->depth () < pipes [first]->depth () ?
+                second : first;
+        }
+        return;
+
+    default:
+        return;
+    }
+}
+
+uint32_t zmq::lb_t::random ()
+{
+    //  Xorshift generator. Good enough for picking pipes.
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
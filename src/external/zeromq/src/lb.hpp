@@ -23,17 +23,21 @@
 
 #include "array.hpp"
 #include "pipe.hpp"
+#include "options.hpp"
+#include "stdint.hpp"
 
 namespace zmq
 {
 
     //  Class manages a set of outbound pipes. On send it load balances
-    //  messages fairly among the pipes.
+    //  messages among the pipes, using the strategy selected by the
+    //  ZMQ_BALANCE option: round robin, the pipe with the fewest queued
+    //  messages, or the less loaded of two pipes chosen at random.
     class lb_t : public i_writer_events
     {
     public:
 
-        lb_t (class own_t *sink_);
+        lb_t (class own_t *sink_, const options_t &options_);
         ~lb_t ();
 
         void attach (writer_t *pipe_);
@@ -47,6 +51,12 @@ namespace zmq
 
     private:
 
+        //  Chooses the active pipe to send the next message to.
+        void select ();
+
+        //  Returns a pseudo-random number.
+        uint32_t random ();
+
         //  List of outbound pipes.
         typedef array_t <class writer_t> pipes_t;
         pipes_t pipes;
@@ -64,6 +74,13 @@ namespace zmq
         //  True if we are dropping current message.
         bool dropping;
 
+        //  Options of the owning socket. The strategy can be changed at
+        //  any time, so it's looked up on each message.
+        const options_t &options;
+
+        //  State of the generator for the two-choices strategy.
+        uint32_t seed;
+
         //  Object to send events to.
         class own_t *sink;
 
@@ -35,11 +35,6 @@ zmq::mailbox_t::mailbox_t ()
 zmq::mailbox_t::~mailbox_t ()
 {
     //  TODO: Retrieve and deallocate commands inside the cpipe.
-
-    // Work around problem that other threads might still be in our
-    // send() method, by waiting on the mutex before disappearing.
-    sync.lock ();
-    sync.unlock ();
 }
 
 zmq::fd_t zmq::mailbox_t::get_fd ()
@@ -49,10 +44,7 @@ zmq::fd_t zmq::mailbox_t::get_fd ()
 
 void zmq::mailbox_t::send (const command_t &cmd_)
 {
-    sync.lock ();
-    cpipe.write (cmd_, false);
-    bool ok = cpipe.flush ();
-    sync.unlock ();
+    bool ok = cpipe.write (cmd_);
     if (!ok)
         signaler.send ();
 }
@@ -68,6 +60,14 @@ int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
         //  If there are no more commands available, switch into passive state.
         active = false;
         signaler.recv ();
+
+        //  The pipe has just been found empty, so a caller that doesn't
+        //  want to wait is spared polling the signaler. A command sent in
+        //  the meantime leaves the signal pending for the next call.
+        if (timeout_ == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
     }
 
     //  Wait for signal from the command sender.
@@ -28,8 +28,7 @@
 #include "fd.hpp"
 #include "config.hpp"
 #include "command.hpp"
-#include "ypipe.hpp"
-#include "mutex.hpp"
+#include "mpsc_pipe.hpp"
 
 namespace zmq
 {
@@ -47,19 +46,15 @@ namespace zmq
         
     private:
 
-        //  The pipe to store actual commands.
-        typedef ypipe_t <command_t, command_pipe_granularity> cpipe_t;
+        //  The pipe to store actual commands. There's only one thread
+        //  receiving from the mailbox, but there is arbitrary number of
+        //  threads sending, so the pipe has to allow for multiple writers.
+        typedef mpsc_pipe_t <command_t> cpipe_t;
         cpipe_t cpipe;
 
         //  Signaler to pass signals from writer thread to reader thread.
         signaler_t signaler;
 
-        //  There's only one thread receiving from the mailbox, but there
-        //  is arbitrary number of threads sending. Given that ypipe requires
-        //  synchronised access on both of its endpoints, we have to synchronise
-        //  the sending side.
-        mutex_t sync;
-
         //  True if the underlying pipe is active, ie. when we are allowed to
         //  read commands from it.
         bool active;
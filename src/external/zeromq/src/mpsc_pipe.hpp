@@ -0,0 +1,207 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_MPSC_PIPE_HPP_INCLUDED__
+#define __ZMQ_MPSC_PIPE_HPP_INCLUDED__
+
+#include <new>
+#include <stddef.h>
+
+#include "platform.hpp"
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#else
+#include <sched.h>
+#endif
+
+#include "atomic_ptr.hpp"
+#include "msg_pool.hpp"
+#include "err.hpp"
+
+namespace zmq
+{
+
+    //  Lock-free queue implementation.
+    //  Any number of threads can write to the pipe at the same time.
+    //  Only a single thread can read from the pipe at any specific moment.
+    //  T is the type of the object in the queue.
+    //
+    //  Items are kept in a linked list of nodes. A writer appends its node
+    //  by swapping it into the 'head' pointer and then linking it to the
+    //  node it replaced, so writers never wait for each other. The reader
+    //  walks the list from the 'tail', which always points to the node of
+    //  the last item read. Nodes are recycled through the per-thread block
+    //  caches of the message pool, so that neither side normally takes
+    //  a lock to get or release one.
+    //
+    //  Like ypipe_t, the pipe tracks whether the reader is asleep. When the
+    //  reader finds the pipe empty, it marks the head pointer, and the first
+    //  writer to find the mark learns that it has to wake the reader up.
+
+    template <typename T> class mpsc_pipe_t
+    {
+    public:
+
+        //  Initialises the pipe.
+        inline mpsc_pipe_t ()
+        {
+            //  The list always holds at least one node, the one of the last
+            //  item read. Initially, it's an empty one.
+            tail = alloc_node ();
+            head.set (tail);
+        }
+
+        //  The destructor doesn't have to be virtual. It is mad virtual
+        //  just to keep ICC and code checking tools from complaining.
+        inline virtual ~mpsc_pipe_t ()
+        {
+            while (tail) {
+                node_t *next = tail->next.cas (NULL, NULL);
+                free_node (tail);
+                tail = next;
+            }
+        }
+
+        //  Write an item to the pipe. Returns false if the reader thread is
+        //  sleeping. In that case, caller is obliged to wake the reader up
+        //  before using the pipe again.
+        inline bool write (const T &value_)
+        {
+            node_t *node = alloc_node ();
+            node->value = value_;
+
+            //  Append the node. Until it's linked to its predecessor, the
+            //  reader can't get past the predecessor.
+            node_t *prev = head.xchg (node);
+            bool asleep = is_marked (prev);
+            unmark (prev)->next.set (node);
+            return !asleep;
+        }
+
+        //  Reads an item from the pipe. Returns false if there is no value
+        //  available. In that case, the reader is considered asleep until
+        //  a writer finds out and wakes it up.
+        inline bool read (T *value_)
+        {
+            node_t *next = tail->next.cas (NULL, NULL);
+            if (!next) {
+
+                //  Nothing to read. Mark the head pointer, unless a writer
+                //  has just swapped its node in. If the mark is already
+                //  there, the reader is asleep already.
+                node_t *old = head.cas (tail, mark (tail));
+                if (old == tail || old == mark (tail))
+                    return false;
+
+                //  A writer is about to link its node. Wait for it.
+                int spins = 0;
+                while (!(next = tail->next.cas (NULL, NULL)))
+                    backoff (spins++);
+            }
+
+            //  The node becomes the one of the last item read; the previous
+            //  one can go.
+            if (value_)
+                *value_ = next->value;
+            free_node (tail);
+            tail = next;
+            return true;
+        }
+
+    private:
+
+        //  Number of times the reader spins, waiting for a writer to link
+        //  its node, before it starts yielding the CPU. The writer is
+        //  a couple of instructions away from it, unless it was preempted,
+        //  and then only giving it the CPU helps.
+        enum {max_spins = 64};
+
+        static inline void backoff (int spins_)
+        {
+            if (spins_ < max_spins) {
+#if (defined __i386__ || defined __x86_64__) && defined __GNUC__
+                __asm__ volatile ("pause");
+#elif defined ZMQ_HAVE_WINDOWS
+                YieldProcessor ();
+#endif
+                return;
+            }
+#if defined ZMQ_HAVE_WINDOWS
+            Sleep (0);
+#else
+            sched_yield ();
+#endif
+        }
+
+        struct node_t
+        {
+            T value;
+            atomic_ptr_t <node_t> next;
+        };
+
+        static inline node_t *alloc_node ()
+        {
+            void *ptr = msg_alloc (sizeof (node_t));
+            alloc_assert (ptr);
+            node_t *node = new (ptr) node_t;
+            node->next.set (NULL);
+            return node;
+        }
+
+        static inline void free_node (node_t *node_)
+        {
+            node_->~node_t ();
+            msg_free (node_, sizeof (node_t));
+        }
+
+        //  The mark is stored in the lowest bit of the pointer, which is
+        //  always clear for a node.
+        static inline node_t *mark (node_t *node_)
+        {
+            return (node_t*) ((size_t) node_ | 1);
+        }
+
+        static inline node_t *unmark (node_t *node_)
+        {
+            return (node_t*) ((size_t) node_ & ~(size_t) 1);
+        }
+
+        static inline bool is_marked (node_t *node_)
+        {
+            return ((size_t) node_ & 1) != 0;
+        }
+
+        //  Node of the last item written. Marked if the reader is asleep.
+        //  This pointer is shared by all the threads and should be always
+        //  accessed using atomic operations.
+        atomic_ptr_t <node_t> head;
+
+        //  Node of the last item read. This variable is used exclusively by
+        //  the reader thread.
+        node_t *tail;
+
+        //  Disable copying of mpsc_pipe_t object.
+        mpsc_pipe_t (const mpsc_pipe_t&);
+        const mpsc_pipe_t &operator = (const mpsc_pipe_t&);
+    };
+
+}
+
+#endif
@@ -0,0 +1,288 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "platform.hpp"
+
+#include <new>
+#include <stdlib.h>
+
+#include "msg_pool.hpp"
+#include "config.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+
+//  Without a portable way to flush a thread's cache on thread exit, the
+//  cached blocks would leak; the system allocator is used instead.
+
+void *zmq::msg_alloc (size_t size_)
+{
+    return malloc (size_);
+}
+
+void zmq::msg_free (void *ptr_, size_t size_)
+{
+    free (ptr_);
+}
+
+#else
+
+#include <pthread.h>
+
+#include "mutex.hpp"
+#include "atomic_counter.hpp"
+#include "err.hpp"
+
+namespace zmq
+{
+
+    enum
+    {
+        //  Size of the smallest class is 1 << msg_pool_min_shift, the
+        //  largest one is msg_pool_max_size.
+        msg_pool_min_shift = 6,
+        msg_pool_classes = 8
+    };
+
+    struct msg_pool_block_t
+    {
+        msg_pool_block_t *next;
+    };
+
+    struct msg_pool_cache_t
+    {
+        msg_pool_block_t *head [msg_pool_classes];
+        size_t count [msg_pool_classes];
+    };
+
+    struct msg_pool_central_t
+    {
+        mutex_t sync;
+        msg_pool_block_t *head;
+        size_t count;
+    };
+
+    //  The library is linked into the erlzmq NIF, which can be unloaded
+    //  while the threads that used the pool live on. When the library goes
+    //  away (or the process exits), the static instance of this class
+    //  deletes the thread-specific key, so that those threads don't run
+    //  the cache destructor after its code is gone, and disables the pool.
+    //  The cached blocks are left alone, as other threads (I/O threads,
+    //  erlzmq threads) may still be using their caches and the central
+    //  lists at that point.
+    class msg_pool_teardown_t
+    {
+    public:
+
+        ~msg_pool_teardown_t ();
+    };
+
+}
+
+//  Allocated along with the key and never freed, so that its mutexes
+//  are not destroyed at exit while another thread may hold them.
+static zmq::msg_pool_central_t *central = NULL;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+//  Non-zero once the teardown has started, after which the pool is
+//  bypassed.
+static zmq::atomic_counter_t disabled;
+
+static zmq::msg_pool_teardown_t teardown;
+
+static inline int size_class (size_t size_)
+{
+    int cls = 0;
+    size_t class_size = 1 << zmq::msg_pool_min_shift;
+    while (class_size < size_) {
+        class_size <<= 1;
+        cls++;
+    }
+    return cls;
+}
+
+static inline size_t class_size (int cls_)
+{
+    return ((size_t) 1) << (zmq::msg_pool_min_shift + cls_);
+}
+
+//  Moves up to count_ blocks from the head of list_ to a separate chain.
+static zmq::msg_pool_block_t *split (zmq::msg_pool_block_t **list_,
+    size_t *count_)
+{
+    zmq::msg_pool_block_t *chain = *list_;
+    zmq::msg_pool_block_t *tail = NULL;
+    size_t n = 0;
+    for (zmq::msg_pool_block_t *block = chain; block && n != *count_;
+          block = block->next, n++)
+        tail = block;
+    if (tail) {
+        *list_ = tail->next;
+        tail->next = NULL;
+    }
+    *count_ = n;
+    return tail ? chain : NULL;
+}
+
+static void free_chain (zmq::msg_pool_block_t *chain_)
+{
+    while (chain_) {
+        zmq::msg_pool_block_t *next = chain_->next;
+        free (chain_);
+        chain_ = next;
+    }
+}
+
+//  Hands a chain of count_ blocks over to the central list, freeing the
+//  blocks the central list has no room for.
+static void release (int cls_, zmq::msg_pool_block_t *chain_, size_t count_)
+{
+    zmq::msg_pool_central_t &c = central [cls_];
+    c.sync.lock ();
+    if (c.count + count_ <= zmq::msg_pool_central_size) {
+        zmq::msg_pool_block_t *tail = chain_;
+        while (tail->next)
+            tail = tail->next;
+        tail->next = c.head;
+        c.head = chain_;
+        c.count += count_;
+        chain_ = NULL;
+    }
+    c.sync.unlock ();
+
+    free_chain (chain_);
+}
+
+static void cache_destroy (void *arg_)
+{
+    zmq::msg_pool_cache_t *cache = (zmq::msg_pool_cache_t*) arg_;
+    for (int cls = 0; cls != zmq::msg_pool_classes; cls++)
+        if (cache->head [cls])
+            release (cls, cache->head [cls], cache->count [cls]);
+    free (cache);
+}
+
+static void cache_key_create ()
+{
+    central = new (std::nothrow) zmq::msg_pool_central_t [
+        zmq::msg_pool_classes];
+    alloc_assert (central);
+    for (int cls = 0; cls != zmq::msg_pool_classes; cls++) {
+        central [cls].head = NULL;
+        central [cls].count = 0;
+    }
+    int rc = pthread_key_create (&cache_key, cache_destroy);
+    posix_assert (rc);
+}
+
+zmq::msg_pool_teardown_t::~msg_pool_teardown_t ()
+{
+    if (disabled.add (1) != 0)
+        return;
+
+    //  Makes sure the key exists, so that there is exactly one to delete.
+    int rc = pthread_once (&cache_key_once, cache_key_create);
+    posix_assert (rc);
+    rc = pthread_key_delete (cache_key);
+    posix_assert (rc);
+}
+
+static inline zmq::msg_pool_cache_t *get_cache ()
+{
+    if (disabled.get ())
+        return NULL;
+    int rc = pthread_once (&cache_key_once, cache_key_create);
+    posix_assert (rc);
+    zmq::msg_pool_cache_t *cache =
+        (zmq::msg_pool_cache_t*) pthread_getspecific (cache_key);
+    if (cache)
+        return cache;
+
+    //  If the cache can't be allocated the caller falls back to malloc.
+    //  The same goes for a thread racing with the teardown, whose key
+    //  has just been deleted.
+    cache = (zmq::msg_pool_cache_t*) calloc (1, sizeof (zmq::msg_pool_cache_t));
+    if (!cache)
+        return NULL;
+    if (pthread_setspecific (cache_key, cache) != 0) {
+        free (cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void *zmq::msg_alloc (size_t size_)
+{
+    if (size_ > msg_pool_max_size)
+        return malloc (size_);
+
+    int cls = size_class (size_);
+    msg_pool_cache_t *cache = get_cache ();
+    if (!cache)
+        return malloc (class_size (cls));
+
+    //  Refill an empty cache with a batch from the central list.
+    if (!cache->head [cls]) {
+        msg_pool_central_t &c = central [cls];
+        size_t count = msg_pool_batch;
+        c.sync.lock ();
+        cache->head [cls] = split (&c.head, &count);
+        c.count -= count;
+        c.sync.unlock ();
+        cache->count [cls] = count;
+        if (!cache->head [cls])
+            return malloc (class_size (cls));
+    }
+
+    msg_pool_block_t *block = cache->head [cls];
+    cache->head [cls] = block->next;
+    cache->count [cls]--;
+    return block;
+}
+
+void zmq::msg_free (void *ptr_, size_t size_)
+{
+    if (size_ > msg_pool_max_size) {
+        free (ptr_);
+        return;
+    }
+
+    msg_pool_cache_t *cache = get_cache ();
+    if (!cache) {
+        free (ptr_);
+        return;
+    }
+
+    int cls = size_class (size_);
+    msg_pool_block_t *block = (msg_pool_block_t*) ptr_;
+    block->next = cache->head [cls];
+    cache->head [cls] = block;
+    cache->count [cls]++;
+
+    //  Pass a batch on to the threads that allocate more than they free.
+    if (cache->count [cls] > msg_pool_cache_size) {
+        size_t count = msg_pool_batch;
+        msg_pool_block_t *chain = split (&cache->head [cls], &count);
+        cache->count [cls] -= count;
+        release (cls, chain, count);
+    }
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_MSG_POOL_HPP_INCLUDED__
+#define __ZMQ_MSG_POOL_HPP_INCLUDED__
+
+#include <stddef.h>
+
+namespace zmq
+{
+
+    //  Allocator for message contents. Blocks up to msg_pool_max_size bytes
+    //  are rounded up to a power-of-two size class and served from a cache
+    //  owned by the calling thread, so that the common path takes no lock.
+    //  A block is returned to the cache of the thread that frees it, which
+    //  for a shared message is the thread dropping the last reference. As
+    //  messages usually travel from one thread to another, caches exchange
+    //  blocks in batches through a central free list per size class.
+    //
+    //  The size passed to msg_free must be the one passed to msg_alloc.
+
+    void *msg_alloc (size_t size_);
+    void msg_free (void *ptr_, size_t size_);
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <algorithm>
+
+#include "platform.hpp"
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define ZMQ_MTRIE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "err.hpp"
+#include "mtrie.hpp"
+
+//  Returns the number of leading characters that are equal in both buffers.
+static inline size_t common_size (const unsigned char *a_,
+    const unsigned char *b_, size_t size_)
+{
+    size_t i = 0;
+#if defined ZMQ_MTRIE_SSE2
+    while (size_ - i >= 16) {
+        __m128i a = _mm_loadu_si128 ((const __m128i*) (a_ + i));
+        __m128i b = _mm_loadu_si128 ((const __m128i*) (b_ + i));
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)) != 0xffff)
+            break;
+        i += 16;
+    }
+#endif
+    while (i != size_ && a_ [i] == b_ [i])
+        i++;
+    return i;
+}
+
+zmq::mtrie_t::mtrie_t () :
+    pipes (NULL),
+    min (0),
+    count (0),
+    prefix (NULL),
+    prefix_size (0)
+{
+}
+
+zmq::mtrie_t::~mtrie_t ()
+{
+    delete pipes;
+    if (count == 1)
+        delete next.node;
+    else if (count > 1) {
+        for (unsigned short i = 0; i != count; ++i)
+            if (next.table [i])
+                delete next.table [i];
+        free (next.table);
+    }
+    free (prefix);
+}
+
+zmq::mtrie_t **zmq::mtrie_t::slot (unsigned char c_)
+{
+    unsigned char c = c_;
+    if (c < min || c >= min + count) {
+
+        //  The character is out of range of currently handled
+        //  charcters. We have to extend the table.
+        if (!count) {
+            min = c;
+            count = 1;
+            next.node = NULL;
+        }
+        else if (count == 1) {
+            unsigned char oldc = min;
+            mtrie_t *oldp = next.node;
+            count = (min < c ? c - min : min - c) + 1;
+            next.table = (mtrie_t**)
+                malloc (sizeof (mtrie_t*) * count);
+            alloc_assert (next.table);
+            for (unsigned short i = 0; i != count; ++i)
+                next.table [i] = 0;
+            min = std::min (min, c);
+            next.table [oldc - min] = oldp;
+        }
+        else if (min < c) {
+
+            //  The new character is above the current character range.
+            unsigned short old_count = count;
+            count = c - min + 1;
+            next.table = (mtrie_t**) realloc ((void*) next.table,
+                sizeof (mtrie_t*) * count);
+            zmq_assert (next.table);
+            for (unsigned short i = old_count; i != count; i++)
+                next.table [i] = NULL;
+        }
+        else {
+
+            //  The new character is below the current character range.
+            unsigned short old_count = count;
+            count = (min + old_count) - c;
+            next.table = (mtrie_t**) realloc ((void*) next.table,
+                sizeof (mtrie_t*) * count);
+            zmq_assert (next.table);
+            memmove (next.table + min - c, next.table,
+                old_count * sizeof (mtrie_t*));
+            for (unsigned short i = 0; i != min - c; i++)
+                next.table [i] = NULL;
+            min = c;
+        }
+    }
+
+    if (count == 1)
+        return &next.node;
+    return &next.table [c - min];
+}
+
+void zmq::mtrie_t::split (size_t size_)
+{
+    zmq_assert (size_ < prefix_size);
+
+    //  The new node takes over the pipes and the children of this node,
+    //  with the remainder of the prefix.
+    mtrie_t *tail = new (std::nothrow) mtrie_t;
+    alloc_assert (tail);
+    tail->pipes = pipes;
+    tail->min = min;
+    tail->count = count;
+    tail->next = next;
+    tail->prefix_size = prefix_size - size_ - 1;
+    if (tail->prefix_size) {
+        tail->prefix = (unsigned char*) malloc (tail->prefix_size);
+        alloc_assert (tail->prefix);
+        memcpy (tail->prefix, prefix + size_ + 1, tail->prefix_size);
+    }
+
+    pipes = NULL;
+    min = prefix [size_];
+    count = 1;
+    next.node = tail;
+    prefix_size = size_;
+}
+
+bool zmq::mtrie_t::add (unsigned char *prefix_, size_t size_,
+    writer_t *pipe_)
+{
+    mtrie_t *current = this;
+    while (size_) {
+
+        //  If next node does not exist, create one holding the rest
+        //  of the prefix.
+        mtrie_t **node = current->slot (*prefix_);
+        prefix_++;
+        size_--;
+        if (!*node) {
+            *node = new (std::nothrow) mtrie_t;
+            alloc_assert (*node);
+            if (size_) {
+                (*node)->prefix = (unsigned char*) malloc (size_);
+                alloc_assert ((*node)->prefix);
+                memcpy ((*node)->prefix, prefix_, size_);
+                (*node)->prefix_size = size_;
+            }
+            current = *node;
+            break;
+        }
+        current = *node;
+
+        //  If the prefix diverges within the compressed part of the node
+        //  the node has to be split at that point.
+        size_t size = common_size (current->prefix, prefix_,
+            std::min (current->prefix_size, size_));
+        if (size != current->prefix_size)
+            current->split (size);
+        prefix_ += size;
+        size_ -= size;
+    }
+
+    //  We are at the node corresponding to the prefix. We are done.
+    if (!current->pipes) {
+        current->pipes = new (std::nothrow) pipes_t;
+        alloc_assert (current->pipes);
+    }
+    return current->pipes->insert (pipe_).second;
+}
+
+void zmq::mtrie_t::rm (writer_t *pipe_)
+{
+    if (pipes) {
+        pipes->erase (pipe_);
+        if (pipes->empty ()) {
+            delete pipes;
+            pipes = NULL;
+        }
+    }
+
+    if (count == 1 && next.node)
+        next.node->rm (pipe_);
+    else if (count > 1)
+        for (unsigned short i = 0; i != count; i++)
+            if (next.table [i])
+                next.table [i]->rm (pipe_);
+}
+
+bool zmq::mtrie_t::rm (unsigned char *prefix_, size_t size_,
+    writer_t *pipe_)
+{
+    mtrie_t *current = this;
+    while (size_) {
+        unsigned char c = *prefix_;
+        if (!current->count || c < current->min ||
+              c >= current->min + current->count)
+            return false;
+
+        current = current->count == 1 ?
+            current->next.node : current->next.table [c - current->min];
+        if (!current)
+            return false;
+        prefix_++;
+        size_--;
+
+        if (size_ < current->prefix_size || common_size (current->prefix,
+              prefix_, current->prefix_size) != current->prefix_size)
+            return false;
+        prefix_ += current->prefix_size;
+        size_ -= current->prefix_size;
+    }
+
+    if (!current->pipes || !current->pipes->erase (pipe_))
+        return false;
+    if (current->pipes->empty ()) {
+        delete current->pipes;
+        current->pipes = NULL;
+    }
+    return true;
+}
+
+void zmq::mtrie_t::match (unsigned char *data_, size_t size_,
+    void (*func_) (writer_t *pipe_, void *arg_), void *arg_)
+{
+    //  This function is on critical path. It deliberately doesn't use
+    //  recursion to get a bit better performance.
+    mtrie_t *current = this;
+    while (true) {
+
+        //  Signal the pipes attached to this node.
+        if (current->pipes)
+            for (pipes_t::iterator it = current->pipes->begin ();
+                  it != current->pipes->end (); ++it)
+                func_ (*it, arg_);
+
+        //  If we are at the end of the message, there's nothing more to match.
+        if (!size_)
+            return;
+
+        //  If there's no corresponding slot for the first character
+        //  of the prefix, the message does not match.
+        unsigned char c = *data_;
+        if (c < current->min || c >= current->min + current->count)
+            return;
+
+        //  Move to the next character.
+        if (current->count == 1)
+            current = current->next.node;
+        else {
+            current = current->next.table [c - current->min];
+            if (!current)
+                return;
+        }
+        data_++;
+        size_--;
+
+        //  The compressed part of the node has to match as a whole,
+        //  since subscriptions only end at nodes.
+        if (current->prefix_size) {
+            if (size_ < current->prefix_size || common_size (current->prefix,
+                  data_, current->prefix_size) != current->prefix_size)
+                return;
+            data_ += current->prefix_size;
+            size_ -= current->prefix_size;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_MTRIE_HPP_INCLUDED__
+#define __ZMQ_MTRIE_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <set>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Multi-trie. Each node in the trie is a set of pointers to pipes.
+    //  The path is compressed the same way as in trie_t.
+
+    class mtrie_t
+    {
+    public:
+
+        mtrie_t ();
+        ~mtrie_t ();
+
+        //  Add key to the trie. Returns true if it's a new subscription
+        //  rather than a duplicate.
+        bool add (unsigned char *prefix_, size_t size_,
+            class writer_t *pipe_);
+
+        //  Remove all subscriptions for a specific peer from the trie.
+        void rm (class writer_t *pipe_);
+
+        //  Remove specific subscription from the trie. Returns true if it was
+        //  actually removed rather than de-duplicated.
+        bool rm (unsigned char *prefix_, size_t size_, class writer_t *pipe_);
+
+        //  Signal all the matching pipes.
+        void match (unsigned char *data_, size_t size_,
+            void (*func_) (class writer_t *pipe_, void *arg_), void *arg_);
+
+    private:
+
+        //  Returns the slot for the child node starting with the character,
+        //  extending the table of children as needed.
+        mtrie_t **slot (unsigned char c_);
+
+        //  Splits the compressed prefix of the node after size_ characters.
+        void split (size_t size_);
+
+        typedef std::set <class writer_t*> pipes_t;
+        pipes_t *pipes;
+
+        unsigned char min;
+        unsigned short count;
+        union {
+            class mtrie_t *node;
+            class mtrie_t **table;
+        } next;
+
+        //  Characters that follow the character used to reach the node.
+        unsigned char *prefix;
+        size_t prefix_size;
+
+        mtrie_t (const mtrie_t&);
+        const mtrie_t &operator = (const mtrie_t&);
+    };
+
+}
+
+#endif
@@ -67,6 +67,10 @@ void zmq::object_t::process_command (command_t &cmd_)
         process_activate_writer (cmd_.args.activate_writer.msgs_read);
         break;
 
+    case command_t::hiccup:
+        process_hiccup ();
+        break;
+
     case command_t::stop:
         process_stop ();
         break;
@@ -291,6 +295,17 @@ void zmq::object_t::send_activate_writer (writer_t *destination_,
     send_command (cmd);
 }
 
+void zmq::object_t::send_hiccup (writer_t *destination_)
+{
+    command_t cmd;
+#if defined ZMQ_MAKE_VALGRIND_HAPPY
+    memset (&cmd, 0, sizeof (cmd));
+#endif
+    cmd.destination = destination_;
+    cmd.type = command_t::hiccup;
+    send_command (cmd);
+}
+
 void zmq::object_t::send_pipe_term (writer_t *destination_)
 {
     command_t cmd;
@@ -420,6 +435,11 @@ void zmq::object_t::process_activate_writer (uint64_t msgs_read_)
     zmq_assert (false);
 }
 
+void zmq::object_t::process_hiccup ()
+{
+    zmq_assert (false);
+}
+
 void zmq::object_t::process_pipe_term ()
 {
     zmq_assert (false);
@@ -74,6 +74,7 @@ namespace zmq
         void send_activate_reader (class reader_t *destination_);
         void send_activate_writer (class writer_t *destination_,
              uint64_t msgs_read_);
+        void send_hiccup (class writer_t *destination_);
         void send_pipe_term (class writer_t *destination_);
         void send_pipe_term_ack (class reader_t *destination_);
         void send_term_req (class own_t *destination_,
@@ -95,6 +96,7 @@ namespace zmq
             class writer_t *out_pipe_, const blob_t &peer_identity_);
         virtual void process_activate_reader ();
         virtual void process_activate_writer (uint64_t msgs_read_);
+        virtual void process_hiccup ();
         virtual void process_pipe_term ();
         virtual void process_pipe_term_ack ();
         virtual void process_term_req (class own_t *object_);
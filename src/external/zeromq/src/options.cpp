@@ -30,6 +30,7 @@
 zmq::options_t::options_t () :
     hwm (0),
     swap (0),
+    swap_durable (false),
     affinity (0),
     rate (40 * 1000),
     recovery_ivl (10),
@@ -42,8 +43,11 @@ zmq::options_t::options_t () :
     reconnect_ivl (100),
     reconnect_ivl_max (0),
     backlog (100),
+    balance (ZMQ_BALANCE_ROUND_ROBIN),
+    rcvweight (1),
     requires_in (false),
     requires_out (false),
+    lossless_out (false),
     immediate_connect (true)
 {
 }
@@ -191,6 +195,34 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
         backlog = *((int*) optval_);
         return 0;
 
+    case ZMQ_SWAP_DURABLE:
+        if (optvallen_ != sizeof (int) ||
+              (*((int*) optval_) != 0 && *((int*) optval_) != 1)) {
+            errno = EINVAL;
+            return -1;
+        }
+        swap_durable = *((int*) optval_) == 1;
+        return 0;
+
+    case ZMQ_BALANCE:
+        if (optvallen_ != sizeof (int) ||
+              (*((int*) optval_) != ZMQ_BALANCE_ROUND_ROBIN &&
+              *((int*) optval_) != ZMQ_BALANCE_LEAST_QUEUED &&
+              *((int*) optval_) != ZMQ_BALANCE_TWO_CHOICES)) {
+            errno = EINVAL;
+            return -1;
+        }
+        balance = *((int*) optval_);
+        return 0;
+
+    case ZMQ_RCVWEIGHT:
+        if (optvallen_ != sizeof (int) || *((int*) optval_) < 1) {
+            errno = EINVAL;
+            return -1;
+        }
+        rcvweight = *((int*) optval_);
+        return 0;
+
     }
 
     errno = EINVAL;
@@ -337,6 +369,33 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
         *optvallen_ = sizeof (int);
         return 0;
 
+    case ZMQ_SWAP_DURABLE:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = swap_durable ? 1 : 0;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case ZMQ_BALANCE:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = balance;
+        *optvallen_ = sizeof (int);
+        return 0;
+
+    case ZMQ_RCVWEIGHT:
+        if (*optvallen_ < sizeof (int)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((int*) optval_) = rcvweight;
+        *optvallen_ = sizeof (int);
+        return 0;
+
     }
 
     errno = EINVAL;
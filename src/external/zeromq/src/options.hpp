@@ -37,6 +37,9 @@ namespace zmq
 
         uint64_t hwm;
         int64_t swap;
+
+        //  If true, swaps of named sessions survive process restart.
+        bool swap_durable;
         uint64_t affinity;
         blob_t identity;
 
@@ -70,11 +73,23 @@ namespace zmq
         //  Maximum backlog for pending connections.
         int backlog;
 
+        //  Strategy used to load-balance outbound messages. One of the
+        //  ZMQ_BALANCE_* values. Default round robin.
+        int balance;
+
+        //  Weight of the inbound pipes of new connections when fair-queueing.
+        //  A pipe of weight N gets N times the share of the bandwidth.
+        int rcvweight;
+
         //  These options are never set by the user directly. Instead they are
         //  provided by the specific socket type.
         bool requires_in;
         bool requires_out;
 
+        //  If true, the outbound pipes have no high watermark. Used by the
+        //  sockets that send state to the peer which must not be dropped.
+        bool lossless_out;
+
         //  If true, when connecting, pipes are created immediately without
         //  waiting for the connection to be established. That way the socket
         //  is not aware of the peer's identity, however, it is able to send
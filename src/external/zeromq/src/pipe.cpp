@@ -33,6 +33,8 @@ zmq::reader_t::reader_t (object_t *parent_, pipe_t *pipe_,
     writer (NULL),
     lwm (lwm_),
     msgs_read (0),
+    weight (1),
+    deficit (0),
     sink (NULL),
     terminating (false)
 {
@@ -69,6 +71,36 @@ void zmq::reader_t::set_event_sink (i_reader_events *sink_)
     sink = sink_;
 }
 
+void zmq::reader_t::set_weight (int weight_)
+{
+    weight = weight_;
+}
+
+int zmq::reader_t::get_weight ()
+{
+    return weight;
+}
+
+bool zmq::reader_t::start_turn (uint64_t quantum_)
+{
+    deficit += (int64_t) (quantum_ * weight);
+    return deficit >= 0;
+}
+
+bool zmq::reader_t::charge (size_t size_)
+{
+    //  Every part costs at least a byte so that a peer sending empty
+    //  messages can't keep the turn forever.
+    deficit -= size_ ? (int64_t) size_ : 1;
+    return deficit >= 0;
+}
+
+void zmq::reader_t::end_turn ()
+{
+    if (deficit > 0)
+        deficit = 0;
+}
+
 bool zmq::reader_t::is_delimiter (zmq_msg_t &msg_)
 {
     unsigned char *offset = 0;
@@ -141,6 +173,15 @@ void zmq::reader_t::terminate ()
     send_pipe_term (writer);
 }
 
+void zmq::reader_t::hiccup ()
+{
+    //  Once the termination was started the writer may be gone.
+    if (terminating)
+        return;
+
+    send_hiccup (writer);
+}
+
 void zmq::reader_t::process_activate_reader ()
 {
     //  Forward the event to the sink (either socket or session).
@@ -163,7 +204,7 @@ void zmq::reader_t::process_pipe_term_ack ()
 }
 
 zmq::writer_t::writer_t (object_t *parent_, pipe_t *pipe_, reader_t *reader_,
-      uint64_t hwm_, int64_t swap_size_) :
+      uint64_t hwm_, int64_t swap_size_, const std::string &swap_name_) :
     object_t (parent_),
     active (true),
     pipe (pipe_),
@@ -182,10 +223,37 @@ zmq::writer_t::writer_t (object_t *parent_, pipe_t *pipe_, reader_t *reader_,
 
     //  Open the swap file, if required.
     if (swap_size_ > 0) {
-        swap = new (std::nothrow) swap_t (swap_size_);
+        swap = new (std::nothrow) swap_t (swap_size_, swap_name_);
         alloc_assert (swap);
         int rc = swap->init ();
+
+        //  If the durable swap can't be used, fall back to a scratch swap.
+        //  The messages are still swapped, they just don't survive a
+        //  restart of the process.
+        if (rc != 0 && !swap_name_.empty ()) {
+            delete swap;
+            swap = new (std::nothrow) swap_t (swap_size_, std::string ());
+            alloc_assert (swap);
+            rc = swap->init ();
+        }
         zmq_assert (rc == 0);
+
+        //  A durable swap may hold messages recovered from a previous run.
+        //  Move as many of them as possible to the pipe straight away; the
+        //  rest follows as the reader makes progress.
+        if (!swap->empty ()) {
+            swapping = true;
+            zmq_msg_t msg;
+            while (!pipe_full () && !swap->empty ()) {
+                swap->fetch (&msg);
+                pipe->write (msg, msg.flags & ZMQ_MSG_MORE);
+                if (!(msg.flags & ZMQ_MSG_MORE))
+                    msgs_written++;
+            }
+            pipe->flush ();
+            if (swap->empty ())
+                swapping = false;
+        }
     }
 }
 
@@ -348,6 +416,15 @@ void zmq::writer_t::process_activate_writer (uint64_t msgs_read_)
     }
 }
 
+void zmq::writer_t::process_hiccup ()
+{
+    //  Forward the event to the sink (either socket or session).
+    if (!terminating) {
+        zmq_assert (sink);
+        sink->hiccuped (this);
+    }
+}
+
 void zmq::writer_t::process_pipe_term ()
 {
     send_pipe_term_ack (reader);
@@ -365,13 +442,19 @@ void zmq::writer_t::process_pipe_term ()
     delete this;
 }
 
+uint64_t zmq::writer_t::depth ()
+{
+    return msgs_written - msgs_read;
+}
+
 bool zmq::writer_t::pipe_full ()
 {
     return hwm > 0 && msgs_written - msgs_read == hwm;
 }
 
 void zmq::create_pipe (object_t *reader_parent_, object_t *writer_parent_,
-    uint64_t hwm_, int64_t swap_size_, reader_t **reader_, writer_t **writer_)
+    uint64_t hwm_, int64_t swap_size_, const std::string &swap_name_,
+    reader_t **reader_, writer_t **writer_)
 {
     //  First compute the low water mark. Following point should be taken
     //  into consideration:
@@ -404,6 +487,6 @@ void zmq::create_pipe (object_t *reader_parent_, object_t *writer_parent_,
     *reader_ = new (std::nothrow) reader_t (reader_parent_, pipe, lwm);
     alloc_assert (*reader_);
     *writer_ = new (std::nothrow) writer_t (writer_parent_, pipe, *reader_,
-        hwm_, swap_size_);
+        hwm_, swap_size_, swap_name_);
     alloc_assert (*writer_);
 }
@@ -23,6 +23,8 @@
 
 #include "../include/zmq.h"
 
+#include <string>
+
 #include "stdint.hpp"
 #include "array.hpp"
 #include "ypipe.hpp"
@@ -34,9 +36,10 @@ namespace zmq
 {
 
     //  Creates a pipe. Returns pointer to reader and writer objects.
+    //  If swap_name_ is not empty, the swap is durable and uses that file.
     void create_pipe (object_t *reader_parent_, object_t *writer_parent_,
-        uint64_t hwm_, int64_t swap_size_, class reader_t **reader_,
-        class writer_t **writer_);
+        uint64_t hwm_, int64_t swap_size_, const std::string &swap_name_,
+        class reader_t **reader_, class writer_t **writer_);
 
     //  The shutdown mechanism for pipe works as follows: Either endpoint
     //  (or even both of them) can ask pipe to terminate by calling 'terminate'
@@ -59,7 +62,7 @@ namespace zmq
     class reader_t : public object_t, public array_item_t
     {
         friend void create_pipe (object_t*, object_t*, uint64_t,
-            int64_t, reader_t**, writer_t**);
+            int64_t, const std::string&, reader_t**, writer_t**);
         friend class writer_t;
 
     public:
@@ -76,6 +79,28 @@ namespace zmq
         //  Ask pipe to terminate.
         void terminate ();
 
+        //  Let the writer know that the messages it has written so far may
+        //  not have reached the final destination.
+        void hiccup ();
+
+        //  Weight of the pipe for fair-queueing. Set by whoever creates
+        //  the pipe, before the reader is passed to its owner.
+        void set_weight (int weight_);
+        int get_weight ();
+
+        //  Deficit round robin accounting for fair-queueing. When its turn
+        //  starts the pipe is credited with quantum_ bytes times its
+        //  weight; returns false if it is still in debt from an earlier
+        //  turn, in which case the turn passes straight away.
+        bool start_turn (uint64_t quantum_);
+
+        //  Debits a delivered message part. Returns false once the credit
+        //  of the turn is used up; an overrun carries over as debt.
+        bool charge (size_t size_);
+
+        //  The pipe ran out of messages. Unused credit is forfeited.
+        void end_turn ();
+
     private:
 
         reader_t (class object_t *parent_, pipe_t *pipe_, uint64_t lwm_);
@@ -106,6 +131,13 @@ namespace zmq
         //  Number of messages read so far.
         uint64_t msgs_read;
 
+        //  Share of the reading socket's attention, see ZMQ_RCVWEIGHT.
+        int weight;
+
+        //  Bytes the pipe may still deliver in its turn. Negative if the
+        //  last message overran the credit.
+        int64_t deficit;
+
         //  Sink for the events (either the socket of the session).
         i_reader_events *sink;
 
@@ -123,12 +155,16 @@ namespace zmq
 
         virtual void terminated (class writer_t *pipe_) = 0;
         virtual void activated (class writer_t *pipe_) = 0;
+
+        //  Only the endpoints that pass state to the peer, such as the
+        //  subscriptions, need to handle this one.
+        virtual void hiccuped (class writer_t *pipe_) {}
     };
 
     class writer_t : public object_t, public array_item_t
     {
         friend void create_pipe (object_t*, object_t*, uint64_t,
-            int64_t, reader_t**, writer_t**);
+            int64_t, const std::string&, reader_t**, writer_t**);
 
     public:
 
@@ -153,14 +189,21 @@ namespace zmq
         //  Ask pipe to terminate.
         void terminate ();
 
+        //  Returns the number of messages written to the pipe that the
+        //  reader is not known to have read yet. The reader reports its
+        //  progress only when the high watermark is set, and only every
+        //  so often, so the value is an upper bound.
+        uint64_t depth ();
+
     private:
 
         writer_t (class object_t *parent_, pipe_t *pipe_, reader_t *reader_,
-            uint64_t hwm_, int64_t swap_size_);
+            uint64_t hwm_, int64_t swap_size_, const std::string &swap_name_);
         ~writer_t ();
 
         //  Command handlers.
         void process_activate_writer (uint64_t msgs_read_);
+        void process_hiccup ();
         void process_pipe_term ();
 
         //  Tests whether underlying pipe is already full. The swap is not
@@ -22,6 +22,7 @@
 #define __ZMQ_POLLER_HPP_INCLUDED__
 
 #include "epoll.hpp"
+#include "io_uring.hpp"
 #include "poll.hpp"
 #include "select.hpp"
 #include "devpoll.hpp"
@@ -36,6 +37,8 @@ namespace zmq
     typedef poll_t poller_t;
 #elif defined ZMQ_FORCE_EPOLL
     typedef epoll_t poller_t;
+#elif defined ZMQ_FORCE_IO_URING
+    typedef io_uring_t poller_t;
 #elif defined ZMQ_FORCE_DEVPOLL
     typedef devpoll_t poller_t;
 #elif defined ZMQ_FORCE_KQUEUE
@@ -26,7 +26,7 @@
 
 zmq::push_t::push_t (class ctx_t *parent_, uint32_t tid_) :
     socket_base_t (parent_, tid_),
-    lb (this)
+    lb (this, options)
 {
     options.type = ZMQ_PUSH;
     options.requires_in = false;
@@ -24,6 +24,38 @@
 #include "err.hpp"
 #include "pipe.hpp"
 #include "likely.hpp"
+#include "stdint.hpp"
+
+#include <string>
+
+//  64-bit FNV-1a hash of an identity.
+static uint64_t identity_hash (const zmq::blob_t &identity_)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i != identity_.size (); i++) {
+        hash ^= identity_ [i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+//  Returns the file name prefix of the durable swaps between the two
+//  identities. Identities are up to 255 bytes long, so they are hashed
+//  to keep the name well within the file name limit.
+static std::string swap_filename (const zmq::blob_t &identity_,
+    const zmq::blob_t &peer_identity_)
+{
+    static const char hex [] = "0123456789abcdef";
+    uint64_t hashes [2] = {identity_hash (identity_),
+        identity_hash (peer_identity_)};
+    std::string name ("zmq");
+    for (int i = 0; i != 2; i++) {
+        name += '_';
+        for (int shift = 60; shift >= 0; shift -= 4)
+            name += hex [(hashes [i] >> shift) & 0xf];
+    }
+    return name;
+}
 
 zmq::session_t::session_t (class io_thread_t *io_thread_,
       class socket_base_t *socket_, const options_t &options_) :
@@ -246,15 +278,25 @@ void zmq::session_t::process_attach (i_engine *engine_,
         reader_t *socket_reader = NULL;
         writer_t *socket_writer = NULL;
 
+        //  Durable swaps need both identities to be stable.
+        std::string swap_name;
+        if (options.swap_durable && !options.identity.empty () &&
+              !peer_identity_.empty () && peer_identity_ [0] != 0)
+            swap_name = swap_filename (options.identity, peer_identity_);
+
         //  Create the pipes, as required.
         if (options.requires_in) {
-            create_pipe (socket, this, options.hwm, options.swap, &socket_reader,
-                &out_pipe);
+            create_pipe (socket, this, options.hwm, options.swap,
+                swap_name.empty () ? swap_name : swap_name + "_in.swap",
+                &socket_reader, &out_pipe);
+            socket_reader->set_weight (options.rcvweight);
             out_pipe->set_event_sink (this);
         }
         if (options.requires_out) {
-            create_pipe (this, socket, options.hwm, options.swap, &in_pipe,
-                &socket_writer);
+            create_pipe (this, socket,
+                options.lossless_out ? 0 : options.hwm, options.swap,
+                swap_name.empty () ? swap_name : swap_name + "_out.swap",
+                &in_pipe, &socket_writer);
             in_pipe->set_event_sink (this);
         }
 
@@ -262,6 +304,13 @@ void zmq::session_t::process_attach (i_engine *engine_,
         if (socket_reader || socket_writer)
             send_bind (socket, socket_reader, socket_writer, peer_identity_);
     }
+    else if (in_pipe) {
+
+        //  The pipes survived the previous connection. Whatever the socket
+        //  has sent through them may have been lost with it, so let it know
+        //  it should bring the new peer up to date.
+        in_pipe->hiccup ();
+    }
 
     //  Plug in the engine.
     engine = engine_;
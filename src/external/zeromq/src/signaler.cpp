@@ -34,6 +34,10 @@
 #define ZMQ_SIGNALER_WAIT_BASED_ON_SELECT
 #endif
 
+#if defined ZMQ_HAVE_LINUX && !defined ZMQ_HAVE_ANDROID
+#define ZMQ_SIGNALER_USE_EVENTFD
+#endif
+
 //  On AIX, poll.h has to be included before zmq.h to get consistent
 //  definition of pollfd structure (AIX uses 'reqevents' and 'retnevents'
 //  instead of 'events' and 'revents' and defines macros to map from POSIX-y
@@ -73,8 +77,17 @@
 #include <sys/socket.h>
 #endif
 
+#if defined ZMQ_SIGNALER_USE_EVENTFD
+#include <sys/eventfd.h>
+#include <stdint.h>
+#endif
+
 zmq::signaler_t::signaler_t ()
 {
+#if defined ZMQ_SIGNALER_USE_EVENTFD
+    r = w = eventfd (0, EFD_NONBLOCK);
+    errno_assert (r != -1);
+#else
     //  Create the socketpair for signaling.
     int rc = make_fdpair (&r, &w);
     errno_assert (rc == 0);
@@ -96,6 +109,7 @@ zmq::signaler_t::signaler_t ()
     rc = fcntl (r, F_SETFL, flags | O_NONBLOCK);
     errno_assert (rc == 0);
 #endif
+#endif
 }
 
 zmq::signaler_t::~signaler_t ()
@@ -105,6 +119,8 @@ zmq::signaler_t::~signaler_t ()
     wsa_assert (rc != SOCKET_ERROR);
     rc = closesocket (r);
     wsa_assert (rc != SOCKET_ERROR);
+#elif defined ZMQ_SIGNALER_USE_EVENTFD
+    close (r);
 #else
     close (w);
     close (r);
@@ -118,7 +134,16 @@ zmq::fd_t zmq::signaler_t::get_fd ()
 
 void zmq::signaler_t::send ()
 {
-#if defined ZMQ_HAVE_WINDOWS
+#if defined ZMQ_SIGNALER_USE_EVENTFD
+    const uint64_t inc = 1;
+    while (true) {
+        ssize_t nbytes = ::write (w, &inc, sizeof (inc));
+        if (unlikely (nbytes == -1 && errno == EINTR))
+            continue;
+        zmq_assert (nbytes == sizeof (inc));
+        break;
+    }
+#elif defined ZMQ_HAVE_WINDOWS
     unsigned char dummy = 0;
     int nbytes = ::send (w, (char*) &dummy, sizeof (dummy), 0);
     wsa_assert (nbytes != SOCKET_ERROR);
@@ -191,6 +216,13 @@ int zmq::signaler_t::wait (int timeout_)
 
 void zmq::signaler_t::recv ()
 {
+#if defined ZMQ_SIGNALER_USE_EVENTFD
+    uint64_t dummy;
+    ssize_t nbytes = ::read (r, &dummy, sizeof (dummy));
+    errno_assert (nbytes >= 0);
+    zmq_assert (nbytes == sizeof (dummy));
+    zmq_assert (dummy == 1);
+#else
     //  Attempt to read a signal.
     unsigned char dummy;
 #ifdef ZMQ_HAVE_WINDOWS
@@ -202,6 +234,7 @@ void zmq::signaler_t::recv ()
 #endif
     zmq_assert (nbytes == sizeof (dummy));
     zmq_assert (dummy == 0);
+#endif
 }
 
 int zmq::signaler_t::make_fdpair (fd_t *r_, fd_t *w_)
@@ -341,4 +374,7 @@ int zmq::signaler_t::make_fdpair (fd_t *r_, fd_t *w_)
 #if defined ZMQ_SIGNALER_WAIT_BASED_ON_POLL
 #undef ZMQ_SIGNALER_WAIT_BASED_ON_POLL
 #endif
+#if defined ZMQ_SIGNALER_USE_EVENTFD
+#undef ZMQ_SIGNALER_USE_EVENTFD
+#endif
 
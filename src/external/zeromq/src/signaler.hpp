@@ -30,6 +30,9 @@ namespace zmq
     //  to signal_fd there can be at most one signal in the signaler at any
     //  given moment. Attempt to send a signal before receiving the previous
     //  one will result in undefined behaviour.
+    //
+    //  On Linux the signal is carried by an eventfd, which is cheaper to
+    //  write and read than a socketpair and uses a single file descriptor.
 
     class signaler_t
     {
@@ -49,7 +52,8 @@ namespace zmq
         //  to pass the signals.
         static int make_fdpair (fd_t *r_, fd_t *w_);
 
-        //  Write & read end of the socketpair.
+        //  Write & read end of the socketpair. Both are the same eventfd
+        //  where eventfd is used.
         fd_t w;
         fd_t r;
 
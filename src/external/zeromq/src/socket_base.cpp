@@ -413,13 +413,21 @@ int zmq::socket_base_t::connect (const char *addr_)
 
         //  Create inbound pipe, if required.
         if (options.requires_in)
-            create_pipe (this, peer.socket, hwm, swap,
-                &inpipe_reader, &inpipe_writer);
+            create_pipe (this, peer.socket,
+                peer.options.lossless_out ? 0 : hwm, swap,
+                std::string (), &inpipe_reader, &inpipe_writer);
 
         //  Create outbound pipe, if required.
         if (options.requires_out)
-            create_pipe (peer.socket, this, hwm, swap,
-                &outpipe_reader, &outpipe_writer);
+            create_pipe (peer.socket, this,
+                options.lossless_out ? 0 : hwm, swap,
+                std::string (), &outpipe_reader, &outpipe_writer);
+
+        //  Each side weighs the pipe it reads from.
+        if (inpipe_reader)
+            inpipe_reader->set_weight (options.rcvweight);
+        if (outpipe_reader)
+            outpipe_reader->set_weight (peer.options.rcvweight);
 
         //  Attach the pipes to this socket object.
         attach_pipes (inpipe_reader, outpipe_writer, peer.options.identity);
@@ -456,14 +464,17 @@ int zmq::socket_base_t::connect (const char *addr_)
         writer_t *outpipe_writer = NULL;
 
         //  Create inbound pipe, if required.
-        if (options.requires_in)
+        if (options.requires_in) {
             create_pipe (this, session, options.hwm, options.swap,
-                &inpipe_reader, &inpipe_writer);
+                std::string (), &inpipe_reader, &inpipe_writer);
+            inpipe_reader->set_weight (options.rcvweight);
+        }
 
         //  Create outbound pipe, if required.
         if (options.requires_out)
-            create_pipe (session, this, options.hwm, options.swap,
-                &outpipe_reader, &outpipe_writer);
+            create_pipe (session, this,
+                options.lossless_out ? 0 : options.hwm, options.swap,
+                std::string (), &outpipe_reader, &outpipe_writer);
 
         //  Attach the pipes to the socket object.
         attach_pipes (inpipe_reader, outpipe_writer, blob_t ());
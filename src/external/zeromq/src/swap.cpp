@@ -25,6 +25,7 @@
 #include <io.h>
 #else
 #include <unistd.h>
+#include <sys/mman.h>
 #endif
 
 #include "../include/zmq.h"
@@ -41,31 +42,42 @@
 #include "atomic_counter.hpp"
 #include "err.hpp"
 
-zmq::swap_t::swap_t (int64_t filesize_) :
+static const unsigned char swap_magic [8] =
+    {'Z', 'M', 'Q', 'S', 'W', 'A', 'P', 1};
+
+zmq::swap_t::swap_t (int64_t filesize_, const std::string &name_) :
     fd (-1),
+    filename (name_),
+    durable (!name_.empty ()),
     filesize (filesize_),
-    file_pos (0),
+    mapping (NULL),
+    mapping_handle (NULL),
+    header (NULL),
+    data (NULL),
     write_pos (0),
     read_pos (0),
-    block_size (swap_block_size),
-    write_buf_start_addr (0)
+    commit_pos (0)
 {
     zmq_assert (filesize > 0);
-    zmq_assert (block_size > 0);
-
-    buf1 = new (std::nothrow) char [block_size];
-    alloc_assert (buf1);
-
-    buf2 = new (std::nothrow) char [block_size];
-    alloc_assert (buf2);
-
-    read_buf = write_buf = buf1;
+    zmq_assert (sizeof (header_t) <= swap_header_size);
 }
 
 zmq::swap_t::~swap_t ()
 {
-    delete [] buf1;
-    delete [] buf2;
+    //  A durable swap is kept as long as it holds some messages.
+    bool keep = durable && header && header->read_pos != header->write_pos;
+
+    if (mapping) {
+#ifdef ZMQ_HAVE_WINDOWS
+        BOOL brc = UnmapViewOfFile (mapping);
+        win_assert (brc);
+        brc = CloseHandle ((HANDLE) mapping_handle);
+        win_assert (brc);
+#else
+        int rc = munmap (mapping, (size_t) (swap_header_size + filesize));
+        errno_assert (rc == 0);
+#endif
+    }
 
     if (fd == -1)
         return;
@@ -77,6 +89,9 @@ zmq::swap_t::~swap_t ()
 #endif
     errno_assert (rc == 0);
 
+    if (keep)
+        return;
+
 #ifdef ZMQ_HAVE_WINDOWS
     rc = _unlink (filename.c_str ());
 #else
@@ -87,34 +102,102 @@ zmq::swap_t::~swap_t ()
 
 int zmq::swap_t::init ()
 {
-    static zmq::atomic_counter_t seqnum (0);
+    if (!durable) {
+        static zmq::atomic_counter_t seqnum (0);
 
-    //  Get process ID.
+        //  Get process ID.
 #ifdef ZMQ_HAVE_WINDOWS
-    int pid = GetCurrentThreadId ();
+        int pid = GetCurrentThreadId ();
 #else
-    pid_t pid = getpid ();
+        pid_t pid = getpid ();
 #endif
 
-    std::ostringstream outs;
-    outs << "zmq_" << pid << '_' << seqnum.get () << ".swap";
-    filename = outs.str ();
+        std::ostringstream outs;
+        outs << "zmq_" << pid << '_' << seqnum.get () << ".swap";
+        filename = outs.str ();
 
-    seqnum.add (1);
+        seqnum.add (1);
+    }
 
     //  Open the backing file.
 #ifdef ZMQ_HAVE_WINDOWS
-    fd = _open (filename.c_str (), _O_RDWR | _O_CREAT, 0600);
+    fd = _open (filename.c_str (), _O_RDWR | _O_CREAT | _O_BINARY, 0600);
 #else
     fd = open (filename.c_str (), O_RDWR | O_CREAT, 0600);
 #endif
     if (fd == -1)
         return -1;
 
-#if (defined (ZMQ_HAVE_LINUX) && !defined (ZMQ_HAVE_ANDROID))
-    //  Enable more aggresive read-ahead optimization.
-    posix_fadvise (fd, 0, filesize, POSIX_FADV_SEQUENTIAL);
+    //  Only a durable swap of the same size is recovered, anything else
+    //  found in the file is discarded.
+    int64_t size = swap_header_size + filesize;
+    bool recover = false;
+    if (durable) {
+#ifdef ZMQ_HAVE_WINDOWS
+        recover = _filelengthi64 (fd) == size;
+#else
+        struct stat stat_buf;
+        int rc = fstat (fd, &stat_buf);
+        errno_assert (rc == 0);
+        recover = stat_buf.st_size == size;
+#endif
+    }
+    if (!recover) {
+#ifdef ZMQ_HAVE_WINDOWS
+        if (_chsize_s (fd, 0) != 0 || _chsize_s (fd, size) != 0)
+            return -1;
+#else
+        if (ftruncate (fd, 0) == -1 || ftruncate (fd, (off_t) size) == -1)
+            return -1;
+#endif
+    }
+
+    return map (recover);
+}
+
+int zmq::swap_t::map (bool recover_)
+{
+    size_t size = (size_t) (swap_header_size + filesize);
+
+#ifdef ZMQ_HAVE_WINDOWS
+    mapping_handle = (void*) CreateFileMapping ((HANDLE) _get_osfhandle (fd),
+        NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32),
+        (DWORD) size, NULL);
+    if (!mapping_handle)
+        return -1;
+    mapping = MapViewOfFile ((HANDLE) mapping_handle, FILE_MAP_ALL_ACCESS,
+        0, 0, 0);
+    if (!mapping)
+        return -1;
+#else
+    mapping = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = NULL;
+        return -1;
+    }
+
+    //  The ring is written and read sequentially.
+    madvise ((char*) mapping + swap_header_size, (size_t) filesize,
+        MADV_SEQUENTIAL);
 #endif
+
+    header = (header_t*) mapping;
+    data = (unsigned char*) mapping + swap_header_size;
+
+    //  Recover the positions of the messages left by the previous owner.
+    if (recover_ && memcmp (header->magic, swap_magic,
+          sizeof swap_magic) == 0 && header->filesize == filesize &&
+          header->read_pos >= 0 && header->read_pos < filesize &&
+          header->write_pos >= 0 && header->write_pos < filesize) {
+        read_pos = header->read_pos;
+        write_pos = commit_pos = header->write_pos;
+        return 0;
+    }
+
+    memcpy (header->magic, swap_magic, sizeof swap_magic);
+    header->filesize = filesize;
+    header->read_pos = 0;
+    header->write_pos = 0;
     return 0;
 }
 
@@ -131,9 +214,9 @@ bool zmq::swap_t::store (zmq_msg_t *msg_)
     uint8_t msg_flags = msg_->flags & ~ZMQ_MSG_SHARED;
 
     //  Write message length, flags, and message body.
-    copy_to_file (&msg_size, sizeof msg_size);
-    copy_to_file (&msg_flags, sizeof msg_flags);
-    copy_to_file (zmq_msg_data (msg_), msg_size);
+    copy_to_swap (&msg_size, sizeof msg_size);
+    copy_to_swap (&msg_flags, sizeof msg_flags);
+    copy_to_swap (zmq_msg_data (msg_), msg_size);
 
     return true;
 }
@@ -145,21 +228,26 @@ void zmq::swap_t::fetch (zmq_msg_t *msg_)
 
     //  Retrieve the message size.
     size_t msg_size;
-    copy_from_file (&msg_size, sizeof msg_size);
+    copy_from_swap (&msg_size, sizeof msg_size);
 
     //  Initialize the message.
     zmq_msg_init_size (msg_, msg_size);
 
     //  Retrieve the message flags.
-    copy_from_file (&msg_->flags, sizeof msg_->flags);
+    copy_from_swap (&msg_->flags, sizeof msg_->flags);
 
     //  Retrieve the message payload.
-    copy_from_file (zmq_msg_data (msg_), msg_size);
+    copy_from_swap (zmq_msg_data (msg_), msg_size);
+
+    //  Recovery restarts at the first part of a message.
+    if (!(msg_->flags & ZMQ_MSG_MORE))
+        header->read_pos = read_pos;
 }
 
 void zmq::swap_t::commit ()
 {
     commit_pos = write_pos;
+    header->write_pos = commit_pos;
 }
 
 void zmq::swap_t::rollback ()
@@ -172,14 +260,6 @@ void zmq::swap_t::rollback ()
     else
         zmq_assert (read_pos <= commit_pos || commit_pos <= write_pos);
 
-    if (commit_pos / block_size == read_pos / block_size) {
-        write_buf_start_addr = commit_pos % block_size;
-        write_buf = read_buf;
-    }
-    else if (commit_pos / block_size != write_pos / block_size) {
-        write_buf_start_addr = commit_pos % block_size;
-        fill_buf (write_buf, write_buf_start_addr);
-    }
     write_pos = commit_pos;
 }
 
@@ -188,14 +268,6 @@ bool zmq::swap_t::empty ()
     return read_pos == write_pos;
 }
 
-/*
-bool zmq::swap_t::full ()
-{
-    //  Check that at least the message size can be written to the swap.
-    return buffer_space () < (int64_t) (sizeof (size_t) + 1);
-}
-*/
-
 bool zmq::swap_t::fits (zmq_msg_t *msg_)
 {
     //  Check whether whole binary representation of the message
@@ -204,116 +276,36 @@ bool zmq::swap_t::fits (zmq_msg_t *msg_)
     if (buffer_space () <= (int64_t) (sizeof msg_size + 1 + msg_size))
         return false;
     return true;
- }
+}
 
-void zmq::swap_t::copy_from_file (void *buffer_, size_t count_)
+void zmq::swap_t::copy_from_swap (void *buffer_, size_t count_)
 {
-    char *dest_ptr = (char *) buffer_;
+    unsigned char *dest_ptr = (unsigned char*) buffer_;
     size_t chunk_size, remainder = count_;
 
     while (remainder > 0) {
-        chunk_size = std::min (remainder,
-            std::min ((size_t) (filesize - read_pos),
-            (size_t) (block_size - read_pos % block_size)));
-
-        memcpy (dest_ptr, &read_buf [read_pos % block_size], chunk_size);
+        chunk_size = std::min (remainder, (size_t) (filesize - read_pos));
+        memcpy (dest_ptr, data + read_pos, chunk_size);
         dest_ptr += chunk_size;
-
         read_pos = (read_pos + chunk_size) % filesize;
-        if (read_pos % block_size == 0) {
-            if (read_pos / block_size == write_pos / block_size)
-                read_buf = write_buf;
-            else
-                fill_buf (read_buf, read_pos);
-        }
         remainder -= chunk_size;
     }
 }
 
-void zmq::swap_t::copy_to_file (const void *buffer_, size_t count_)
+void zmq::swap_t::copy_to_swap (const void *buffer_, size_t count_)
 {
-    char *source_ptr = (char *) buffer_;
+    const unsigned char *source_ptr = (const unsigned char*) buffer_;
     size_t chunk_size, remainder = count_;
 
     while (remainder > 0) {
-        chunk_size = std::min (remainder,
-            std::min ((size_t) (filesize - write_pos),
-            (size_t) (block_size - write_pos % block_size)));
-
-        memcpy (&write_buf [write_pos % block_size], source_ptr, chunk_size);
+        chunk_size = std::min (remainder, (size_t) (filesize - write_pos));
+        memcpy (data + write_pos, source_ptr, chunk_size);
         source_ptr += chunk_size;
-
         write_pos = (write_pos + chunk_size) % filesize;
-        if (write_pos % block_size == 0) {
-            save_write_buf ();
-            write_buf_start_addr = write_pos;
-
-            if (write_buf == read_buf) {
-                if (read_buf == buf2)
-                    write_buf = buf1;
-                else
-                    write_buf = buf2;
-            }
-        }
         remainder -= chunk_size;
     }
 }
 
-void zmq::swap_t::fill_buf (char *buf, int64_t pos)
-{
-    if (file_pos != pos) {
-#ifdef ZMQ_HAVE_WINDOWS
-        __int64 offset = _lseeki64 (fd, pos, SEEK_SET);
-#else
-        off_t offset = lseek (fd, (off_t) pos, SEEK_SET);
-#endif
-        errno_assert (offset == pos);
-        file_pos = pos;
-    }
-    size_t octets_stored = 0;
-    size_t octets_total = std::min (block_size, (size_t) (filesize - file_pos));
-
-    while (octets_stored < octets_total) {
-#ifdef ZMQ_HAVE_WINDOWS
-        int rc = _read (fd, &buf [octets_stored], octets_total - octets_stored);
-#else
-        ssize_t rc = read (fd, &buf [octets_stored],
-            octets_total - octets_stored);
-#endif
-        errno_assert (rc > 0);
-        octets_stored += rc;
-    }
-    file_pos += octets_total;
-}
-
-void zmq::swap_t::save_write_buf ()
-{
-    if (file_pos != write_buf_start_addr) {
-#ifdef ZMQ_HAVE_WINDOWS
-        __int64 offset = _lseeki64 (fd, write_buf_start_addr, SEEK_SET);
-#else
-        off_t offset = lseek (fd, (off_t) write_buf_start_addr, SEEK_SET);
-#endif
-        errno_assert (offset == write_buf_start_addr);
-        file_pos = write_buf_start_addr;
-    }
-    size_t octets_stored = 0;
-    size_t octets_total = std::min (block_size, (size_t) (filesize - file_pos));
-
-    while (octets_stored < octets_total) {
-#ifdef ZMQ_HAVE_WINDOWS
-        int rc = _write (fd, &write_buf [octets_stored],
-            octets_total - octets_stored);
-#else
-        ssize_t rc = write (fd, &write_buf [octets_stored],
-            octets_total - octets_stored);
-#endif
-        errno_assert (rc > 0);
-        octets_stored += rc;
-    }
-    file_pos += octets_total;
-}
-
 int64_t zmq::swap_t::buffer_space ()
 {
     if (write_pos < read_pos)
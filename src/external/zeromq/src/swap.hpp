@@ -30,16 +30,23 @@ namespace zmq
 {
 
     //  This class implements a message swap. Messages are retrieved from
-    //  the swap in the same order as they entered it.
+    //  the swap in the same order as they entered it. The backing file is
+    //  memory-mapped and used as a ring buffer.
+    //
+    //  A swap created with a name is durable: the file is kept while it
+    //  holds messages and the committed read and write positions are
+    //  stored in its header, so that the messages still in the swap are
+    //  recovered when a swap with the same name and size is created
+    //  after the process restarts. Messages already moved from the swap
+    //  to the in-memory pipe are not covered. Data is not synced to the
+    //  disk, so the swap survives a process crash but not a system crash.
 
     class swap_t
     {
     public:
 
-        enum { default_block_size = 8192 };
-
-        //  Creates the swap.
-        swap_t (int64_t filesize_);
+        //  Creates the swap. If name_ is empty, a scratch file is used.
+        swap_t (int64_t filesize_, const std::string &name_);
 
         ~swap_t ();
 
@@ -60,29 +67,33 @@ namespace zmq
         //  Returns true if the swap is empty; false otherwise.
         bool empty ();
 
-
-//        //  Returns true if and only if the swap is full.
-//        bool full ();
-
         //  Returns true if the message fits into swap.
         bool fits (zmq_msg_t *msg_);
 
     private:
 
-        //  Copies data from a memory buffer to the backing file.
-        //  Wraps around when reaching maximum file size.
-        void copy_from_file (void *buffer_, size_t count_);
+        //  Layout of the header stored at the start of the backing file.
+        struct header_t
+        {
+            unsigned char magic [8];
+            int64_t filesize;
+            int64_t read_pos;
+            int64_t write_pos;
+        };
 
-        //  Copies data from the backing file to the memory buffer.
-        //  Wraps around when reaching end-of-file.
-        void copy_to_file (const void *buffer_, size_t count_);
+        //  Copies data from the ring to a memory buffer.
+        //  Wraps around when reaching end of the ring.
+        void copy_from_swap (void *buffer_, size_t count_);
+
+        //  Copies data from a memory buffer to the ring.
+        //  Wraps around when reaching end of the ring.
+        void copy_to_swap (const void *buffer_, size_t count_);
 
         //  Returns the buffer space available.
         int64_t buffer_space ();
 
-        void fill_buf (char *buf, int64_t pos);
-
-        void save_write_buf ();
+        //  Maps the backing file to memory.
+        int map (bool recover_);
 
         //  File descriptor to the backing file.
         int fd;
@@ -90,29 +101,27 @@ namespace zmq
         //  Name of the backing file.
         std::string filename;
 
-        //  Maximum size of the backing file.
+        //  If true, the backing file survives the swap object.
+        bool durable;
+
+        //  Maximum size of the ring.
         int64_t filesize;
 
-        //  File offset associated with the fd file descriptor.
-        int64_t file_pos;
+        //  Mapping of the whole backing file, header included.
+        void *mapping;
+        void *mapping_handle;
+        header_t *header;
+        unsigned char *data;
 
-        //  File offset the next message will be stored at.
+        //  Ring offset the next message will be stored at.
         int64_t write_pos;
 
-        //  File offset the next message will be read from.
+        //  Ring offset the next message will be read from.
         int64_t read_pos;
 
+        //  Ring offset just past the last complete message.
         int64_t commit_pos;
 
-        size_t block_size;
-
-        char *buf1;
-        char *buf2;
-        char *read_buf;
-        char *write_buf;
-
-        int64_t write_buf_start_addr;
-
         //  Disable copying of the swap object.
         swap_t (const swap_t&);
         const swap_t &operator = (const swap_t&);
@@ -20,6 +20,7 @@
 
 #include "tcp_socket.hpp"
 #include "platform.hpp"
+#include "config.hpp"
 #include "err.hpp"
 
 #ifdef ZMQ_HAVE_WINDOWS
@@ -95,6 +96,38 @@ int zmq::tcp_socket_t::write (const void *data, int size)
     return (size_t) nbytes;
 }
 
+size_t zmq::tcp_socket_t::writev (const iovec *iov, int iovcnt)
+{
+    WSABUF buffers [out_batch_iov];
+    zmq_assert (iovcnt <= out_batch_iov);
+    for (int i = 0; i != iovcnt; i++) {
+        buffers [i].buf = (char*) iov [i].iov_base;
+        buffers [i].len = (ULONG) iov [i].iov_len;
+    }
+
+    DWORD nbytes;
+    int rc = WSASend (s, buffers, iovcnt, &nbytes, 0, NULL, NULL);
+
+    //  If not a single byte can be written to the socket in non-blocking mode
+    //  we'll get an error (this may happen during the speculative write).
+    if (rc == SOCKET_ERROR && WSAGetLastError () == WSAEWOULDBLOCK)
+        return 0;
+
+    //  Signalise peer failure.
+    if (rc == SOCKET_ERROR && (
+          WSAGetLastError () == WSAENETDOWN ||
+          WSAGetLastError () == WSAENETRESET ||
+          WSAGetLastError () == WSAEHOSTUNREACH ||
+          WSAGetLastError () == WSAECONNABORTED ||
+          WSAGetLastError () == WSAETIMEDOUT ||
+          WSAGetLastError () == WSAECONNRESET))
+        return (size_t) -1;
+
+    wsa_assert (rc != SOCKET_ERROR);
+
+    return (size_t) nbytes;
+}
+
 int zmq::tcp_socket_t::read (void *data, int size)
 {
     int nbytes = recv (s, (char*) data, size, 0);
@@ -204,6 +237,25 @@ int zmq::tcp_socket_t::write (const void *data, int size)
     return (size_t) nbytes;
 }
 
+size_t zmq::tcp_socket_t::writev (const iovec *iov, int iovcnt)
+{
+    ssize_t nbytes = ::writev (s, iov, iovcnt);
+
+    //  Several errors are OK. When speculative write is being done we may not
+    //  be able to write a single byte to the socket. Also, SIGSTOP issued
+    //  by a debugging tool can result in EINTR error.
+    if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+          errno == EINTR))
+        return 0;
+
+    //  Signalise peer failure.
+    if (nbytes == -1 && (errno == ECONNRESET || errno == EPIPE))
+        return (size_t) -1;
+
+    errno_assert (nbytes != -1);
+    return (size_t) nbytes;
+}
+
 int zmq::tcp_socket_t::read (void *data, int size)
 {
     ssize_t nbytes = recv (s, data, size, 0);
@@ -235,5 +287,54 @@ int zmq::tcp_socket_t::read (void *data, int size)
     return (size_t) nbytes;
 }
 
+#if defined ZMQ_FORCE_IO_URING
+
+size_t zmq::tcp_socket_t::read_result (int result_)
+{
+    //  Orderly shutdown by the other peer.
+    if (result_ == 0)
+        return (size_t) -1;
+
+    if (result_ > 0)
+        return (size_t) result_;
+
+    //  The same errors are OK as in read. A cancelled request didn't read
+    //  anything.
+    errno = -result_;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+          errno == ECANCELED)
+        return 0;
+
+    //  Signal peer failure.
+    if (errno == ECONNRESET || errno == ECONNREFUSED || errno == ETIMEDOUT ||
+          errno == EHOSTUNREACH || errno == ENOTCONN)
+        return (size_t) -1;
+
+    errno_assert (false);
+    return 0;
+}
+
+size_t zmq::tcp_socket_t::write_result (int result_)
+{
+    if (result_ >= 0)
+        return (size_t) result_;
+
+    //  The same errors are OK as in writev. A cancelled request didn't
+    //  write anything.
+    errno = -result_;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+          errno == ECANCELED)
+        return 0;
+
+    //  Signalise peer failure.
+    if (errno == ECONNRESET || errno == EPIPE)
+        return (size_t) -1;
+
+    errno_assert (false);
+    return 0;
+}
+
+#endif
+
 #endif
 
@@ -51,12 +51,25 @@ namespace zmq
         //  of error or orderly shutdown by the other peer -1 is returned.
         int write (const void *data, int size);
 
+        //  Writes the chunks of data to the socket. Returns the number of
+        //  bytes actually written (even zero is to be considered to be
+        //  a success). In case of error or orderly shutdown by the other
+        //  peer (size_t) -1 is returned.
+        size_t writev (const iovec *iov, int iovcnt);
+
         //  Reads data from the socket (up to 'size' bytes). Returns the number
         //  of bytes actually read (even zero is to be considered to be
         //  a success). In case of error or orderly shutdown by the other
         //  peer -1 is returned.
         int read (void *data, int size);
 
+#if defined ZMQ_FORCE_IO_URING
+        //  Map the result of a completed read or write request (the number
+        //  of bytes or -errno) to what read and writev return.
+        static size_t read_result (int result_);
+        static size_t write_result (int result_);
+#endif
+
     private:
 
         //  Underlying socket.
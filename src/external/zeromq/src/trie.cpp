@@ -19,6 +19,7 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <new>
 #include <algorithm>
@@ -28,13 +29,42 @@
 #include "windows.hpp"
 #endif
 
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define ZMQ_TRIE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "err.hpp"
 #include "trie.hpp"
 
+//  Returns the number of leading characters that are equal in both buffers.
+//  Compressed prefixes are compared 16 characters at a time when SSE2
+//  is available.
+static inline size_t common_size (const unsigned char *a_,
+    const unsigned char *b_, size_t size_)
+{
+    size_t i = 0;
+#if defined ZMQ_TRIE_SSE2
+    while (size_ - i >= 16) {
+        __m128i a = _mm_loadu_si128 ((const __m128i*) (a_ + i));
+        __m128i b = _mm_loadu_si128 ((const __m128i*) (b_ + i));
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)) != 0xffff)
+            break;
+        i += 16;
+    }
+#endif
+    while (i != size_ && a_ [i] == b_ [i])
+        i++;
+    return i;
+}
+
 zmq::trie_t::trie_t () :
     refcnt (0),
     min (0),
-    count (0)
+    count (0),
+    prefix (NULL),
+    prefix_size (0)
 {
 }
 
@@ -48,17 +78,12 @@ zmq::trie_t::~trie_t ()
                 delete next.table [i];
         free (next.table);
     }
+    free (prefix);
 }
 
-void zmq::trie_t::add (unsigned char *prefix_, size_t size_)
+zmq::trie_t **zmq::trie_t::slot (unsigned char c_)
 {
-    //  We are at the node corresponding to the prefix. We are done.
-    if (!size_) {
-        ++refcnt;
-        return;
-    }
-
-    unsigned char c = *prefix_;
+    unsigned char c = c_;
     if (c < min || c >= min + count) {
 
         //  The character is out of range of currently handled
@@ -107,43 +132,103 @@ void zmq::trie_t::add (unsigned char *prefix_, size_t size_)
         }
     }
 
-    //  If next node does not exist, create one.
-    if (count == 1) {
-        if (!next.node) {
-            next.node = new (std::nothrow) trie_t;
-            alloc_assert (next.node);
-        }
-        next.node->add (prefix_ + 1, size_ - 1);
+    if (count == 1)
+        return &next.node;
+    return &next.table [c - min];
+}
+
+void zmq::trie_t::split (size_t size_)
+{
+    zmq_assert (size_ < prefix_size);
+
+    //  The new node takes over the subscriptions and the children
+    //  of this node, with the remainder of the prefix.
+    trie_t *tail = new (std::nothrow) trie_t;
+    alloc_assert (tail);
+    tail->refcnt = refcnt;
+    tail->min = min;
+    tail->count = count;
+    tail->next = next;
+    tail->prefix_size = prefix_size - size_ - 1;
+    if (tail->prefix_size) {
+        tail->prefix = (unsigned char*) malloc (tail->prefix_size);
+        alloc_assert (tail->prefix);
+        memcpy (tail->prefix, prefix + size_ + 1, tail->prefix_size);
     }
-    else {
-        if (!next.table [c - min]) {
-            next.table [c - min] = new (std::nothrow) trie_t;
-            alloc_assert (next.table [c - min]);
+
+    refcnt = 0;
+    min = prefix [size_];
+    count = 1;
+    next.node = tail;
+    prefix_size = size_;
+}
+
+bool zmq::trie_t::add (unsigned char *prefix_, size_t size_)
+{
+    trie_t *current = this;
+    while (size_) {
+
+        //  If next node does not exist, create one holding the rest
+        //  of the prefix.
+        trie_t **node = current->slot (*prefix_);
+        prefix_++;
+        size_--;
+        if (!*node) {
+            *node = new (std::nothrow) trie_t;
+            alloc_assert (*node);
+            if (size_) {
+                (*node)->prefix = (unsigned char*) malloc (size_);
+                alloc_assert ((*node)->prefix);
+                memcpy ((*node)->prefix, prefix_, size_);
+                (*node)->prefix_size = size_;
+            }
+            current = *node;
+            break;
         }
-        next.table [c - min]->add (prefix_ + 1, size_ - 1);
+        current = *node;
+
+        //  If the prefix diverges within the compressed part of the node
+        //  the node has to be split at that point.
+        size_t size = common_size (current->prefix, prefix_,
+            std::min (current->prefix_size, size_));
+        if (size != current->prefix_size)
+            current->split (size);
+        prefix_ += size;
+        size_ -= size;
     }
+
+    //  We are at the node corresponding to the prefix. We are done.
+    ++current->refcnt;
+    return current->refcnt == 1;
 }
 
 bool zmq::trie_t::rm (unsigned char *prefix_, size_t size_)
 {
-     if (!size_) {
-         if (!refcnt)
-             return false;
-         refcnt--;
-         return true;
-     }
-
-     unsigned char c = *prefix_;
-     if (!count || c < min || c >= min + count)
-         return false;
+    trie_t *current = this;
+    while (size_) {
+        unsigned char c = *prefix_;
+        if (!current->count || c < current->min ||
+              c >= current->min + current->count)
+            return false;
 
-     trie_t *next_node =
-         count == 1 ? next.node : next.table [c - min];
+        current = current->count == 1 ?
+            current->next.node : current->next.table [c - current->min];
+        if (!current)
+            return false;
+        prefix_++;
+        size_--;
 
-     if (!next_node)
-         return false;
+        if (size_ < current->prefix_size || common_size (current->prefix,
+              prefix_, current->prefix_size) != current->prefix_size)
+            return false;
+        prefix_ += current->prefix_size;
+        size_ -= current->prefix_size;
+    }
 
-     return next_node->rm (prefix_ + 1, size_ - 1);
+    if (!current->refcnt)
+        return false;
+    current->refcnt--;
+    return current->refcnt == 0;
 }
 
 bool zmq::trie_t::check (unsigned char *data_, size_t size_)
@@ -177,5 +262,61 @@ bool zmq::trie_t::check (unsigned char *data_, size_t size_)
         }
         data_++;
         size_--;
+
+        //  The compressed part of the node has to match as a whole,
+        //  since subscriptions only end at nodes.
+        if (current->prefix_size) {
+            if (size_ < current->prefix_size || common_size (current->prefix,
+                  data_, current->prefix_size) != current->prefix_size)
+                return false;
+            data_ += current->prefix_size;
+            size_ -= current->prefix_size;
+        }
+    }
+}
+
+void zmq::trie_t::apply (void (*func_) (unsigned char *data_, size_t size_,
+    void *arg_), void *arg_)
+{
+    unsigned char *buff = NULL;
+    size_t maxbuffsize = 0;
+    apply_helper (&buff, 0, &maxbuffsize, func_, arg_);
+    free (buff);
+}
+
+void zmq::trie_t::apply_helper (unsigned char **buff_, size_t buffsize_,
+    size_t *maxbuffsize_, void (*func_) (unsigned char *data_, size_t size_,
+    void *arg_), void *arg_)
+{
+    //  Append the compressed part of the node and one character for
+    //  the children to the buffer.
+    size_t needed = buffsize_ + prefix_size + 1;
+    if (needed > *maxbuffsize_) {
+        *maxbuffsize_ = needed + 256;
+        *buff_ = (unsigned char*) realloc (*buff_, *maxbuffsize_);
+        alloc_assert (*buff_);
+    }
+    if (prefix_size)
+        memcpy (*buff_ + buffsize_, prefix, prefix_size);
+    buffsize_ += prefix_size;
+
+    //  If this node is a subscription, apply the function.
+    if (refcnt)
+        func_ (*buff_, buffsize_, arg_);
+
+    //  Adjust the buffer and apply the function to the children.
+    if (count == 1 && next.node) {
+        (*buff_) [buffsize_] = min;
+        next.node->apply_helper (buff_, buffsize_ + 1, maxbuffsize_,
+            func_, arg_);
+    }
+    else if (count > 1) {
+        for (unsigned short c = 0; c != count; c++) {
+            if (next.table [c]) {
+                (*buff_) [buffsize_] = min + c;
+                next.table [c]->apply_helper (buff_, buffsize_ + 1,
+                    maxbuffsize_, func_, arg_);
+            }
+        }
     }
 }
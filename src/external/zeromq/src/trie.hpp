@@ -35,12 +35,34 @@ namespace zmq
         trie_t ();
         ~trie_t ();
 
-        void add (unsigned char *prefix_, size_t size_);
+        //  Add key to the trie. Returns true if this is a new item in the trie
+        //  rather than a duplicate.
+        bool add (unsigned char *prefix_, size_t size_);
+
+        //  Remove key from the trie. Returns true if the item is actually
+        //  removed from the trie, i.e. it was the last reference to it.
         bool rm (unsigned char *prefix_, size_t size_);
+
+        //  Check whether particular key is in the trie.
         bool check (unsigned char *data_, size_t size_);
 
+        //  Apply the function supplied to each subscription in the trie.
+        void apply (void (*func_) (unsigned char *data_, size_t size_,
+            void *arg_), void *arg_);
+
     private:
 
+        void apply_helper (unsigned char **buff_, size_t buffsize_,
+            size_t *maxbuffsize_, void (*func_) (unsigned char *data_,
+            size_t size_, void *arg_), void *arg_);
+
+        //  Returns the slot for the child node starting with the character,
+        //  extending the table of children as needed.
+        trie_t **slot (unsigned char c_);
+
+        //  Splits the compressed prefix of the node after size_ characters.
+        void split (size_t size_);
+
         uint32_t refcnt;
         unsigned char min;
         unsigned short count;
@@ -49,6 +71,12 @@ namespace zmq
             class trie_t **table;
         } next;
 
+        //  Characters that follow the character used to reach the node
+        //  (the path is compressed so that nodes exist only where
+        //  subscriptions end or branch).
+        unsigned char *prefix;
+        size_t prefix_size;
+
         trie_t (const trie_t&);
         const trie_t &operator = (const trie_t&);
     };
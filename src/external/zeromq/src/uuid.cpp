@@ -18,154 +18,238 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "platform.hpp"
 #include "uuid.hpp"
 #include "err.hpp"
 
 #if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#include <rpc.h>
+#elif defined ZMQ_HAVE_FREEBSD || defined ZMQ_HAVE_NETBSD
+#include <uuid.h>
+#elif defined ZMQ_HAVE_HPUX && defined HAVE_LIBDCEKT
+#include <dce/uuid.h>
+#elif defined ZMQ_HAVE_LINUX || defined ZMQ_HAVE_SOLARIS ||\
+      defined ZMQ_HAVE_OSX || defined ZMQ_HAVE_CYGWIN
+#include <uuid/uuid.h>
+#elif defined ZMQ_HAVE_OPENVMS
+#include <starlet.h>
+#else
+#include <openssl/rand.h>
+#endif
 
-zmq::uuid_t::uuid_t ()
-{
-    RPC_STATUS ret = UuidCreate (&uuid);
-    zmq_assert (ret == RPC_S_OK);
-    ret = UuidToString (&uuid, &string_buf);
-    zmq_assert (ret == RPC_S_OK);
-
-    create_blob ();
-}
-
-zmq::uuid_t::~uuid_t ()
-{
-    if (string_buf)
-        RpcStringFree (&string_buf);
-}
-
-const char *zmq::uuid_t::to_string ()
-{
-    return (char*) string_buf;
-}
+#if !defined ZMQ_HAVE_WINDOWS
+#include <sys/time.h>
+#include <pthread.h>
+#endif
 
-#elif defined ZMQ_HAVE_FREEBSD || defined ZMQ_HAVE_NETBSD || (defined ZMQ_HAVE_HPUX && defined HAVE_LIBDCEKT)
+#include <string.h>
 
-#include <stdlib.h>
-#ifdef ZMQ_HAVE_HPUX
-#  include <dce/uuid.h>
+#if defined ZMQ_FORCE_MUTEXES
+#define ZMQ_UUID_MUTEX
+#elif defined __GCC_HAVE_SYNC_COMPARE_AND_SWAP_8
+#define ZMQ_UUID_SYNC
+#elif defined ZMQ_HAVE_WINDOWS
+#define ZMQ_UUID_WINDOWS
+#elif (defined ZMQ_HAVE_SOLARIS || defined ZMQ_HAVE_NETBSD)
+#define ZMQ_UUID_ATOMIC_H
 #else
-#  include <uuid.h>
+#define ZMQ_UUID_MUTEX
 #endif
 
-zmq::uuid_t::uuid_t ()
+#if defined ZMQ_UUID_MUTEX
+#include "mutex.hpp"
+#elif defined ZMQ_UUID_ATOMIC_H
+#include <atomic.h>
+#endif
+
+//  Fills the buffer with a UUID generated by the system. Only its random
+//  bits matter here, so the byte order of the fields is irrelevant.
+static void system_uuid (unsigned char *buf_)
 {
+#if defined ZMQ_HAVE_WINDOWS
+    ::UUID uuid;
+    RPC_STATUS ret = UuidCreate (&uuid);
+    zmq_assert (ret == RPC_S_OK);
+    memcpy (buf_, &uuid, 16);
+#elif defined ZMQ_HAVE_FREEBSD || defined ZMQ_HAVE_NETBSD ||\
+      (defined ZMQ_HAVE_HPUX && defined HAVE_LIBDCEKT)
 #ifdef ZMQ_HAVE_HPUX
     unsigned32 status;
 #else
     uint32_t status;
 #endif
+    ::uuid_t uuid;
     uuid_create (&uuid, &status);
     zmq_assert (status == uuid_s_ok);
-    uuid_to_string (&uuid, &string_buf, &status);
-    zmq_assert (status == uuid_s_ok);
-
-    create_blob ();
+    memcpy (buf_, &uuid, 16);
+#elif defined ZMQ_HAVE_LINUX || defined ZMQ_HAVE_SOLARIS ||\
+      defined ZMQ_HAVE_OSX || defined ZMQ_HAVE_CYGWIN
+    ::uuid_t uuid;
+    uuid_generate (uuid);
+    memcpy (buf_, uuid, 16);
+#elif defined ZMQ_HAVE_OPENVMS
+    struct
+    {
+        unsigned long data0;
+        unsigned short data1;
+        unsigned short data2;
+        unsigned char data3 [8];
+    } uuid;
+    sys$create_uid (&uuid);
+    memcpy (buf_, &uuid, 16);
+#else
+    int ret = RAND_bytes (buf_, 16);
+    zmq_assert (ret == 1);
+#endif
 }
 
-zmq::uuid_t::~uuid_t ()
+//  Current time as a count of 100-nanosecond intervals since the adoption
+//  of the Gregorian calendar (15 October 1582).
+static uint64_t gregorian_time ()
 {
-    free (string_buf);
+#if defined ZMQ_HAVE_WINDOWS
+    //  FILETIME counts the same intervals from 1 January 1601.
+    FILETIME ft;
+    GetSystemTimeAsFileTime (&ft);
+    return (((uint64_t) ft.dwHighDateTime << 32) | ft.dwLowDateTime) +
+        0x146BF33E42C000ULL;
+#else
+    struct timeval tv;
+    int rc = gettimeofday (&tv, NULL);
+    errno_assert (rc == 0);
+    return (uint64_t) tv.tv_sec * 10000000 + tv.tv_usec * 10 +
+        0x01B21DD213814000ULL;
+#endif
 }
 
-const char *zmq::uuid_t::to_string ()
+namespace zmq
 {
-    return (char*) string_buf;
-}
 
-#elif defined ZMQ_HAVE_LINUX || defined ZMQ_HAVE_SOLARIS ||\
-      defined ZMQ_HAVE_OSX || defined ZMQ_HAVE_CYGWIN
+    //  Process-wide state of the UUID generator.
+    struct uuid_state_t
+    {
+        //  Timestamp of the last UUID generated. Updated by 'compare and
+        //  swap' so that concurrent generators never get the same one.
+        volatile uint64_t last_time;
 
-#include <uuid/uuid.h>
+        //  Bytes 8 to 15 of the UUID: variant, clock sequence and node ID.
+        unsigned char clock_seq_and_node [8];
 
-zmq::uuid_t::uuid_t ()
-{
-    uuid_generate (uuid);
-    uuid_unparse (uuid, string_buf);
+#if defined ZMQ_UUID_MUTEX
+        mutex_t sync;
+#endif
+    };
 
-    create_blob ();
 }
 
-zmq::uuid_t::~uuid_t ()
-{
-}
+static zmq::uuid_state_t state;
 
-const char *zmq::uuid_t::to_string ()
+//  Picks a random clock sequence and node ID. As the node ID is not an
+//  IEEE 802 address, its multicast bit is set, as required by RFC 4122.
+static void seed ()
 {
-    return string_buf;
+    unsigned char buf [16];
+    system_uuid (buf);
+    state.clock_seq_and_node [0] = (buf [8] & 0x3f) | 0x80;
+    state.clock_seq_and_node [1] = buf [9];
+    memcpy (state.clock_seq_and_node + 2, buf + 10, 6);
+    state.clock_seq_and_node [2] |= 0x01;
 }
 
-#elif defined ZMQ_HAVE_OPENVMS
-
-#include <starlet.h>
-
-#define uuid_generate(x) sys$create_uid(&(x))
+#if defined ZMQ_HAVE_WINDOWS
 
-#define uuid_unparse(x, y) \
-        sprintf (y, "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x", \
-                        x.data0, x.data1, x.data2, \
-                        x.data3 [0], x.data3 [1], \
-                        x.data3 [2], x.data3 [3], \
-                        x.data3 [4], x.data3 [5], \
-                        x.data3 [6], x.data3 [7]);
+static volatile LONG seed_state = 0;
 
-zmq::uuid_t::uuid_t ()
+static void ensure_seeded ()
 {
-    uuid_generate (uuid);
-    uuid_unparse (uuid, string_buf);
+    //  0 means not seeded, 1 seeding in progress and 2 seeded.
+    if (InterlockedCompareExchange (&seed_state, 0, 0) == 2)
+        return;
+    if (InterlockedCompareExchange (&seed_state, 1, 0) == 0) {
+        seed ();
+        InterlockedExchange (&seed_state, 2);
+        return;
+    }
+    while (InterlockedCompareExchange (&seed_state, 0, 0) != 2)
+        Sleep (0);
 }
 
-zmq::uuid_t::~uuid_t ()
+#else
+
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+
+static void seed_first ()
 {
+    seed ();
+
+    //  A forked child would otherwise generate the same UUIDs as its
+    //  parent. The child is single-threaded when the handler runs.
+    int rc = pthread_atfork (NULL, NULL, seed);
+    posix_assert (rc);
 }
 
-const char *zmq::uuid_t::to_string ()
+static inline void ensure_seeded ()
 {
-    return string_buf;
+    int rc = pthread_once (&seed_once, seed_first);
+    posix_assert (rc);
 }
 
-#else
+#endif
 
-#include <stdio.h>
-#include <string.h>
-#include <openssl/rand.h>
+//  Returns a timestamp greater than any returned before.
+static uint64_t next_time ()
+{
+    uint64_t now = gregorian_time ();
+#if defined ZMQ_UUID_MUTEX
+    state.sync.lock ();
+    uint64_t time = now > state.last_time ? now : state.last_time + 1;
+    state.last_time = time;
+    state.sync.unlock ();
+    return time;
+#else
+    //  A torn read of the old value on a 32-bit platform is harmless,
+    //  the 'compare and swap' below fails and returns the actual value.
+    uint64_t old = state.last_time;
+    while (true) {
+        uint64_t time = now > old ? now : old + 1;
+        uint64_t prev;
+#if defined ZMQ_UUID_SYNC
+        prev = __sync_val_compare_and_swap (&state.last_time, old, time);
+#elif defined ZMQ_UUID_WINDOWS
+        prev = (uint64_t) InterlockedCompareExchange64 (
+            (volatile LONGLONG*) &state.last_time, (LONGLONG) time,
+            (LONGLONG) old);
+#elif defined ZMQ_UUID_ATOMIC_H
+        prev = atomic_cas_64 (&state.last_time, old, time);
+#endif
+        if (prev == old)
+            return time;
+        old = prev;
+    }
+#endif
+}
 
 zmq::uuid_t::uuid_t ()
 {
-    unsigned char rand_buf [16];
-    int ret = RAND_bytes (rand_buf, sizeof rand_buf);
-    zmq_assert (ret == 1);
-
-    //  Read in UUID fields.
-    memcpy (&time_low, rand_buf, sizeof time_low);
-    memcpy (&time_mid, rand_buf + 4, sizeof time_mid);
-    memcpy (&time_hi_and_version, rand_buf + 6, sizeof time_hi_and_version);
-    memcpy (&clock_seq_hi_and_reserved, rand_buf + 8,
-        sizeof clock_seq_hi_and_reserved);
-    memcpy (&clock_seq_low, rand_buf + 9, sizeof clock_seq_low);
-    memcpy (&node [0], rand_buf + 10, sizeof node);
-
-    //  Store UUID version number.
-    time_hi_and_version = (time_hi_and_version & 0x0fff) | 4 << 12;
-
-    //  Store UUID type.
-    clock_seq_hi_and_reserved = (clock_seq_hi_and_reserved & 0x3f) | 0x80;
-
-    snprintf (string_buf, sizeof string_buf,
-        "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-        time_low,
-        time_mid,
-        time_hi_and_version,
-        clock_seq_hi_and_reserved,
-        clock_seq_low,
-        node [0], node [1], node [2], node [3], node [4], node [5]);
-
-    create_blob ();
+    ensure_seeded ();
+    uint64_t time = next_time ();
+
+    //  time_low, time_mid and time_hi_and_version, most significant
+    //  byte first.
+    uint32_t time_low = (uint32_t) time;
+    blob_buf [0] = (unsigned char) (time_low >> 24);
+    blob_buf [1] = (unsigned char) (time_low >> 16);
+    blob_buf [2] = (unsigned char) (time_low >> 8);
+    blob_buf [3] = (unsigned char) time_low;
+    blob_buf [4] = (unsigned char) (time >> 40);
+    blob_buf [5] = (unsigned char) (time >> 32);
+    blob_buf [6] = (unsigned char) (((time >> 56) & 0x0f) | 0x10);
+    blob_buf [7] = (unsigned char) (time >> 48);
+
+    memcpy (blob_buf + 8, state.clock_seq_and_node, 8);
+
+    string_buf [0] = 0;
 }
 
 zmq::uuid_t::~uuid_t ()
@@ -174,68 +258,22 @@ zmq::uuid_t::~uuid_t ()
 
 const char *zmq::uuid_t::to_string ()
 {
+    if (!string_buf [0]) {
+        static const char digits [] = "0123456789abcdef";
+        char *pos = string_buf;
+        for (int i = 0; i != uuid_blob_len; i++) {
+            if (i == 4 || i == 6 || i == 8 || i == 10)
+                *pos++ = '-';
+            *pos++ = digits [blob_buf [i] >> 4];
+            *pos++ = digits [blob_buf [i] & 0x0f];
+        }
+        *pos = 0;
+    }
     return string_buf;
 }
 
-#endif
-
 const unsigned char *zmq::uuid_t::to_blob ()
 {
     return blob_buf;
 }
 
-unsigned char zmq::uuid_t::convert_byte (const char *hexa_)
-{
-    unsigned char byte;
-
-    if (*hexa_ >= '0' && *hexa_ <= '9')
-        byte = *hexa_ - '0';
-    else if (*hexa_ >= 'A' && *hexa_ <= 'F')
-        byte = *hexa_ - 'A' + 10;
-    else if (*hexa_ >= 'a' && *hexa_ <= 'f')
-        byte = *hexa_ - 'a' + 10;
-    else {
-        zmq_assert (false);
-        byte = 0;
-    }
-
-    byte *= 16;
-
-    hexa_++;
-    if (*hexa_ >= '0' && *hexa_ <= '9')
-        byte += *hexa_ - '0';
-    else if (*hexa_ >= 'A' && *hexa_ <= 'F')
-        byte += *hexa_ - 'A' + 10;
-    else if (*hexa_ >= 'a' && *hexa_ <= 'f')
-        byte += *hexa_ - 'a' + 10;
-    else
-        zmq_assert (false);  
-
-    return byte;
-}
-
-void zmq::uuid_t::create_blob ()
-{
-    const char *buf = (const char*) string_buf;
-
-    blob_buf [0] = convert_byte (buf + 0);
-    blob_buf [1] = convert_byte (buf + 2);
-    blob_buf [2] = convert_byte (buf + 4);
-    blob_buf [3] = convert_byte (buf + 6);
-
-    blob_buf [4] = convert_byte (buf + 9);
-    blob_buf [5] = convert_byte (buf + 11);
-
-    blob_buf [6] = convert_byte (buf + 14);
-    blob_buf [7] = convert_byte (buf + 16);
-
-    blob_buf [8] = convert_byte (buf + 19);
-    blob_buf [9] = convert_byte (buf + 21);
-
-    blob_buf [10] = convert_byte (buf + 24);
-    blob_buf [11] = convert_byte (buf + 26);
-    blob_buf [12] = convert_byte (buf + 28);
-    blob_buf [13] = convert_byte (buf + 30);
-    blob_buf [14] = convert_byte (buf + 32);
-    blob_buf [15] = convert_byte (buf + 34);
-}
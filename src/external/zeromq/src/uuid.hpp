@@ -21,34 +21,20 @@
 #ifndef __ZMQ_UUID_HPP_INCLUDED__
 #define __ZMQ_UUID_HPP_INCLUDED__
 
-#include "platform.hpp"
 #include "stdint.hpp"
 
-#if defined ZMQ_HAVE_FREEBSD || defined ZMQ_HAVE_NETBSD
-#include <uuid.h>
-#elif defined ZMQ_HAVE_HPUX && defined HAVE_LIBDCEKT
-#include <dce/uuid.h>
-#elif defined ZMQ_HAVE_LINUX || defined ZMQ_HAVE_SOLARIS ||\
-      defined ZMQ_HAVE_OSX || defined ZMQ_HAVE_CYGWIN
-#include <uuid/uuid.h>
-#elif defined ZMQ_HAVE_WINDOWS
-#include "windows.hpp"
-#include <rpc.h>
-#elif defined ZMQ_HAVE_OPENVMS
-typedef struct
-{
-    unsigned long data0;
-    unsigned short data1;
-    unsigned short data2;
-    unsigned char data3 [8];
-} uuid_t;
-#endif
-
 namespace zmq
 {
 
     //  This class provides RFC 4122 (a Universally Unique IDentifier)
     //  implementation.
+    //
+    //  UUIDs are time-based (version 1). The node ID and the initial clock
+    //  sequence are taken from a random UUID generated once per process by
+    //  the system, so that generating a UUID involves neither a system
+    //  call nor a lock. Timestamps are strictly increasing within the
+    //  process; if UUIDs are requested faster than the clock advances,
+    //  the timestamp runs ahead of the clock until the rate drops.
 
     class uuid_t
     {
@@ -61,8 +47,7 @@ namespace zmq
         enum { uuid_string_len = 36 };
 
         //  Returns a pointer to buffer containing the textual
-        //  representation of the UUID. The callee is reponsible to
-        //  free the allocated memory.
+        //  representation of the UUID. The buffer is owned by the object.
         const char *to_string ();
 
         //  The length of binary representation of UUID.
@@ -72,43 +57,10 @@ namespace zmq
 
     private:
 
-        //  Converts one byte from hexa representation to binary.
-        unsigned char convert_byte (const char *hexa_);
-
-        //  Converts string representation of UUID into standardised BLOB.
-        //  The function is endianness agnostic.
-        void create_blob ();
-
-#if defined ZMQ_HAVE_WINDOWS
-#ifdef ZMQ_HAVE_MINGW32
-        typedef unsigned char* RPC_CSTR;
-#endif
-        ::UUID uuid;
-        RPC_CSTR string_buf;
-#elif defined ZMQ_HAVE_FREEBSD || defined ZMQ_HAVE_NETBSD
-        ::uuid_t uuid;
-        char *string_buf;
-#elif defined ZMQ_HAVE_HPUX && defined HAVE_LIBDCEKT
-        ::uuid_t uuid;
-        unsigned_char_t *string_buf;
-#elif defined ZMQ_HAVE_LINUX || defined ZMQ_HAVE_SOLARIS ||\
-      defined ZMQ_HAVE_OSX || defined ZMQ_HAVE_CYGWIN ||\
-      defined ZMQ_HAVE_OPENVMS
-        ::uuid_t uuid;
-        char string_buf [uuid_string_len + 1];
-#else
-        //  RFC 4122 UUID's fields
-        uint32_t time_low;
-        uint16_t time_mid;
-        uint16_t time_hi_and_version;
-        uint8_t clock_seq_hi_and_reserved;
-        uint8_t clock_seq_low;
-        uint8_t node [6];
+        //  UUID in the network byte order, as specified by RFC 4122.
+        unsigned char blob_buf [uuid_blob_len];
 
         char string_buf [uuid_string_len + 1];
-#endif
-
-        unsigned char blob_buf [uuid_blob_len];
     };
 
 }
@@ -26,26 +26,140 @@
 
 zmq::xpub_t::xpub_t (class ctx_t *parent_, uint32_t tid_) :
     socket_base_t (parent_, tid_),
-    dist (this)
+    dist (this),
+    more (false),
+    terminating (false)
 {
     options.type = ZMQ_XPUB;
-    options.requires_in = false;
+    options.requires_in = true;
     options.requires_out = true;
 }
 
 zmq::xpub_t::~xpub_t ()
 {
+    zmq_assert (inpipes.empty ());
 }
 
 void zmq::xpub_t::xattach_pipes (class reader_t *inpipe_,
     class writer_t *outpipe_, const blob_t &peer_identity_)
 {
-    zmq_assert (!inpipe_ && outpipe_);
-    dist.attach (outpipe_);
+    zmq_assert (outpipe_);
+    dist.attach (outpipe_, this);
+
+    //  Until the peer tells us otherwise, it gets all the messages.
+    subscriptions.add (NULL, 0, outpipe_);
+
+    //  Peers that don't send subscriptions upstream have no inbound pipe.
+    if (!inpipe_)
+        return;
+
+    inpipe_t inpipe = {outpipe_, false};
+    inpipes.insert (inpipes_t::value_type (inpipe_, inpipe));
+    inpipe_->set_event_sink (this);
+
+    //  If we are already terminating, ask the pipe to terminate straight away.
+    if (terminating) {
+        register_term_acks (1);
+        inpipe_->terminate ();
+        return;
+    }
+
+    //  The subscriptions may be waiting in the pipe already.
+    read_subscriptions (inpipe_);
+}
+
+void zmq::xpub_t::read_subscriptions (reader_t *pipe_)
+{
+    inpipes_t::iterator it = inpipes.find (pipe_);
+    zmq_assert (it != inpipes.end ());
+
+    zmq_msg_t msg;
+    zmq_msg_init (&msg);
+    while (pipe_->read (&msg)) {
+        size_t size = zmq_msg_size (&msg);
+        unsigned char *data = (unsigned char*) zmq_msg_data (&msg);
+
+        //  Malformed subscriptions are dropped silently, the same as the
+        //  subscriptions of the peers that are already gone.
+        writer_t *outpipe = it->second.outpipe;
+        if (outpipe && size >= 1 && (*data == 0 || *data == 1)) {
+
+            //  The peer is filtering on its own subscriptions now. Stop
+            //  sending it the messages it didn't ask for.
+            if (!it->second.filtered) {
+                subscriptions.rm (NULL, 0, outpipe);
+                it->second.filtered = true;
+            }
+
+            if (*data == 1)
+                subscriptions.add (data + 1, size - 1, outpipe);
+            else
+                subscriptions.rm (data + 1, size - 1, outpipe);
+        }
+
+        int rc = zmq_msg_close (&msg);
+        zmq_assert (rc == 0);
+        rc = zmq_msg_init (&msg);
+        zmq_assert (rc == 0);
+    }
+    zmq_msg_close (&msg);
+}
+
+void zmq::xpub_t::activated (reader_t *pipe_)
+{
+    read_subscriptions (pipe_);
+}
+
+void zmq::xpub_t::terminated (reader_t *pipe_)
+{
+    inpipes.erase (pipe_);
+
+    if (terminating)
+        unregister_term_ack ();
+}
+
+void zmq::xpub_t::delimited (reader_t *pipe_)
+{
+}
+
+void zmq::xpub_t::activated (writer_t *pipe_)
+{
+    dist.activated (pipe_);
+}
+
+void zmq::xpub_t::terminated (writer_t *pipe_)
+{
+    //  Remove the pipe from the trie. If there are subscriptions still
+    //  on the way, they'll be dropped.
+    subscriptions.rm (pipe_);
+    for (inpipes_t::iterator it = inpipes.begin (); it != inpipes.end (); ++it)
+        if (it->second.outpipe == pipe_)
+            it->second.outpipe = NULL;
+
+    dist.terminated (pipe_);
+}
+
+void zmq::xpub_t::hiccuped (writer_t *pipe_)
+{
+    //  The peer was replaced by reconnecting. The subscriptions of the old
+    //  one don't apply any more and the new one sends its own, if any.
+    //  Until then, it gets all the messages, the same as a new peer.
+    subscriptions.rm (pipe_);
+    subscriptions.add (NULL, 0, pipe_);
+    for (inpipes_t::iterator it = inpipes.begin (); it != inpipes.end (); ++it)
+        if (it->second.outpipe == pipe_)
+            it->second.filtered = false;
 }
 
 void zmq::xpub_t::process_term (int linger_)
 {
+    terminating = true;
+
+    //  Terminate the inbound pipes.
+    register_term_acks (inpipes.size ());
+    for (inpipes_t::iterator it = inpipes.begin (); it != inpipes.end (); ++it)
+        it->first->terminate ();
+
     //  Terminate the outbound pipes.
     dist.terminate ();
 
@@ -53,9 +167,34 @@ void zmq::xpub_t::process_term (int linger_)
     socket_base_t::process_term (linger_);
 }
 
+void zmq::xpub_t::mark_as_matching (writer_t *pipe_, void *arg_)
+{
+    xpub_t *self = (xpub_t*) arg_;
+    self->dist.match (pipe_);
+}
+
 int zmq::xpub_t::xsend (zmq_msg_t *msg_, int flags_)
 {
-    return dist.send (msg_, flags_);
+    bool msg_more = flags_ & ZMQ_SNDMORE;
+
+    //  For the first part of multi-part message, find the matching pipes.
+    if (!more)
+        subscriptions.match ((unsigned char*) zmq_msg_data (msg_),
+            zmq_msg_size (msg_), mark_as_matching, this);
+
+    //  Send the message to all the pipes that were marked as matching
+    //  in the previous step.
+    int rc = dist.send_to_matching (msg_, flags_);
+    if (rc != 0)
+        return rc;
+
+    //  If we are at the end of multi-part message we can mark all the pipes
+    //  as non-matching.
+    if (!msg_more)
+        dist.unmatch ();
+
+    more = msg_more;
+    return 0;
 }
 
 bool zmq::xpub_t::xhas_out ()
@@ -73,4 +212,3 @@ bool zmq::xpub_t::xhas_in ()
 {
     return false;
 }
-
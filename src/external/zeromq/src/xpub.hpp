@@ -21,15 +21,21 @@
 #ifndef __ZMQ_XPUB_HPP_INCLUDED__
 #define __ZMQ_XPUB_HPP_INCLUDED__
 
+#include <map>
+
 #include "socket_base.hpp"
 #include "array.hpp"
 #include "pipe.hpp"
 #include "dist.hpp"
+#include "mtrie.hpp"
 
 namespace zmq
 {
 
-    class xpub_t : public socket_base_t
+    class xpub_t :
+        public socket_base_t,
+        public i_reader_events,
+        public i_writer_events
     {
     public:
 
@@ -44,14 +50,53 @@ namespace zmq
         int xrecv (zmq_msg_t *msg_, int flags_);
         bool xhas_in ();
 
+        //  i_reader_events interface implementation.
+        void activated (class reader_t *pipe_);
+        void terminated (class reader_t *pipe_);
+        void delimited (class reader_t *pipe_);
+
+        //  i_writer_events interface implementation.
+        void activated (class writer_t *pipe_);
+        void terminated (class writer_t *pipe_);
+        void hiccuped (class writer_t *pipe_);
+
     private:
 
         //  Hook into the termination process.
         void process_term (int linger_);
 
+        //  Reads all the subscriptions available in the inbound pipe and
+        //  updates the filter of the corresponding outbound pipe.
+        void read_subscriptions (class reader_t *pipe_);
+
+        //  Function to be applied to each matching pipe.
+        static void mark_as_matching (class writer_t *pipe_, void *arg_);
+
+        //  List of all subscriptions mapped to corresponding pipes.
+        mtrie_t subscriptions;
+
         //  Distributor of messages holding the list of outbound pipes.
         dist_t dist;
 
+        //  Inbound pipes the peers send their subscriptions through.
+        //  Each one is mapped to the outbound pipe to the same peer, or to
+        //  NULL once that one was terminated. Until the first subscription
+        //  arrives, the peer gets all the messages; the peers that don't
+        //  send the subscriptions upstream never send any.
+        struct inpipe_t
+        {
+            class writer_t *outpipe;
+            bool filtered;
+        };
+        typedef std::map <class reader_t*, inpipe_t> inpipes_t;
+        inpipes_t inpipes;
+
+        //  True if we are in the middle of sending a multi-part message.
+        bool more;
+
+        //  True if termination was already initiated.
+        bool terminating;
+
         xpub_t (const xpub_t&);
         const xpub_t &operator = (const xpub_t&);
     };
@@ -23,10 +23,12 @@
 #include "xrep.hpp"
 #include "err.hpp"
 #include "pipe.hpp"
+#include "config.hpp"
 
 zmq::xrep_t::xrep_t (class ctx_t *parent_, uint32_t tid_) :
     socket_base_t (parent_, tid_),
     current_in (0),
+    credited_in (NULL),
     prefetched (false),
     more_in (false),
     current_out (NULL),
@@ -57,10 +59,13 @@ void zmq::xrep_t::xattach_pipes (reader_t *inpipe_, writer_t *outpipe_,
 
         //  TODO: What if new connection has same peer identity as the old one?
         outpipe_t outpipe = {outpipe_, true};
-        bool ok = outpipes.insert (outpipes_t::value_type (
-            peer_identity_, outpipe)).second;
+        bool ok = outpipes.insert (peer_identity_, outpipe);
         zmq_assert (ok);
 
+        //  The writer's array index is free to hold its position in
+        //  outpipes, which makes finding it on pipe events O(1).
+        outpipe_->set_array_index ((int) outpipes.size () - 1);
+
         if (terminating) {
             register_term_acks (1);
             outpipe_->terminate ();
@@ -90,9 +95,8 @@ void zmq::xrep_t::process_term (int linger_)
     for (inpipes_t::iterator it = inpipes.begin (); it != inpipes.end ();
           ++it)
         it->reader->terminate ();
-    for (outpipes_t::iterator it = outpipes.begin (); it != outpipes.end ();
-          ++it)
-        it->second.writer->terminate ();
+    for (outpipes_t::size_type i = 0; i != outpipes.size (); i++)
+        outpipes.value (i).writer->terminate ();
 
     socket_base_t::process_term (linger_);
 }
@@ -102,7 +106,10 @@ void zmq::xrep_t::terminated (reader_t *pipe_)
     for (inpipes_t::iterator it = inpipes.begin (); it != inpipes.end ();
           ++it) {
         if (it->reader == pipe_) {
-            if ((inpipes_t::size_type) (it - inpipes.begin ()) < current_in)
+            inpipes_t::size_type index = it - inpipes.begin ();
+            if (pipe_ == credited_in)
+                credited_in = NULL;
+            if (index < current_in)
                 current_in--;
             inpipes.erase (it);
             if (current_in >= inpipes.size ())
@@ -117,18 +124,15 @@ void zmq::xrep_t::terminated (reader_t *pipe_)
 
 void zmq::xrep_t::terminated (writer_t *pipe_)
 {
-    for (outpipes_t::iterator it = outpipes.begin ();
-          it != outpipes.end (); ++it) {
-        if (it->second.writer == pipe_) {
-            outpipes.erase (it);
-            if (pipe_ == current_out)
-                current_out = NULL;
-            if (terminating)
-                unregister_term_ack ();
-            return;
-        }
-    }
-    zmq_assert (false);
+    outpipes_t::size_type i = (outpipes_t::size_type) pipe_->get_array_index ();
+    zmq_assert (i < outpipes.size () && outpipes.value (i).writer == pipe_);
+    outpipes.erase (i);
+    if (i < outpipes.size ())
+        outpipes.value (i).writer->set_array_index ((int) i);
+    if (pipe_ == current_out)
+        current_out = NULL;
+    if (terminating)
+        unregister_term_ack ();
 }
 
 void zmq::xrep_t::delimited (reader_t *pipe_)
@@ -150,15 +154,10 @@ void zmq::xrep_t::activated (reader_t *pipe_)
 
 void zmq::xrep_t::activated (writer_t *pipe_)
 {
-    for (outpipes_t::iterator it = outpipes.begin ();
-          it != outpipes.end (); ++it) {
-        if (it->second.writer == pipe_) {
-            zmq_assert (!it->second.active);
-            it->second.active = true;
-            return;
-        }
-    }
-    zmq_assert (false);
+    outpipes_t::size_type i = (outpipes_t::size_type) pipe_->get_array_index ();
+    zmq_assert (i < outpipes.size () && outpipes.value (i).writer == pipe_);
+    zmq_assert (!outpipes.value (i).active);
+    outpipes.value (i).active = true;
 }
 
 int zmq::xrep_t::xsend (zmq_msg_t *msg_, int flags_)
@@ -176,17 +175,16 @@ int zmq::xrep_t::xsend (zmq_msg_t *msg_, int flags_)
 
             //  Find the pipe associated with the identity stored in the prefix.
             //  If there's no such pipe just silently ignore the message.
-            blob_t identity ((unsigned char*) zmq_msg_data (msg_),
-                zmq_msg_size (msg_));
-            outpipes_t::iterator it = outpipes.find (identity);
+            outpipe_t *outpipe = outpipes.find (
+                (unsigned char*) zmq_msg_data (msg_), zmq_msg_size (msg_));
 
-            if (it != outpipes.end ()) {
-                current_out = it->second.writer;
+            if (outpipe) {
+                current_out = outpipe->writer;
                 zmq_msg_t empty;
                 int rc = zmq_msg_init (&empty);
                 zmq_assert (rc == 0);
                 if (!current_out->check_write (&empty)) {
-                    it->second.active = false;
+                    outpipe->active = false;
                     more_out = false;
                     current_out = NULL;
                 }
@@ -232,6 +230,7 @@ int zmq::xrep_t::xrecv (zmq_msg_t *msg_, int flags_)
         zmq_msg_move (msg_, &prefetched_msg);
         more_in = msg_->flags & ZMQ_MSG_MORE;
         prefetched = false;
+        account_in (msg_);
         return 0;
     }
 
@@ -244,20 +243,33 @@ int zmq::xrep_t::xrecv (zmq_msg_t *msg_, int flags_)
         bool fetched = inpipes [current_in].reader->read (msg_);
         zmq_assert (fetched);
         more_in = msg_->flags & ZMQ_MSG_MORE;
-        if (!more_in) {
-            current_in++;
-            if (current_in >= inpipes.size ())
-                current_in = 0;
-        }
+        account_in (msg_);
         return 0;
     }
 
     //  Round-robin over the pipes to get the next message.
-    for (int count = inpipes.size (); count != 0; count--) {
+    int count = inpipes.size ();
+    while (count != 0) {
+
+        //  Start the turn of the current pipe. A pipe that is still in debt
+        //  from its previous turns passes the turn without reading; it may
+        //  hold messages, so the other pipes are all looked at again.
+        reader_t *reader = inpipes [current_in].reader;
+        if (inpipes [current_in].active && reader != credited_in) {
+            credited_in = reader;
+            if (!reader->start_turn (fq_quantum)) {
+                credited_in = NULL;
+                current_in++;
+                if (current_in >= inpipes.size ())
+                    current_in = 0;
+                count = inpipes.size ();
+                continue;
+            }
+        }
 
         //  Try to fetch new message.
         if (inpipes [current_in].active)
-            prefetched = inpipes [current_in].reader->read (&prefetched_msg);
+            prefetched = reader->read (&prefetched_msg);
 
         //  If we have a message, create a prefix and return it to the caller.
         if (prefetched) {
@@ -272,10 +284,15 @@ int zmq::xrep_t::xrecv (zmq_msg_t *msg_, int flags_)
 
         //  If me don't have a message, mark the pipe as passive and
         //  move to next pipe.
+        if (inpipes [current_in].active)
+            reader->end_turn ();
         inpipes [current_in].active = false;
+        if (reader == credited_in)
+            credited_in = NULL;
         current_in++;
         if (current_in >= inpipes.size ())
             current_in = 0;
+        count--;
     }
 
     //  No message is available. Initialise the output parameter
@@ -312,7 +329,11 @@ bool zmq::xrep_t::xhas_in ()
 
         //  If me don't have a message, mark the pipe as passive and
         //  move to next pipe.
+        if (inpipes [current_in].active)
+            inpipes [current_in].reader->end_turn ();
         inpipes [current_in].active = false;
+        if (inpipes [current_in].reader == credited_in)
+            credited_in = NULL;
         current_in++;
         if (current_in >= inpipes.size ())
             current_in = 0;
@@ -321,6 +342,21 @@ bool zmq::xrep_t::xhas_in ()
     return false;
 }
 
+void zmq::xrep_t::account_in (zmq_msg_t *msg_)
+{
+    //  Pass the turn once the current pipe has used up its credit, but
+    //  never in the middle of a multipart message. The pipe may have been
+    //  terminated since the message was prefetched.
+    if (!credited_in || credited_in->charge (zmq_msg_size (msg_)) ||
+          more_in)
+        return;
+
+    credited_in = NULL;
+    current_in++;
+    if (current_in >= inpipes.size ())
+        current_in = 0;
+}
+
 bool zmq::xrep_t::xhas_out ()
 {
     //  In theory, XREP socket is always ready for writing. Whether actual
@@ -21,11 +21,11 @@
 #ifndef __ZMQ_XREP_HPP_INCLUDED__
 #define __ZMQ_XREP_HPP_INCLUDED__
 
-#include <map>
 #include <vector>
 
 #include "socket_base.hpp"
 #include "blob.hpp"
+#include "blob_map.hpp"
 #include "pipe.hpp"
 
 namespace zmq
@@ -65,6 +65,11 @@ namespace zmq
         void activated (writer_t *pipe_);
         void terminated (writer_t *pipe_);
 
+        //  Accounts for a message part read from the current inbound pipe.
+        //  Once the message is complete and the pipe has used up its
+        //  quantum, moves on to the next pipe.
+        void account_in (zmq_msg_t *msg_);
+
         struct inpipe_t
         {
             class reader_t *reader;
@@ -79,6 +84,10 @@ namespace zmq
         //  The pipe we are currently reading from.
         inpipes_t::size_type current_in;
 
+        //  The inbound pipe whose turn is in progress, if any. Pipes are
+        //  served in deficit round robin, like in fq_t.
+        reader_t *credited_in;
+
         //  Have we prefetched a message.
         bool prefetched;
 
@@ -95,7 +104,7 @@ namespace zmq
         };
 
         //  Outbound pipes indexed by the peer names.
-        typedef std::map <blob_t, outpipe_t> outpipes_t;
+        typedef blob_map_t <outpipe_t> outpipes_t;
         outpipes_t outpipes;
 
         //  The pipe we are currently writing to.
@@ -26,7 +26,7 @@
 zmq::xreq_t::xreq_t (class ctx_t *parent_, uint32_t tid_) :
     socket_base_t (parent_, tid_),
     fq (this),
-    lb (this)
+    lb (this, options)
 {
     options.type = ZMQ_XREQ;
     options.requires_in = true;
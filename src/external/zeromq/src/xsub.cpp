@@ -28,12 +28,14 @@
 zmq::xsub_t::xsub_t (class ctx_t *parent_, uint32_t tid_) :
     socket_base_t (parent_, tid_),
     fq (this),
+    dist (this),
     has_message (false),
     more (false)
 {
     options.type = ZMQ_XSUB;
     options.requires_in = true;
-    options.requires_out = false;
+    options.requires_out = true;
+    options.lossless_out = true;
     zmq_msg_init (&message);
 }
 
@@ -45,13 +47,37 @@ zmq::xsub_t::~xsub_t ()
 void zmq::xsub_t::xattach_pipes (class reader_t *inpipe_,
     class writer_t *outpipe_, const blob_t &peer_identity_)
 {
-    zmq_assert (inpipe_ && !outpipe_);
+    zmq_assert (inpipe_ && outpipe_);
     fq.attach (inpipe_);
+    dist.attach (outpipe_, this);
+
+    //  Send all the cached subscriptions to the new upstream peer, so that
+    //  it can filter the messages before sending them.
+    subscriptions.apply (send_subscription, outpipe_);
+    outpipe_->flush ();
+}
+
+void zmq::xsub_t::activated (writer_t *pipe_)
+{
+    dist.activated (pipe_);
+}
+
+void zmq::xsub_t::terminated (writer_t *pipe_)
+{
+    dist.terminated (pipe_);
+}
+
+void zmq::xsub_t::hiccuped (writer_t *pipe_)
+{
+    //  The upstream peer was replaced. Send it all the subscriptions.
+    subscriptions.apply (send_subscription, pipe_);
+    pipe_->flush ();
 }
 
 void zmq::xsub_t::process_term (int linger_)
 {
     fq.terminate ();
+    dist.terminate ();
     socket_base_t::process_term (linger_);
 }
 
@@ -60,16 +86,22 @@ int zmq::xsub_t::xsend (zmq_msg_t *msg_, int options_)
     size_t size = zmq_msg_size (msg_);
     unsigned char *data = (unsigned char*) zmq_msg_data (msg_);
 
-    //  Malformed subscriptions are dropped silently.
+    //  Malformed subscriptions are dropped silently. Only the first
+    //  subscription to a topic and the removal of the last one are passed
+    //  upstream, as the publisher doesn't count the duplicates.
     if (size >= 1) {
 
         //  Process a subscription.
-        if (*data == 1)
-            subscriptions.add (data + 1, size - 1);
+        if (*data == 1) {
+            if (subscriptions.add (data + 1, size - 1))
+                return dist.send (msg_, 0);
+        }
 
         //  Process an unsubscription. Invalid unsubscription is ignored.
-        if (*data == 0)
-            subscriptions.rm (data + 1, size - 1);
+        if (*data == 0) {
+            if (subscriptions.rm (data + 1, size - 1))
+                return dist.send (msg_, 0);
+        }
     }
 
     int rc = zmq_msg_close (msg_);
@@ -165,6 +197,27 @@ bool zmq::xsub_t::xhas_in ()
     }
 }
 
+void zmq::xsub_t::send_subscription (unsigned char *data_, size_t size_,
+    void *arg_)
+{
+    writer_t *pipe = (writer_t*) arg_;
+
+    //  Create the subscription message.
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, size_ + 1);
+    zmq_assert (rc == 0);
+    unsigned char *data = (unsigned char*) zmq_msg_data (&msg);
+    data [0] = 1;
+    memcpy (data + 1, data_, size_);
+
+    //  Send it to the pipe. There's no high watermark on the pipe, so it can
+    //  only fail if the pipe is being terminated.
+    if (!pipe->write (&msg)) {
+        rc = zmq_msg_close (&msg);
+        zmq_assert (rc == 0);
+    }
+}
+
 bool zmq::xsub_t::match (zmq_msg_t *msg_)
 {
     return subscriptions.check ((unsigned char*) zmq_msg_data (msg_),
@@ -26,11 +26,15 @@
 #include "trie.hpp"
 #include "socket_base.hpp"
 #include "fq.hpp"
+#include "dist.hpp"
+#include "pipe.hpp"
 
 namespace zmq
 {
 
-    class xsub_t : public socket_base_t
+    class xsub_t :
+        public socket_base_t,
+        public i_writer_events
     {
     public:
 
@@ -47,6 +51,13 @@ namespace zmq
         int xrecv (zmq_msg_t *msg_, int flags_);
         bool xhas_in ();
 
+    public:
+
+        //  i_writer_events interface implementation.
+        void activated (class writer_t *pipe_);
+        void terminated (class writer_t *pipe_);
+        void hiccuped (class writer_t *pipe_);
+
     private:
 
         //  Hook into the termination process.
@@ -55,9 +66,17 @@ namespace zmq
         //  Check whether the message matches at least one subscription.
         bool match (zmq_msg_t *msg_);
 
+        //  Function to be applied to the trie to send all the subscriptions
+        //  upstream.
+        static void send_subscription (unsigned char *data_, size_t size_,
+            void *arg_);
+
         //  Fair queueing object for inbound pipes.
         fq_t fq;
 
+        //  Object for distributing the subscriptions upstream.
+        dist_t dist;
+
         //  The repository of subscriptions.
         trie_t subscriptions;
 
@@ -43,6 +43,7 @@
 #include "device.hpp"
 #include "socket_base.hpp"
 #include "msg_content.hpp"
+#include "msg_pool.hpp"
 #include "stdint.hpp"
 #include "config.hpp"
 #include "likely.hpp"
@@ -94,8 +95,8 @@ int zmq_msg_init_size (zmq_msg_t *msg_, size_t size_)
         msg_->vsm_size = (uint8_t) size_;
     }
     else {
-        msg_->content =
-            (zmq::msg_content_t*) malloc (sizeof (zmq::msg_content_t) + size_);
+        msg_->content = (zmq::msg_content_t*) zmq::msg_alloc (
+            sizeof (zmq::msg_content_t) + size_);
         if (!msg_->content) {
             errno = ENOMEM;
             return -1;
@@ -115,7 +116,8 @@ int zmq_msg_init_size (zmq_msg_t *msg_, size_t size_)
 int zmq_msg_init_data (zmq_msg_t *msg_, void *data_, size_t size_,
     zmq_free_fn *ffn_, void *hint_)
 {
-    msg_->content = (zmq::msg_content_t*) malloc (sizeof (zmq::msg_content_t));
+    msg_->content = (zmq::msg_content_t*) zmq::msg_alloc (
+        sizeof (zmq::msg_content_t));
     alloc_assert (msg_->content);
     msg_->flags = (unsigned char) ~ZMQ_MSG_MASK;
     zmq::msg_content_t *content = (zmq::msg_content_t*) msg_->content;
@@ -148,9 +150,13 @@ int zmq_msg_close (zmq_msg_t *msg_)
             //  counter so we call its destructor now.
             content->refcnt.~atomic_counter_t ();
 
+            //  Data allocated along with the content are part of the block.
+            size_t size = sizeof (zmq::msg_content_t);
+            if (content->data == (void*) (content + 1))
+                size += content->size;
             if (content->ffn)
                 content->ffn (content->data, content->hint);
-            free (content);
+            zmq::msg_free (content, size);
         }
     }
 
@@ -778,6 +784,31 @@ int zmq_device (int device_, void *insocket_, void *outsocket_)
         (zmq::socket_base_t*) outsocket_);
 }
 
+int zmq_device_sharded (int device_, void **insockets_, void **outsockets_,
+    int count_)
+{
+    if (!insockets_ || !outsockets_) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    for (int i = 0; i < count_; i++) {
+        if (!insockets_ [i] || !outsockets_ [i]) {
+            errno = EFAULT;
+            return -1;
+        }
+    }
+
+    if ((device_ != ZMQ_FORWARDER && device_ != ZMQ_QUEUE &&
+          device_ != ZMQ_STREAMER) || count_ <= 0) {
+       errno = EINVAL;
+       return -1;
+    }
+
+    return zmq::device ((zmq::socket_base_t**) insockets_,
+        (zmq::socket_base_t**) outsockets_, count_);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //  0MQ utils - to be used by perf tests
 ////////////////////////////////////////////////////////////////////////////////
@@ -25,6 +25,7 @@
 
 #include <string.h>
 #include <new>
+#include <algorithm>
 
 #include "zmq_engine.hpp"
 #include "zmq_connecter.hpp"
@@ -37,13 +38,19 @@ zmq::zmq_engine_t::zmq_engine_t (fd_t fd_, const options_t &options_) :
     inpos (NULL),
     insize (0),
     decoder (in_batch_size),
-    outpos (NULL),
+    outpos (0),
+    outcnt (0),
     outsize (0),
     encoder (out_batch_size),
+    outbatch (out_batch_size),
     inout (NULL),
     ephemeral_inout (NULL),
     options (options_),
     plugged (false)
+#if defined ZMQ_FORCE_IO_URING
+    , inresult (poller_t::request_none),
+    outresult (poller_t::request_none)
+#endif
 {
     //  Initialise the underlying socket.
     int rc = tcp_socket.open (fd_, options.sndbuf, options.rcvbuf);
@@ -71,7 +78,9 @@ void zmq::zmq_engine_t::plug (io_thread_t *io_thread_, i_inout *inout_)
     //  Connect to I/O threads poller object.
     io_object_t::plug (io_thread_);
     handle = add_fd (tcp_socket.get_fd ());
+#if !defined ZMQ_FORCE_IO_URING
     set_pollin (handle);
+#endif
     set_pollout (handle);
 
     //  Flush all the data that may have been already received downstream.
@@ -109,9 +118,20 @@ void zmq::zmq_engine_t::in_event ()
     //  If there's no data to process in the buffer...
     if (!insize) {
 
+#if defined ZMQ_FORCE_IO_URING
+        //  Reads are completion-based. If no read has completed, still run
+        //  the decoder on the empty buffer so that it can push out the
+        //  message it may be holding back, same as when read would block.
+        if (inresult != poller_t::request_none &&
+              inresult != poller_t::request_pending) {
+            insize = tcp_socket_t::read_result (inresult);
+            inresult = poller_t::request_none;
+        }
+#else
         //  Retrieve the buffer and read as much data as possible.
         decoder.get_buffer (&inpos, &insize);
         insize = tcp_socket.read (inpos, insize);
+#endif
 
         //  Check whether the peer has closed the connection.
         if (insize == (size_t) -1) {
@@ -134,13 +154,22 @@ void zmq::zmq_engine_t::in_event ()
             //  This may happen if queue limits are in effect or when
             //  init object reads all required information from the socket
             //  and rejects to read more data.
+#if !defined ZMQ_FORCE_IO_URING
             if (plugged)
                 reset_pollin (handle);
+#endif
         }
 
         //  Adjust the buffer.
         inpos += processed;
         insize -= processed;
+
+#if defined ZMQ_FORCE_IO_URING
+        //  Keep reading unless we got stuck; in_event is called again
+        //  once the read completes.
+        if (!insize && plugged && inresult == poller_t::request_none)
+            start_read ();
+#endif
     }
 
     //  Flush all messages the decoder may have produced.
@@ -158,11 +187,35 @@ void zmq::zmq_engine_t::in_event ()
 
 void zmq::zmq_engine_t::out_event ()
 {
-    //  If write buffer is empty, try to read new data from the encoder.
+#if defined ZMQ_FORCE_IO_URING
+    //  Writes are completion-based; POLLOUT only starts them off once the
+    //  engine is plugged.
+    reset_pollout (handle);
+
+    //  Wait for the write in progress.
+    if (outresult == poller_t::request_pending)
+        return;
+
+    //  Account for the completed write.
+    if (outresult != poller_t::request_none) {
+        size_t nbytes = tcp_socket_t::write_result (outresult);
+        outresult = poller_t::request_none;
+        if (nbytes == (size_t) -1) {
+            error ();
+            return;
+        }
+        skip_written (nbytes);
+    }
+#endif
+
+    //  If the batch was written, release the messages it referenced
+    //  and try to read new data from the encoder.
     if (!outsize) {
 
-        outpos = NULL;
-        encoder.get_data (&outpos, &outsize);
+        encoder.release ();
+        outpos = 0;
+        outcnt = out_batch_iov;
+        encoder.get_iovec (outiov, &outcnt, &outsize, outbatch);
 
         //  If IO handler has unplugged engine, flush transient IO handler.
         if (unlikely (!plugged)) {
@@ -178,23 +231,55 @@ void zmq::zmq_engine_t::out_event ()
         }
     }
 
-    //  If there are any data to write in write buffer, write as much as
+#if defined ZMQ_FORCE_IO_URING
+    //  Write as much of the batch as possible; out_event is called again
+    //  once the write completes.
+    async_writev (handle, outiov + outpos, outcnt - outpos, &outresult);
+#else
+    //  If there are any data to write in the batch, write as much as
     //  possible to the socket.
-    int nbytes = tcp_socket.write (outpos, outsize);
+    size_t nbytes = tcp_socket.writev (outiov + outpos, outcnt - outpos);
 
     //  Handle problems with the connection.
-    if (nbytes == -1) {
+    if (nbytes == (size_t) -1) {
         error ();
         return;
     }
 
-    outpos += nbytes;
-    outsize -= nbytes;
+    skip_written (nbytes);
+#endif
+}
+
+void zmq::zmq_engine_t::skip_written (size_t nbytes_)
+{
+    //  Grow the batch size while the socket accepts whole batches,
+    //  otherwise limit it to what the socket accepted.
+    if (nbytes_ == outsize)
+        outbatch = std::min (outbatch * 2, (size_t) out_batch_size_max);
+    else
+        outbatch = std::max (nbytes_, (size_t) out_batch_size);
+
+    //  Skip the chunks that were written.
+    outsize -= nbytes_;
+    while (nbytes_) {
+        iovec &iov = outiov [outpos];
+        if (nbytes_ >= iov.iov_len) {
+            nbytes_ -= iov.iov_len;
+            outpos++;
+        }
+        else {
+            iov.iov_base = (unsigned char*) iov.iov_base + nbytes_;
+            iov.iov_len -= nbytes_;
+            nbytes_ = 0;
+        }
+    }
 }
 
 void zmq::zmq_engine_t::activate_out ()
 {
+#if !defined ZMQ_FORCE_IO_URING
     set_pollout (handle);
+#endif
 
     //  Speculative write: The assumption is that at the moment new message
     //  was sent by the user the socket is probably available for writing.
@@ -205,12 +290,26 @@ void zmq::zmq_engine_t::activate_out ()
 
 void zmq::zmq_engine_t::activate_in ()
 {
+#if !defined ZMQ_FORCE_IO_URING
     set_pollin (handle);
+#endif
 
     //  Speculative read.
     in_event ();
 }
 
+#if defined ZMQ_FORCE_IO_URING
+
+void zmq::zmq_engine_t::start_read ()
+{
+    //  Retrieve the buffer and read as much data as possible.
+    decoder.get_buffer (&inpos, &insize);
+    async_recv (handle, inpos, insize, &inresult);
+    insize = 0;
+}
+
+#endif
+
 void zmq::zmq_engine_t::error ()
 {
     zmq_assert (inout);
@@ -31,6 +31,7 @@
 #include "encoder.hpp"
 #include "decoder.hpp"
 #include "options.hpp"
+#include "config.hpp"
 
 namespace zmq
 {
@@ -58,6 +59,14 @@ namespace zmq
         //  Function to handle network disconnections.
         void error ();
 
+        //  Skip the part of the batch that was written.
+        void skip_written (size_t nbytes_);
+
+#if defined ZMQ_FORCE_IO_URING
+        //  Start reading into the decoder's buffer.
+        void start_read ();
+#endif
+
         tcp_socket_t tcp_socket;
         handle_t handle;
 
@@ -65,10 +74,17 @@ namespace zmq
         size_t insize;
         decoder_t decoder;
 
-        unsigned char *outpos;
+        //  Chunks of the batch being written, starting at outiov [outpos].
+        iovec outiov [out_batch_iov];
+        int outpos;
+        int outcnt;
         size_t outsize;
         encoder_t encoder;
 
+        //  Current limit of the batch size, adapted to the amount of data
+        //  the socket accepts.
+        size_t outbatch;
+
         i_inout *inout;
 
         //  Detached transient inout handler.
@@ -78,6 +94,13 @@ namespace zmq
 
         bool plugged;
 
+#if defined ZMQ_FORCE_IO_URING
+        //  Results of the read and the write requests, poller_t::request_none
+        //  if there is none.
+        int inresult;
+        int outresult;
+#endif
+
         zmq_engine_t (const zmq_engine_t&);
         const zmq_engine_t &operator = (const zmq_engine_t&);
     };
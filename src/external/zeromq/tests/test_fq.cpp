@@ -0,0 +1,107 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+#include "../src/stdint.hpp"
+
+using namespace std;
+using namespace zmqtestutil;
+
+//  Large messages of the first peer and small messages of the second one.
+const size_t large_size = 65536;
+const size_t small_size = 100;
+const int large_count = 200;
+const int small_count = 50000;
+
+//  Bytes to receive while both peers still have messages queued.
+const uint64_t window = 4000000;
+
+//  Queues large messages from a peer of weight weight1_ and small messages
+//  from a peer of weight weight2_, then returns the ratio of the bytes
+//  received from the first peer to those received from the second one.
+double received_ratio (int type_, int peer_type_, int weight1_, int weight2_)
+{
+    zmq::context_t context (1);
+    zmq::socket_t s (context, type_);
+    zmq::socket_t peer1 (context, peer_type_);
+    zmq::socket_t peer2 (context, peer_type_);
+
+    peer1.bind ("inproc://peer1");
+    peer2.bind ("inproc://peer2");
+
+    //  The weight applies to the connections created afterwards.
+    s.setsockopt (ZMQ_RCVWEIGHT, &weight1_, sizeof (int));
+    s.connect ("inproc://peer1");
+    s.setsockopt (ZMQ_RCVWEIGHT, &weight2_, sizeof (int));
+    s.connect ("inproc://peer2");
+
+    for (int i = 0; i != large_count; i++) {
+        zmq::message_t msg (large_size);
+        memset (msg.data (), 0, large_size);
+        peer1.send (msg, 0);
+    }
+    for (int i = 0; i != small_count; i++) {
+        zmq::message_t msg (small_size);
+        memset (msg.data (), 0, small_size);
+        peer2.send (msg, 0);
+    }
+
+    //  XREP prefixes each message with the identity of the peer.
+    uint64_t bytes1 = 0;
+    uint64_t bytes2 = 0;
+    while (bytes1 + bytes2 < window) {
+        zmq::message_t msg;
+        s.recv (&msg, 0);
+        if (type_ == ZMQ_XREP)
+            s.recv (&msg, 0);
+        if (msg.size () == large_size)
+            bytes1 += msg.size ();
+        else {
+            assert (msg.size () == small_size);
+            bytes2 += msg.size ();
+        }
+    }
+    assert (bytes1 < large_size * large_count);
+    assert (bytes2 < small_size * small_count);
+
+    return (double) bytes1 / bytes2;
+}
+
+int main (int argc, char *argv [])
+{
+    int types [][2] = {{ZMQ_PULL, ZMQ_PUSH}, {ZMQ_XREP, ZMQ_XREQ}};
+
+    for (int i = 0; i != 2; i++) {
+
+        //  Peers of equal weight get the same bandwidth whatever the size
+        //  of their messages.
+        double ratio = received_ratio (types [i][0], types [i][1], 1, 1);
+        assert (ratio > 0.8 && ratio < 1.25);
+
+        //  The bandwidth follows the weights.
+        ratio = received_ratio (types [i][0], types [i][1], 3, 1);
+        assert (ratio > 2.5 && ratio < 3.6);
+
+        ratio = received_ratio (types [i][0], types [i][1], 1, 4);
+        assert (ratio > 0.2 && ratio < 0.3);
+    }
+
+    return 0;
+}
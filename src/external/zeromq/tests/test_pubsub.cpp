@@ -0,0 +1,340 @@
+/*
+    Copyright (c) 2007-2011 iMatix Corporation
+    Copyright (c) 2007-2011 Other contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//  The subscriptions are filtered on the PUB side, which the SUB sockets
+//  can't tell apart from their own filtering. So the peers of the PUB
+//  socket are plain TCP sockets speaking the wire protocol, which see
+//  exactly the messages that were sent to them.
+
+#include "../include/zmq.h"
+#include "../src/stdint.hpp"
+#include <assert.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+//  Gives the I/O threads the time to pass the subscriptions and to notice
+//  a dropped connection.
+static void settle ()
+{
+    usleep (300000);
+}
+
+static void raw_write (int fd_, const void *data_, size_t size_)
+{
+    const char *data = (const char*) data_;
+    while (size_) {
+        ssize_t nbytes = send (fd_, data, size_, 0);
+        assert (nbytes > 0);
+        data += nbytes;
+        size_ -= nbytes;
+    }
+}
+
+static void raw_read (int fd_, void *data_, size_t size_)
+{
+    char *data = (char*) data_;
+    while (size_) {
+        ssize_t nbytes = recv (fd_, data, size_, 0);
+        assert (nbytes > 0);
+        data += nbytes;
+        size_ -= nbytes;
+    }
+}
+
+//  Sends a single-part message. Short messages only.
+static void raw_send (int fd_, const std::string &data_)
+{
+    assert (data_.size () < 254);
+    unsigned char header [2] = {(unsigned char) (data_.size () + 1), 0};
+    raw_write (fd_, header, sizeof header);
+    raw_write (fd_, data_.data (), data_.size ());
+}
+
+//  Receives a single-part message. Short messages only.
+static std::string raw_recv (int fd_)
+{
+    unsigned char header [2];
+    raw_read (fd_, header, sizeof header);
+    assert (header [0] >= 1 && header [0] < 255);
+
+    //  Only the 'more' bit of the flags is meaningful on the wire.
+    assert ((header [1] & ZMQ_MSG_MORE) == 0);
+    std::string data (header [0] - 1, 0);
+    if (!data.empty ())
+        raw_read (fd_, &data [0], data.size ());
+    return data;
+}
+
+static void raw_subscribe (int fd_, const std::string &topic_)
+{
+    raw_send (fd_, std::string (1, 1) + topic_);
+}
+
+static void raw_unsubscribe (int fd_, const std::string &topic_)
+{
+    raw_send (fd_, std::string (1, 0) + topic_);
+}
+
+static sockaddr_in raw_address (int port_)
+{
+    sockaddr_in address;
+    memset (&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons (port_);
+    address.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    return address;
+}
+
+//  Exchanges the (anonymous) identities, as 0MQ does on each connection.
+static void raw_greet (int fd_)
+{
+    raw_send (fd_, "");
+    raw_recv (fd_);
+}
+
+static int raw_connect (int port_)
+{
+    int fd = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert (fd != -1);
+    sockaddr_in address = raw_address (port_);
+    int rc = connect (fd, (sockaddr*) &address, sizeof address);
+    assert (rc == 0);
+    raw_greet (fd);
+    return fd;
+}
+
+static int raw_listen (int port_)
+{
+    int fd = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    assert (fd != -1);
+    int flag = 1;
+    int rc = setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof flag);
+    assert (rc == 0);
+    sockaddr_in address = raw_address (port_);
+    rc = bind (fd, (sockaddr*) &address, sizeof address);
+    assert (rc == 0);
+    rc = listen (fd, 1);
+    assert (rc == 0);
+    return fd;
+}
+
+static int raw_accept (int listener_)
+{
+    int fd = accept (listener_, NULL, NULL);
+    assert (fd != -1);
+    raw_greet (fd);
+    return fd;
+}
+
+static void *zmq_socket_nolinger (void *ctx_, int type_)
+{
+    void *s = zmq_socket (ctx_, type_);
+    assert (s);
+    int linger = 0;
+    int rc = zmq_setsockopt (s, ZMQ_LINGER, &linger, sizeof linger);
+    assert (rc == 0);
+    return s;
+}
+
+//  A socket handles the commands from the I/O threads, such as the one
+//  announcing a reconnect, only inside the API calls.
+static void process_commands (void *s_)
+{
+    uint32_t events;
+    size_t events_size = sizeof events;
+    int rc = zmq_getsockopt (s_, ZMQ_EVENTS, &events, &events_size);
+    assert (rc == 0);
+}
+
+static void zmq_send_string (void *s_, const std::string &data_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init_size (&msg, data_.size ());
+    assert (rc == 0);
+    memcpy (zmq_msg_data (&msg), data_.data (), data_.size ());
+    rc = zmq_send (s_, &msg, 0);
+    assert (rc == 0);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+static std::string zmq_recv_string (void *s_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_recv (s_, &msg, 0);
+    assert (rc == 0);
+    std::string data ((char*) zmq_msg_data (&msg), zmq_msg_size (&msg));
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return data;
+}
+
+//  A PUB socket sends only the messages matching the subscriptions to the
+//  peers that subscribe, and everything to the peers that never do.
+static void test_subscribe (void *ctx_)
+{
+    void *pub = zmq_socket_nolinger (ctx_, ZMQ_PUB);
+    int rc = zmq_bind (pub, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+
+    void *sub = zmq_socket_nolinger (ctx_, ZMQ_SUB);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "A", 1);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "tcp://127.0.0.1:5561");
+    assert (rc == 0);
+
+    int subscriber = raw_connect (5561);
+    raw_subscribe (subscriber, "A");
+    int silent = raw_connect (5561);
+    settle ();
+
+    const char *first [] = {"B1", "A1", "B2", "A2", "AEND"};
+    for (size_t i = 0; i != sizeof first / sizeof first [0]; i++)
+        zmq_send_string (pub, first [i]);
+
+    assert (raw_recv (subscriber) == "A1");
+    assert (raw_recv (subscriber) == "A2");
+    assert (raw_recv (subscriber) == "AEND");
+    assert (zmq_recv_string (sub) == "A1");
+    assert (zmq_recv_string (sub) == "A2");
+    assert (zmq_recv_string (sub) == "AEND");
+    for (size_t i = 0; i != sizeof first / sizeof first [0]; i++)
+        assert (raw_recv (silent) == first [i]);
+
+    //  Swap the subscription for another one.
+    raw_unsubscribe (subscriber, "A");
+    raw_subscribe (subscriber, "B");
+    rc = zmq_setsockopt (sub, ZMQ_UNSUBSCRIBE, "A", 1);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "B", 1);
+    assert (rc == 0);
+    settle ();
+
+    const char *second [] = {"A3", "B3", "A4", "BEND"};
+    for (size_t i = 0; i != sizeof second / sizeof second [0]; i++)
+        zmq_send_string (pub, second [i]);
+
+    assert (raw_recv (subscriber) == "B3");
+    assert (raw_recv (subscriber) == "BEND");
+    assert (zmq_recv_string (sub) == "B3");
+    assert (zmq_recv_string (sub) == "BEND");
+    for (size_t i = 0; i != sizeof second / sizeof second [0]; i++)
+        assert (raw_recv (silent) == second [i]);
+
+    close (subscriber);
+    close (silent);
+    rc = zmq_close (sub);
+    assert (rc == 0);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+}
+
+//  A SUB socket sends all its subscriptions again after reconnecting.
+static void test_sub_reconnect (void *ctx_)
+{
+    int listener = raw_listen (5562);
+
+    void *sub = zmq_socket_nolinger (ctx_, ZMQ_SUB);
+    int rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "A", 1);
+    assert (rc == 0);
+    rc = zmq_setsockopt (sub, ZMQ_SUBSCRIBE, "B", 1);
+    assert (rc == 0);
+    rc = zmq_connect (sub, "tcp://127.0.0.1:5562");
+    assert (rc == 0);
+
+    int publisher = raw_accept (listener);
+    assert (raw_recv (publisher) == std::string ("\1A"));
+    assert (raw_recv (publisher) == std::string ("\1B"));
+    raw_send (publisher, "A1");
+    assert (zmq_recv_string (sub) == "A1");
+
+    //  Drop the connection. The subscriptions are replayed to the new one.
+    close (publisher);
+    publisher = raw_accept (listener);
+    settle ();
+    process_commands (sub);
+    assert (raw_recv (publisher) == std::string ("\1A"));
+    assert (raw_recv (publisher) == std::string ("\1B"));
+    raw_send (publisher, "B1");
+    assert (zmq_recv_string (sub) == "B1");
+
+    close (publisher);
+    close (listener);
+    rc = zmq_close (sub);
+    assert (rc == 0);
+}
+
+//  A PUB socket forgets the subscriptions of the peer it lost.
+static void test_pub_reconnect (void *ctx_)
+{
+    int listener = raw_listen (5563);
+
+    void *pub = zmq_socket_nolinger (ctx_, ZMQ_PUB);
+    int rc = zmq_connect (pub, "tcp://127.0.0.1:5563");
+    assert (rc == 0);
+
+    int subscriber = raw_accept (listener);
+    raw_subscribe (subscriber, "A");
+    settle ();
+    zmq_send_string (pub, "B1");
+    zmq_send_string (pub, "A1");
+    assert (raw_recv (subscriber) == "A1");
+
+    //  The new peer never subscribes, so it gets all the messages.
+    close (subscriber);
+    subscriber = raw_accept (listener);
+    settle ();
+    zmq_send_string (pub, "B2");
+    assert (raw_recv (subscriber) == "B2");
+
+    //  Once it subscribes, only its own subscriptions apply.
+    raw_subscribe (subscriber, "C");
+    settle ();
+    zmq_send_string (pub, "A3");
+    zmq_send_string (pub, "C3");
+    assert (raw_recv (subscriber) == "C3");
+
+    close (subscriber);
+    close (listener);
+    rc = zmq_close (pub);
+    assert (rc == 0);
+}
+
+int main (int argc, char *argv [])
+{
+    void *ctx = zmq_init (1);
+    assert (ctx);
+
+    test_subscribe (ctx);
+    test_sub_reconnect (ctx);
+    test_pub_reconnect (ctx);
+
+    int rc = zmq_term (ctx);
+    assert (rc == 0);
+
+    return 0 ;
+}
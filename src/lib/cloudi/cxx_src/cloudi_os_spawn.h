@@ -19,11 +19,25 @@
 #define PORT_CXX_FUNCTIONS_HEADER_FILE "os_spawn.hpp"
 
 // specify all the functions to generate bindings for
+// (ASYNC functions are executed by a thread pool in the port OS process,
+//  so they must not use the state the synchronous functions use)
 //  __________________________________________________________________________
-//  || FUNCTION     || ARITY/TYPES                           || RETURN TYPE ||
-#define PORT_FUNCTIONS \
+//  || FUNCTION     || ARITY/TYPES                      || RETURN  || ASYNC ||
+#define PORT_DRIVER_FUNCTIONS \
     ((spawn,           5, (char, puint32_len, \
-                           pchar_len, pchar_len, pchar_len),    int32_t ))
+                           pchar_len, pchar_len, pchar_len), int32_t, 0)) \
+    ((spawn_placed,   10, (char, puint32_len, \
+                           pchar_len, pchar_len, pchar_len, \
+                           puint32_len, int32_t, pchar_len, \
+                           uint32_t, uint32_t),              int32_t, 0)) \
+    ((spawn_warm,     11, (char, puint32_len, \
+                           pchar_len, pchar_len, pchar_len, \
+                           puint32_len, int32_t, pchar_len, \
+                           uint32_t, uint32_t, uint32_t),    int32_t, 0)) \
+    ((spawn_warm_stop, 10, (char, uint32_t, \
+                           pchar_len, pchar_len, pchar_len, \
+                           puint32_len, int32_t, pchar_len, \
+                           uint32_t, uint32_t),              int32_t, 0))
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -54,6 +54,8 @@
 #include <boost/preprocessor/tuple/to_seq.hpp>
 #include <boost/preprocessor/control/if.hpp>
 #include <boost/preprocessor/punctuation/comma.hpp>
+#include <boost/preprocessor/logical/or.hpp>
+#include <boost/preprocessor/seq/fold_left.hpp>
 
 #define ENCODE_ARGUMENT_AS_BINARY_FROM_TYPE_char(N) \
     <<CREATE_FUNCTION_ARGUMENTS(_, N, _):8/signed-integer-native>>
@@ -136,7 +138,7 @@
 -define(ERL_PORT_NAME_PREFIX, \
         BOOST_PP_STRINGIZE(PORT_NAME_PREFIX)).
 #endif
-#elif defined(PORT_NAME)
+#elif defined(PORT_NAME) && defined(PORT_FUNCTIONS)
 
 // 4 tuple elements in the PORT_FUNCTIONS sequence
 #define PORT_FUNCTION_ENTRY_LENGTH   4
@@ -173,6 +175,57 @@
 -define(ERL_PORT_NAME_PREFIX, \
         BOOST_PP_STRINGIZE(PORT_NAME_PREFIX)).
 #define FUNCTIONS_SEQUENCE PORT_FUNCTIONS
+#elif defined(PORT_NAME) && defined(PORT_DRIVER_FUNCTIONS)
+
+// a port may use PORT_DRIVER_FUNCTIONS to execute asynchronous
+// function calls with a thread pool in the port OS process
+
+// 5 tuple elements in the PORT_DRIVER_FUNCTIONS sequence
+#define PORT_DRIVER_FUNCTION_ENTRY_LENGTH   5
+// specific tuple elements in the PORT_DRIVER_FUNCTIONS sequence
+#define PORT_DRIVER_FUNCTION_ENTRY_NAME     0
+#define PORT_DRIVER_FUNCTION_ENTRY_ARGC     1
+#define PORT_DRIVER_FUNCTION_ENTRY_ARGV     2
+#define PORT_DRIVER_FUNCTION_ENTRY_RETURN   3
+#define PORT_DRIVER_FUNCTION_ENTRY_ASYNC    4
+// macros to access function data in a PORT_DRIVER_FUNCTIONS tuple entry
+#define GET_NAME(FUNCTION) \
+    BOOST_PP_TUPLE_ELEM(\
+        PORT_DRIVER_FUNCTION_ENTRY_LENGTH, \
+        PORT_DRIVER_FUNCTION_ENTRY_NAME, FUNCTION\
+    )
+#define GET_ARGC(FUNCTION) \
+    BOOST_PP_TUPLE_ELEM(\
+        PORT_DRIVER_FUNCTION_ENTRY_LENGTH, \
+        PORT_DRIVER_FUNCTION_ENTRY_ARGC, FUNCTION\
+    )
+#define GET_ARGV(FUNCTION) \
+    BOOST_PP_TUPLE_ELEM(\
+        PORT_DRIVER_FUNCTION_ENTRY_LENGTH, \
+        PORT_DRIVER_FUNCTION_ENTRY_ARGV, FUNCTION\
+    )
+#define GET_RETURN(FUNCTION) \
+    BOOST_PP_TUPLE_ELEM(\
+        PORT_DRIVER_FUNCTION_ENTRY_LENGTH, \
+        PORT_DRIVER_FUNCTION_ENTRY_RETURN, FUNCTION\
+    )
+#define GET_ASYNC(FUNCTION) \
+    BOOST_PP_TUPLE_ELEM(\
+        PORT_DRIVER_FUNCTION_ENTRY_LENGTH, \
+        PORT_DRIVER_FUNCTION_ENTRY_ASYNC, FUNCTION\
+    )
+
+-define(ERL_PORT_NAME, \
+        BOOST_PP_STRINGIZE(PORT_NAME)).
+-define(ERL_PORT_NAME_PREFIX, \
+        BOOST_PP_STRINGIZE(PORT_NAME_PREFIX)).
+#define FUNCTIONS_SEQUENCE PORT_DRIVER_FUNCTIONS
+
+#define ANY_ASYNC_FUNCTION(S, STATE, FUNCTION) \
+    BOOST_PP_OR(STATE, GET_ASYNC(FUNCTION))
+#if BOOST_PP_SEQ_FOLD_LEFT(ANY_ASYNC_FUNCTION, 0, FUNCTIONS_SEQUENCE)
+-define(ERL_PORT_ASYNC, true).
+#endif
 #else
 #error Neither PORT_DRIVER_NAME nor PORT_NAME defined
 #endif
@@ -50,8 +50,22 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <deque>
+#include <map>
+#include <set>
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
 
 namespace
 {
@@ -650,6 +664,293 @@ namespace
         }
     }
 
+    // placement of a spawned OS process (CPU affinity, NUMA node memory
+    // and cgroup membership) is done by the child process before execve,
+    // with any failure sent back to the parent on a close-on-exec pipe.
+    // placement_status values are negative so they can not be mistaken
+    // for an OS pid or a spawn_status value by the caller.
+    namespace placement_status
+    {
+        enum
+        {
+            success                         =   0,
+            invalid_input                   =  -1,
+            unsupported                     =  -2,
+            affinity_EINVAL                 =  -3,
+            affinity_EPERM                  =  -4,
+            affinity_unknown                =  -5,
+            numa_node_invalid               =  -6,
+            mempolicy_EINVAL                =  -7,
+            mempolicy_EPERM                 =  -8,
+            mempolicy_unknown               =  -9,
+            cgroup_EACCES                   = -10,
+            cgroup_ENOENT                   = -11,
+            cgroup_EINVAL                   = -12,
+            cgroup_unknown                  = -13,
+            pipe_read                       = -14
+        };
+
+        char const * string(int status)
+        {
+            switch (status)
+            {
+                case invalid_input:
+                    return "invalid_input";
+                case unsupported:
+                    return "unsupported";
+                case affinity_EINVAL:
+                    return "affinity_EINVAL";
+                case affinity_EPERM:
+                    return "affinity_EPERM";
+                case affinity_unknown:
+                    return "affinity_unknown";
+                case numa_node_invalid:
+                    return "numa_node_invalid";
+                case mempolicy_EINVAL:
+                    return "mempolicy_EINVAL";
+                case mempolicy_EPERM:
+                    return "mempolicy_EPERM";
+                case mempolicy_unknown:
+                    return "mempolicy_unknown";
+                case cgroup_EACCES:
+                    return "cgroup_EACCES";
+                case cgroup_ENOENT:
+                    return "cgroup_ENOENT";
+                case cgroup_EINVAL:
+                    return "cgroup_EINVAL";
+                case cgroup_unknown:
+                    return "cgroup_unknown";
+                case pipe_read:
+                    return "pipe_read";
+                default:
+                    return 0;
+            }
+        }
+
+        int errno_cgroup()
+        {
+            switch (errno)
+            {
+                case EACCES:
+                case EPERM:
+                case EROFS:
+                    return cgroup_EACCES;
+                case ENOENT:
+                case ENOTDIR:
+                    return cgroup_ENOENT;
+                case EINVAL:
+                case ERANGE:
+                    return cgroup_EINVAL;
+                default:
+                    return cgroup_unknown;
+            }
+        }
+
+        class placement
+        {
+            public:
+                placement(uint32_t * cpus, uint32_t cpus_len,
+                          int32_t numa_node,
+                          char * cgroup, uint32_t cgroup_len,
+                          uint32_t cpu_quota, uint32_t cpu_period) :
+                    m_cpus(cpus),
+                    m_cpus_len(cpus_len),
+                    m_numa_node(numa_node),
+                    m_cgroup(cgroup),
+                    m_cgroup_len(cgroup_len),
+                    m_cpu_quota(cpu_quota),
+                    m_cpu_period(cpu_period)
+                {
+                }
+
+                bool empty() const
+                {
+                    return (m_cpus_len == 0 && m_numa_node < 0 &&
+                            m_cgroup_len <= 1);
+                }
+
+                int validate() const
+                {
+                    if (m_cgroup_len == 0 || m_cgroup[m_cgroup_len - 1] != '\0')
+                        return invalid_input;
+                    if (m_cpu_quota > 0 && m_cpu_period == 0)
+                        return invalid_input;
+                    if (m_cpu_quota > 0 && m_cgroup_len <= 1)
+                        return invalid_input;
+                    return success;
+                }
+
+                // executed within the child process, before execve
+                int apply() const
+                {
+#if defined(__linux__)
+                    int status;
+                    if (m_cgroup_len > 1 && (status = apply_cgroup()))
+                        return status;
+                    cpu_set_t cpu_set;
+                    CPU_ZERO(&cpu_set);
+                    if (m_numa_node >= 0)
+                    {
+                        if ((status = numa_node_cpus(cpu_set)))
+                            return status;
+                        if ((status = apply_mempolicy()))
+                            return status;
+                    }
+                    if (m_cpus_len > 0)
+                    {
+                        // an explicit CPU list takes precedence over the
+                        // CPUs of the NUMA node
+                        CPU_ZERO(&cpu_set);
+                        for (size_t i = 0; i < m_cpus_len; ++i)
+                        {
+                            if (m_cpus[i] >= CPU_SETSIZE)
+                                return affinity_EINVAL;
+                            CPU_SET(m_cpus[i], &cpu_set);
+                        }
+                    }
+                    if (m_cpus_len > 0 || m_numa_node >= 0)
+                    {
+                        if (::sched_setaffinity(0, sizeof(cpu_set),
+                                                &cpu_set) == -1)
+                        {
+                            switch (errno)
+                            {
+                                case EINVAL:
+                                    return affinity_EINVAL;
+                                case EPERM:
+                                    return affinity_EPERM;
+                                default:
+                                    return affinity_unknown;
+                            }
+                        }
+                    }
+                    return success;
+#else
+                    return unsupported;
+#endif
+                }
+
+            private:
+#if defined(__linux__)
+                static int write_file(char const * const path,
+                                      char const * const data)
+                {
+                    int const fd = ::open(path, O_WRONLY);
+                    if (fd == -1)
+                        return errno_cgroup();
+                    size_t const length = ::strlen(data);
+                    ssize_t const result = ::write(fd, data, length);
+                    int const write_errno = errno;
+                    ::close(fd);
+                    if (result != static_cast<ssize_t>(length))
+                    {
+                        errno = (result == -1) ? write_errno : EINVAL;
+                        return errno_cgroup();
+                    }
+                    return success;
+                }
+
+                // cgroup v2 (unified hierarchy) files within the
+                // cgroup directory (the cpu controller must be enabled
+                // for the cpu.max quota, which is shared by all the
+                // processes within the cgroup)
+                int apply_cgroup() const
+                {
+                    char path[PATH_MAX];
+                    char data[64];
+                    int status;
+                    if (m_cpu_quota > 0)
+                    {
+                        if (::snprintf(path, sizeof(path), "%s/cpu.max",
+                                       m_cgroup) >= PATH_MAX)
+                            return invalid_input;
+                        ::snprintf(data, sizeof(data), "%u %u",
+                                   m_cpu_quota, m_cpu_period);
+                        if ((status = write_file(path, data)))
+                            return status;
+                    }
+                    if (::snprintf(path, sizeof(path), "%s/cgroup.procs",
+                                   m_cgroup) >= PATH_MAX)
+                        return invalid_input;
+                    ::snprintf(data, sizeof(data), "%lu",
+                               static_cast<unsigned long>(::getpid()));
+                    return write_file(path, data);
+                }
+
+                // parse the NUMA node's cpulist (e.g., "0-7,16-23")
+                int numa_node_cpus(cpu_set_t & cpu_set) const
+                {
+                    char path[PATH_MAX];
+                    ::snprintf(path, sizeof(path),
+                               "/sys/devices/system/node/node%d/cpulist",
+                               m_numa_node);
+                    int const fd = ::open(path, O_RDONLY);
+                    if (fd == -1)
+                        return numa_node_invalid;
+                    char cpulist[4096];
+                    ssize_t const length = ::read(fd, cpulist,
+                                                  sizeof(cpulist) - 1);
+                    ::close(fd);
+                    if (length <= 0)
+                        return numa_node_invalid;
+                    cpulist[length] = '\0';
+                    char * p = cpulist;
+                    while (*p >= '0' && *p <= '9')
+                    {
+                        unsigned long const first = ::strtoul(p, &p, 10);
+                        unsigned long last = first;
+                        if (*p == '-')
+                            last = ::strtoul(p + 1, &p, 10);
+                        if (last >= CPU_SETSIZE || last < first)
+                            return numa_node_invalid;
+                        for (unsigned long cpu = first; cpu <= last; ++cpu)
+                            CPU_SET(cpu, &cpu_set);
+                        if (*p == ',')
+                            ++p;
+                    }
+                    if (CPU_COUNT(&cpu_set) == 0)
+                        return numa_node_invalid;
+                    return success;
+                }
+
+                // prefer memory allocations on the NUMA node
+                // (the memory policy is preserved across execve)
+                int apply_mempolicy() const
+                {
+#if defined(SYS_set_mempolicy)
+                    int const mpol_preferred = 1; // MPOL_PREFERRED
+                    unsigned long const bits = sizeof(unsigned long) * 8;
+                    if (static_cast<unsigned long>(m_numa_node) >= bits)
+                        return numa_node_invalid;
+                    unsigned long nodemask = 1UL << m_numa_node;
+                    if (::syscall(SYS_set_mempolicy, mpol_preferred,
+                                  &nodemask, bits) == -1)
+                    {
+                        switch (errno)
+                        {
+                            case EINVAL:
+                                return mempolicy_EINVAL;
+                            case EPERM:
+                                return mempolicy_EPERM;
+                            default:
+                                return mempolicy_unknown;
+                        }
+                    }
+#endif
+                    return success;
+                }
+#endif
+
+                uint32_t * const m_cpus;
+                uint32_t const m_cpus_len;
+                int32_t const m_numa_node;
+                char * const m_cgroup;
+                uint32_t const m_cgroup_len;
+                uint32_t const m_cpu_quota;
+                uint32_t const m_cpu_period;
+        };
+    }
+
     class process_data
     {
         public:
@@ -777,12 +1078,317 @@ namespace
     };
 
     std::vector< copy_ptr<process_data> > processes;
+
+    // wait for the child process to apply the placement,
+    // returning the child's placement_status
+    int placement_wait(int fd)
+    {
+        int status = placement_status::success;
+        size_t index = 0;
+        while (index < sizeof(status))
+        {
+            ssize_t const i = ::read(fd,
+                                     reinterpret_cast<char *>(&status) + index,
+                                     sizeof(status) - index);
+            if (i == -1 && errno == EINTR)
+                continue;
+            if (i == -1)
+                return placement_status::pipe_read;
+            if (i == 0)
+                break;
+            index += i;
+        }
+        if (index == 0)
+            return placement_status::success; // closed by execve
+        else if (index != sizeof(status))
+            return placement_status::pipe_read;
+        return status;
+    }
+
+    // the first socket connection gets a pid message for attempting
+    // to kill the OS process when the Erlang process terminates
+    int pid_message_encode(char * pid_message, int & pid_message_index,
+                           int use_header, unsigned long const pid)
+    {
+        pid_message_index = 0;
+        if (use_header)
+            pid_message_index = 4;
+        if (ei_encode_version(pid_message, &pid_message_index))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (ei_encode_tuple_header(pid_message, &pid_message_index, 2))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (ei_encode_atom(pid_message, &pid_message_index, "pid"))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (ei_encode_ulong(pid_message, &pid_message_index, pid))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (use_header)
+        {
+            int pid_message_length = pid_message_index - 4;
+            pid_message[0] = (pid_message_length & 0xff000000) >> 24;
+            pid_message[1] = (pid_message_length & 0x00ff0000) >> 16;
+            pid_message[2] = (pid_message_length & 0x0000ff00) >> 8;
+            pid_message[3] =  pid_message_length & 0x000000ff;
+        }
+        return 0;
+    }
+
+    // a warm OS process has already executed (loading its runtime) and
+    // is blocked within the CloudI API on a control socket (as fd 3).
+    // Once it is ready, it writes a single byte to ask for its sockets:
+    // 'f' to receive the connected sockets as file descriptors
+    // (with SCM_RIGHTS, one per message) or 'p' to receive the port numbers
+    // and the pid message, so it connects the sockets itself (for runtimes
+    // that can not receive file descriptors, like Java)
+    class warm_process
+    {
+        public:
+            enum
+            {
+                handoff_gone = -1,      // the OS process exited
+                handoff_not_ready = -2, // the OS process is still starting
+                handoff_not_warm = -3   // the OS process is not using
+                                        // a CloudI API that supports warm
+                                        // OS processes
+            };
+
+            warm_process(pid_t const pid, int const control) :
+                m_pid(pid), m_control(control)
+            {
+            }
+
+            pid_t pid() const
+            {
+                return m_pid;
+            }
+
+            // give the warm OS process the sockets for the CloudI job
+            int handoff(int type, int use_header,
+                        uint32_t * ports, uint32_t ports_len) const
+            {
+                char request;
+                ssize_t count;
+                while ((count = ::recv(m_control, &request, 1,
+                                       MSG_DONTWAIT)) == -1 &&
+                       errno == EINTR);
+                if (count == -1)
+                {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return handoff_not_ready;
+                    return handoff_gone;
+                }
+                else if (count == 0)
+                {
+                    return handoff_gone;
+                }
+                char pid_message[1024];
+                int pid_message_index;
+                int status;
+                if ((status = pid_message_encode(pid_message,
+                                                 pid_message_index,
+                                                 use_header, m_pid)))
+                    return status;
+                if (request == 'p')
+                    return send_ports(ports, ports_len,
+                                      pid_message, pid_message_index);
+                else if (request != 'f')
+                    return handoff_not_warm;
+                std::vector<int> sockfds;
+                for (size_t i = 0; i < ports_len; ++i)
+                {
+                    int const sockfd = ::socket(AF_INET, type, 0);
+                    if (sockfd == -1)
+                    {
+                        status = spawn_status::errno_socket();
+                        break;
+                    }
+                    sockfds.push_back(sockfd);
+                    if (type == SOCK_STREAM)
+                    {
+                        int tcp_nodelay_flag = 1;
+                        // set TCP_NODELAY to turn off Nagle's algorithm
+                        if (setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY,
+                                       (char *) &tcp_nodelay_flag,
+                                       sizeof(int)) == -1)
+                        {
+                            status = spawn_status::socket_unknown;
+                            break;
+                        }
+                    }
+                    struct sockaddr_in localhost;
+                    localhost.sin_family = AF_INET;
+                    localhost.sin_port = htons(ports[i]);
+                    localhost.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                    if (::connect(sockfd,
+                                  reinterpret_cast<struct sockaddr *>(
+                                      &localhost),
+                                  sizeof(localhost)) == -1)
+                    {
+                        status = spawn_status::errno_connect();
+                        break;
+                    }
+                    if (i == 0 && ::write(sockfd, pid_message,
+                                          pid_message_index) == -1)
+                    {
+                        status = spawn_status::errno_write();
+                        break;
+                    }
+                }
+                for (size_t i = 0; status == 0 && i < sockfds.size(); ++i)
+                    status = send_fd(sockfds[i]);
+                for (size_t i = 0; i < sockfds.size(); ++i)
+                    ::close(sockfds[i]);
+                return status;
+            }
+
+            void close() const
+            {
+                ::close(m_control);
+            }
+
+            // the OS process is reaped when its stdout/stderr pipes close
+            void stop() const
+            {
+                ::close(m_control);
+                ::kill(m_pid, 9);
+            }
+
+        private:
+            // each file descriptor is sent separately, with a single byte,
+            // since that is what most runtimes are able to receive
+            int send_fd(int const sockfd) const
+            {
+                char control[CMSG_SPACE(sizeof(int))];
+                ::memset(control, 0, sizeof(control));
+                char data = 'w';
+                struct iovec iov;
+                iov.iov_base = &data;
+                iov.iov_len = 1;
+                struct msghdr message;
+                ::memset(&message, 0, sizeof(message));
+                message.msg_iov = &iov;
+                message.msg_iovlen = 1;
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+                struct cmsghdr * header = CMSG_FIRSTHDR(&message);
+                header->cmsg_level = SOL_SOCKET;
+                header->cmsg_type = SCM_RIGHTS;
+                header->cmsg_len = CMSG_LEN(sizeof(int));
+                ::memcpy(CMSG_DATA(header), &sockfd, sizeof(int));
+                ssize_t result;
+                while ((result = ::sendmsg(m_control, &message,
+                                           send_flags())) == -1 &&
+                       errno == EINTR);
+                if (result != 1)
+                    return handoff_gone;
+                return 0;
+            }
+
+            // the port count, each port and the pid message (with its
+            // length), as big-endian 32 bit integers
+            int send_ports(uint32_t * ports, uint32_t ports_len,
+                           char const * pid_message,
+                           int const pid_message_index) const
+            {
+                std::vector<char> data;
+                data.reserve((ports_len + 2) * 4 + pid_message_index);
+                append_uint32(data, ports_len);
+                for (size_t i = 0; i < ports_len; ++i)
+                    append_uint32(data, ports[i]);
+                append_uint32(data, pid_message_index);
+                data.insert(data.end(), pid_message,
+                            pid_message + pid_message_index);
+                size_t total = 0;
+                while (total < data.size())
+                {
+                    ssize_t const i = ::send(m_control, &data[total],
+                                             data.size() - total,
+                                             send_flags());
+                    if (i == -1)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        return handoff_gone;
+                    }
+                    total += i;
+                }
+                return 0;
+            }
+
+            static void append_uint32(std::vector<char> & data,
+                                      uint32_t const value)
+            {
+                data.push_back((value & 0xff000000) >> 24);
+                data.push_back((value & 0x00ff0000) >> 16);
+                data.push_back((value & 0x0000ff00) >> 8);
+                data.push_back( value & 0x000000ff);
+            }
+
+            static int send_flags()
+            {
+#if defined(MSG_NOSIGNAL)
+                return MSG_NOSIGNAL;
+#else
+                return 0;
+#endif
+            }
+
+            pid_t m_pid;
+            int m_control;
+    };
+
+    // warm OS processes, stored by the spawn parameters used to create them
+    typedef std::map< std::string, std::deque<warm_process> > warm_lookup_t;
+    warm_lookup_t warm_processes;
+
+    // spawn parameters keys of the CloudI jobs that started a warm OS process
+    // which did not ask for its sockets properly, so no more are started
+    std::set<std::string> warm_unsupported;
+
+    // all the spawn parameters, except for the port numbers
+    std::string warm_key(char protocol, uint32_t ports_len,
+                         char * filename, uint32_t filename_len,
+                         char * argv, uint32_t argv_len,
+                         char * env, uint32_t env_len,
+                         uint32_t * cpus, uint32_t cpus_len,
+                         int32_t numa_node,
+                         char * cgroup, uint32_t cgroup_len,
+                         uint32_t cpu_quota, uint32_t cpu_period)
+    {
+        std::string key(1, protocol);
+        key.append(filename, filename_len);
+        key.append(argv, argv_len);
+        key.append(env, env_len);
+        key.append(reinterpret_cast<char *>(cpus),
+                   cpus_len * sizeof(uint32_t));
+        key.append(reinterpret_cast<char *>(&numa_node), sizeof(numa_node));
+        key.append(cgroup, cgroup_len);
+        key.append(reinterpret_cast<char *>(&cpu_quota), sizeof(cpu_quota));
+        key.append(reinterpret_cast<char *>(&cpu_period),
+                   sizeof(cpu_period));
+        key.append(reinterpret_cast<char *>(&ports_len), sizeof(ports_len));
+        return key;
+    }
+
+    // stop the warm OS processes kept with the spawn parameters key
+    int32_t warm_stop(warm_lookup_t::iterator const & itr)
+    {
+        std::deque<warm_process> const & warm = itr->second;
+        int32_t const count = static_cast<int32_t>(warm.size());
+        for (size_t i = 0; i < warm.size(); ++i)
+            warm[i].stop();
+        warm_unsupported.erase(itr->first);
+        warm_processes.erase(itr);
+        return count;
+    }
 }
 
-int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
-              char * filename, uint32_t /*filename_len*/,
-              char * argv, uint32_t argv_len,
-              char * env, uint32_t env_len)
+static int32_t spawn_process(char protocol,
+                             uint32_t * ports, uint32_t ports_len,
+                             char * filename,
+                             char * argv, uint32_t argv_len,
+                             char * env, uint32_t env_len,
+                             placement_status::placement const & placement,
+                             int const warm_fd = -1)
 {
     int type;
     int use_header;
@@ -806,6 +1412,15 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
         return spawn_status::errno_pipe();
     if (::pipe(fds_stderr) == -1)
         return spawn_status::errno_pipe();
+    bool const placed = ! placement.empty();
+    int fds_placement[2] = {-1, -1};
+    if (placed)
+    {
+        if (::pipe(fds_placement) == -1)
+            return spawn_status::errno_pipe();
+        if (::fcntl(fds_placement[1], F_SETFD, FD_CLOEXEC) == -1)
+            return spawn_status::pipe_unknown;
+    }
     pid_t const pid = fork();
     if (pid == -1)
     {
@@ -813,6 +1428,18 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
     }
     else if (pid == 0)
     {
+        if (placed)
+        {
+            ::close(fds_placement[0]);
+            int const status = placement.apply();
+            if (status != placement_status::success)
+            {
+                if (::write(fds_placement[1], &status,
+                            sizeof(status)) != sizeof(status))
+                    ::_exit(spawn_status::errno_write());
+                ::_exit(spawn_status::invalid_input);
+            }
+        }
         for (size_t i = 0; i < GEPD::nfds; ++i)
         {
             if (::close(GEPD::fds[i].fd) == -1)
@@ -827,28 +1454,42 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
         if (::close(fds_stderr[0]) == -1 || close(fds_stderr[1]) == -1)
             ::_exit(spawn_status::errno_close());
 
-        char pid_message[1024];
-        int pid_message_index = 0;
-        if (use_header)
-            pid_message_index = 4;
-        unsigned long const pid_child = ::getpid();
-        if (ei_encode_version(pid_message, &pid_message_index))
-            ::_exit(GEPD::ExitStatus::ei_encode_error);
-        if (ei_encode_tuple_header(pid_message, &pid_message_index, 2))
-            ::_exit(GEPD::ExitStatus::ei_encode_error);
-        if (ei_encode_atom(pid_message, &pid_message_index, "pid"))
-            ::_exit(GEPD::ExitStatus::ei_encode_error);
-        if (ei_encode_ulong(pid_message, &pid_message_index, pid_child))
-            ::_exit(GEPD::ExitStatus::ei_encode_error);
-        if (use_header)
+        if (warm_fd != -1)
         {
-            int pid_message_length = pid_message_index - 4;
-            pid_message[0] = (pid_message_length & 0xff000000) >> 24;
-            pid_message[1] = (pid_message_length & 0x00ff0000) >> 16;
-            pid_message[2] = (pid_message_length & 0x0000ff00) >> 8;
-            pid_message[3] =  pid_message_length & 0x000000ff;
+            // the sockets are sent later by the parent process
+            if (warm_fd != 3)
+            {
+                if (::dup2(warm_fd, 3) == -1)
+                    ::_exit(spawn_status::errno_dup());
+                if (::close(warm_fd) == -1)
+                    ::_exit(spawn_status::errno_close());
+            }
+            // keep the fds the sockets are moved to in use, so the
+            // OS process can not open anything there before it receives them
+            if (ports_len > 1)
+            {
+                int const fd_null = ::open("/dev/null", O_RDWR);
+                if (fd_null == -1)
+                    ::_exit(spawn_status::errno_dup());
+                for (size_t i = 4; i < ports_len + 3; ++i)
+                {
+                    if (static_cast<size_t>(fd_null) != i &&
+                        ::dup2(fd_null, i) == -1)
+                        ::_exit(spawn_status::errno_dup());
+                }
+                if (static_cast<size_t>(fd_null) >= ports_len + 3 &&
+                    ::close(fd_null) == -1)
+                    ::_exit(spawn_status::errno_close());
+            }
+            ports_len = 0;
         }
 
+        char pid_message[1024];
+        int pid_message_index;
+        if (pid_message_encode(pid_message, pid_message_index,
+                               use_header, ::getpid()))
+            ::_exit(GEPD::ExitStatus::ei_encode_error);
+
         for (size_t i = 0; i < ports_len; ++i)
         {
             int sockfd = ::socket(AF_INET, type, 0);
@@ -882,8 +1523,6 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
 
             if (i == 0)
             {
-                // let the first connection get a pid message for attempting
-                // to kill the OS process when the Erlang process terminates
                 if (::write(sockfd, pid_message, pid_message_index) == -1)
                     ::_exit(spawn_status::errno_write());
             }
@@ -919,7 +1558,10 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
             }
         }
 
+        char warm_env[] = "CLOUDI_API_INIT_WARM=1";
         int env_count = 1;
+        if (warm_fd != -1)
+            ++env_count;
         {
             assert(env[env_len - 1] == '\0');
             for (size_t i = 1; i < env_len; ++i)
@@ -930,22 +1572,20 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
         }
         char * execve_env[env_count];
         {
-            if (env_count == 1)
-            {
-                execve_env[0] = 0;
-            }
-            else
+            int index = 0;
+            if (warm_fd != -1)
+                execve_env[index++] = warm_env;
+            if (env_len > 1)
             {
-                int index = 0;
                 execve_env[index++] = env;
                 for (size_t i = 0; i < env_len - 1; ++i)
                 {
                     if (env[i] == '\0')
                         execve_env[index++] = &(env[i + 1]);
                 }
-                execve_env[index++] = 0;
-                assert(index == env_count);
             }
+            execve_env[index++] = 0;
+            assert(index == env_count);
         }
 
         ::execve(filename, execve_argv, execve_env);
@@ -957,6 +1597,22 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
             return spawn_status::errno_close();
         if (::close(fds_stderr[1]) == -1)
             return spawn_status::errno_close();
+        if (placed)
+        {
+            ::close(fds_placement[1]);
+            int const status = placement_wait(fds_placement[0]);
+            ::close(fds_placement[0]);
+            if (status != placement_status::success)
+            {
+                ::close(fds_stdout[0]);
+                ::close(fds_stderr[0]);
+                ::kill(pid, 9);
+                while (::waitpid(pid, 0, 0) == -1 && errno == EINTR);
+                std::cerr << "OS pid " << pid << " placement failed with " <<
+                    placement_status::string(status) << std::endl;
+                return status;
+            }
+        }
 
         if (GEPD::fds.reserve(GEPD::nfds + 2) == false)
             ::exit(spawn_status::out_of_memory);
@@ -978,6 +1634,182 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
     return pid;
 }
 
+int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
+              char * filename, uint32_t /*filename_len*/,
+              char * argv, uint32_t argv_len,
+              char * env, uint32_t env_len)
+{
+    char cgroup[1] = {'\0'};
+    placement_status::placement const placement(0, 0, -1, cgroup, 1, 0, 0);
+    return spawn_process(protocol, ports, ports_len, filename,
+                         argv, argv_len, env, env_len, placement);
+}
+
+int32_t spawn_placed(char protocol, uint32_t * ports, uint32_t ports_len,
+                     char * filename, uint32_t /*filename_len*/,
+                     char * argv, uint32_t argv_len,
+                     char * env, uint32_t env_len,
+                     uint32_t * cpus, uint32_t cpus_len,
+                     int32_t numa_node,
+                     char * cgroup, uint32_t cgroup_len,
+                     uint32_t cpu_quota, uint32_t cpu_period)
+{
+    placement_status::placement const placement(cpus, cpus_len, numa_node,
+                                                cgroup, cgroup_len,
+                                                cpu_quota, cpu_period);
+    int status;
+    if ((status = placement.validate()))
+        return status;
+    return spawn_process(protocol, ports, ports_len, filename,
+                         argv, argv_len, env, env_len, placement);
+}
+
+int32_t spawn_warm(char protocol, uint32_t * ports, uint32_t ports_len,
+                   char * filename, uint32_t filename_len,
+                   char * argv, uint32_t argv_len,
+                   char * env, uint32_t env_len,
+                   uint32_t * cpus, uint32_t cpus_len,
+                   int32_t numa_node,
+                   char * cgroup, uint32_t cgroup_len,
+                   uint32_t cpu_quota, uint32_t cpu_period,
+                   uint32_t warm_count)
+{
+    placement_status::placement const placement(cpus, cpus_len, numa_node,
+                                                cgroup, cgroup_len,
+                                                cpu_quota, cpu_period);
+    int status;
+    if ((status = placement.validate()))
+        return status;
+    if (ports_len == 0)
+        return spawn_status::invalid_input;
+    int type;
+    int use_header;
+    if (protocol == 't') // tcp
+    {
+        type = SOCK_STREAM;
+        use_header = 1;
+    }
+    else if (protocol == 'u') // udp
+    {
+        type = SOCK_DGRAM;
+        use_header = 0;
+    }
+    else
+    {
+        return spawn_status::invalid_input;
+    }
+
+    std::string const key = warm_key(protocol, ports_len,
+                                     filename, filename_len,
+                                     argv, argv_len, env, env_len,
+                                     cpus, cpus_len, numa_node,
+                                     cgroup, cgroup_len,
+                                     cpu_quota, cpu_period);
+    std::deque<warm_process> & warm = warm_processes[key];
+
+    int32_t pid = -1;
+    std::deque<warm_process> not_ready;
+    while (pid == -1 && ! warm.empty())
+    {
+        warm_process const process = warm.front();
+        warm.pop_front();
+        status = process.handoff(type, use_header, ports, ports_len);
+        if (status == 0)
+        {
+            pid = process.pid();
+        }
+        else if (status == warm_process::handoff_not_ready)
+        {
+            not_ready.push_back(process);
+            continue;
+        }
+        else if (status == warm_process::handoff_not_warm)
+        {
+            // the OS process would use the control socket as
+            // a CloudI socket, so none of them are usable
+            process.stop();
+            for (size_t i = 0; i < warm.size(); ++i)
+                warm[i].stop();
+            for (size_t i = 0; i < not_ready.size(); ++i)
+                not_ready[i].stop();
+            warm.clear();
+            not_ready.clear();
+            warm_unsupported.insert(key);
+            std::cerr << "OS pid " << process.pid() << " (" << filename <<
+                ") does not support warm_pool" << std::endl;
+            break;
+        }
+        else if (status != warm_process::handoff_gone)
+        {
+            // the warm OS process is still usable
+            warm.push_front(process);
+            warm.insert(warm.begin(), not_ready.begin(), not_ready.end());
+            return status;
+        }
+        // a warm OS process that died is removed when its stdout/stderr
+        // pipes close, so only the control socket is closed here
+        process.close();
+    }
+    // warm OS processes still starting are used next time
+    warm.insert(warm.begin(), not_ready.begin(), not_ready.end());
+    if (pid == -1)
+    {
+        // no warm OS process was available, so start one normally
+        pid = spawn_process(protocol, ports, ports_len, filename,
+                            argv, argv_len, env, env_len, placement);
+        if (pid <= static_cast<int32_t>(spawn_status::last_value))
+            return pid;
+    }
+
+    // replace the warm OS processes that have been used
+    while (warm.size() < warm_count &&
+           warm_unsupported.find(key) == warm_unsupported.end())
+    {
+        int fds_control[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_control) == -1)
+            break;
+        if (::fcntl(fds_control[0], F_SETFD, FD_CLOEXEC) == -1)
+        {
+            ::close(fds_control[0]);
+            ::close(fds_control[1]);
+            break;
+        }
+        int32_t const warm_pid = spawn_process(protocol, 0, ports_len,
+                                               filename, argv, argv_len,
+                                               env, env_len, placement,
+                                               fds_control[1]);
+        ::close(fds_control[1]);
+        if (warm_pid <= static_cast<int32_t>(spawn_status::last_value))
+        {
+            ::close(fds_control[0]);
+            break;
+        }
+        warm.push_back(warm_process(warm_pid, fds_control[0]));
+    }
+    return pid;
+}
+
+int32_t spawn_warm_stop(char protocol, uint32_t ports_len,
+                        char * filename, uint32_t filename_len,
+                        char * argv, uint32_t argv_len,
+                        char * env, uint32_t env_len,
+                        uint32_t * cpus, uint32_t cpus_len,
+                        int32_t numa_node,
+                        char * cgroup, uint32_t cgroup_len,
+                        uint32_t cpu_quota, uint32_t cpu_period)
+{
+    std::string const key = warm_key(protocol, ports_len,
+                                     filename, filename_len,
+                                     argv, argv_len, env, env_len,
+                                     cpus, cpus_len, numa_node,
+                                     cgroup, cgroup_len,
+                                     cpu_quota, cpu_period);
+    warm_unsupported.erase(key);
+    warm_lookup_t::iterator const itr = warm_processes.find(key);
+    if (itr == warm_processes.end())
+        return 0;
+    return warm_stop(itr);
+}
 
 int main()
 {
@@ -985,7 +1817,8 @@ int main()
     assert(spawn_status::last_value == GEPD::ExitStatus::min);
 
     int const timeout = -1; // milliseconds
-    realloc_ptr<unsigned char> erlang_buffer(32768, 4194304); // 4MB
+    realloc_ptr<unsigned char> erlang_buffer(GEPD::buffer_size_initial,
+                                             GEPD::buffer_size_max);
     realloc_ptr<unsigned char> stream1(1, 16384);
     realloc_ptr<unsigned char> stream2(1, 16384);
     int status;
@@ -1016,6 +1849,9 @@ int main()
             }
         }
     }
+    // the warm OS processes are reaped with all the other OS processes
+    while (! warm_processes.empty())
+        warm_stop(warm_processes.begin());
     return status;
 }
 
@@ -45,5 +45,30 @@ int32_t spawn(char protocol, uint32_t * ports, uint32_t ports_len,
               char * filename, uint32_t filename_len,
               char * argv, uint32_t argv_len,
               char * env, uint32_t env_len);
+int32_t spawn_placed(char protocol, uint32_t * ports, uint32_t ports_len,
+                     char * filename, uint32_t filename_len,
+                     char * argv, uint32_t argv_len,
+                     char * env, uint32_t env_len,
+                     uint32_t * cpus, uint32_t cpus_len,
+                     int32_t numa_node,
+                     char * cgroup, uint32_t cgroup_len,
+                     uint32_t cpu_quota, uint32_t cpu_period);
+int32_t spawn_warm(char protocol, uint32_t * ports, uint32_t ports_len,
+                   char * filename, uint32_t filename_len,
+                   char * argv, uint32_t argv_len,
+                   char * env, uint32_t env_len,
+                   uint32_t * cpus, uint32_t cpus_len,
+                   int32_t numa_node,
+                   char * cgroup, uint32_t cgroup_len,
+                   uint32_t cpu_quota, uint32_t cpu_period,
+                   uint32_t warm_count);
+int32_t spawn_warm_stop(char protocol, uint32_t ports_len,
+                        char * filename, uint32_t filename_len,
+                        char * argv, uint32_t argv_len,
+                        char * env, uint32_t env_len,
+                        uint32_t * cpus, uint32_t cpus_len,
+                        int32_t numa_node,
+                        char * cgroup, uint32_t cgroup_len,
+                        uint32_t cpu_quota, uint32_t cpu_period);
 
 #endif // OS_SPAWN_H
@@ -44,14 +44,19 @@
 
 #include <cstring>
 #include <cstdio>
+#include <climits>
+#include <vector>
 #include <time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/uio.h>
 #include <ei.h>
+#include <boost/static_assert.hpp>
 #include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/repetition/enum.hpp>
 #include <boost/preprocessor/repetition/repeat_from_to.hpp>
 #include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/seq/for_each_i.hpp>
 #include <boost/preprocessor/seq/size.hpp>
 #include <boost/preprocessor/seq/elem.hpp>
 #include <boost/preprocessor/seq/transform.hpp>
@@ -59,8 +64,14 @@
 #include <boost/preprocessor/tuple/elem.hpp>
 #include <boost/preprocessor/punctuation/paren.hpp>
 #include <boost/preprocessor/arithmetic/dec.hpp>
+#include <boost/preprocessor/arithmetic/inc.hpp>
+#include <boost/preprocessor/punctuation/comma_if.hpp>
+#include <boost/preprocessor/repetition/repeat.hpp>
 #include <boost/preprocessor/facilities/empty.hpp>
 #include <boost/preprocessor/control/if.hpp>
+#include <boost/preprocessor/logical/bool.hpp>
+#include <boost/preprocessor/logical/or.hpp>
+#include <boost/preprocessor/seq/fold_left.hpp>
 
 #include "port.hpp"
 #include "realloc_ptr.hpp"
@@ -72,43 +83,50 @@
 // code below depends on these prefix types
 #define INPUT_PREFIX_TYPE    uint16_t // function identifier
 #define OUTPUT_PREFIX_TYPE   uint32_t // maximum length
+#define ASYNC_ID_TYPE        uint32_t // async function call identifier
 
 
 #if ! defined(PORT_NAME)
 #error Define PORT_NAME within the functions header file to specify the \
        executable name
 #endif
-#if ! defined(PORT_FUNCTIONS)
-#if defined(PORT_DRIVER_FUNCTIONS)
+#if defined(PORT_FUNCTIONS)
 
+// PORT_FUNCTIONS only contains synchronous function calls
 #define CREATE_PORT_FUNCTIONS_DEFINITION(S, DATA, ELEMENT) (\
-    BOOST_PP_TUPLE_ELEM(5, 0, ELEMENT),\
-    BOOST_PP_TUPLE_ELEM(5, 1, ELEMENT),\
-    BOOST_PP_TUPLE_ELEM(5, 2, ELEMENT),\
-    BOOST_PP_TUPLE_ELEM(5, 3, ELEMENT))\
+    BOOST_PP_TUPLE_ELEM(4, 0, ELEMENT),\
+    BOOST_PP_TUPLE_ELEM(4, 1, ELEMENT),\
+    BOOST_PP_TUPLE_ELEM(4, 2, ELEMENT),\
+    BOOST_PP_TUPLE_ELEM(4, 3, ELEMENT),\
+    0)\
 
-#define PORT_FUNCTIONS \
+#define PORT_FUNCTIONS_SEQUENCE \
     BOOST_PP_SEQ_TRANSFORM(CREATE_PORT_FUNCTIONS_DEFINITION, _, \
-                           PORT_DRIVER_FUNCTIONS)
-#warning Using PORT_DRIVER_FUNCTIONS to determine PORT_FUNCTIONS
+                           PORT_FUNCTIONS)
+#elif defined(PORT_DRIVER_FUNCTIONS)
+
+// PORT_DRIVER_FUNCTIONS asynchronous function calls are executed
+// by the async thread pool (PORT_ASYNC_THREADS threads, which requires
+// linking with $(BOOST_THREAD_LIB))
+#define PORT_FUNCTIONS_SEQUENCE PORT_DRIVER_FUNCTIONS
 #else
 #error Define PORT_FUNCTIONS within the functions header file to specify \
        the functions and their types
 #endif
-#endif
 
-// define the structure of the PORT_FUNCTIONS macro data
+// define the structure of the PORT_FUNCTIONS_SEQUENCE macro data
 // (sequence of tuples)
 
-// 4 tuple elements in the PORT_FUNCTIONS sequence
-#define PORT_FUNCTION_ENTRY_LENGTH   4
-// specific tuple elements in the PORT_FUNCTIONS sequence
+// 5 tuple elements in the PORT_FUNCTIONS_SEQUENCE sequence
+#define PORT_FUNCTION_ENTRY_LENGTH   5
+// specific tuple elements in the PORT_FUNCTIONS_SEQUENCE sequence
 #define PORT_FUNCTION_ENTRY_NAME     0
 #define PORT_FUNCTION_ENTRY_ARGC     1
 #define PORT_FUNCTION_ENTRY_ARGV     2
 #define PORT_FUNCTION_ENTRY_RETURN   3
+#define PORT_FUNCTION_ENTRY_ASYNC    4
 
-// macros to access function data in a PORT_FUNCTIONS tuple entry
+// macros to access function data in a PORT_FUNCTIONS_SEQUENCE tuple entry
 
 #define GET_NAME(FUNCTION) \
     BOOST_PP_TUPLE_ELEM(\
@@ -130,11 +148,25 @@
         PORT_FUNCTION_ENTRY_LENGTH, \
         PORT_FUNCTION_ENTRY_RETURN, FUNCTION\
     )
-#define GET_ASYNC(FUNCTION) 0
+#define GET_ASYNC(FUNCTION) \
+    BOOST_PP_BOOL(BOOST_PP_TUPLE_ELEM(\
+        PORT_FUNCTION_ENTRY_LENGTH, \
+        PORT_FUNCTION_ENTRY_ASYNC, FUNCTION\
+    ))
+
+// determine if the async thread pool is necessary
+#define ANY_ASYNC_FUNCTION(S, STATE, FUNCTION) \
+    BOOST_PP_OR(STATE, GET_ASYNC(FUNCTION))
+#define PORT_ASYNC \
+    BOOST_PP_SEQ_FOLD_LEFT(ANY_ASYNC_FUNCTION, 0, PORT_FUNCTIONS_SEQUENCE)
+
+#if ! defined(PORT_ASYNC_THREADS)
+#define PORT_ASYNC_THREADS 4
+#endif
 
 // enforce inherent implementation limits
 
-#if BOOST_PP_SEQ_SIZE(PORT_FUNCTIONS) > 32767
+#if BOOST_PP_SEQ_SIZE(PORT_FUNCTIONS_SEQUENCE) > 32767
 #error Limited to 32767 port functions (type uint16_t is used for "cmd")
 #endif
 
@@ -150,271 +182,77 @@ extern "C"
        PORT_CXX_FUNCTIONS_HEADER_FILE are defined
 #endif
 
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_void                          \
-    (void)
-#define STORE_RETURN_VALUE_TYPE_void(CMD)                                     \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_atom(buffer.get<char>(), &index, "ok"))                     \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_char(N)                                       \
-    sizeof(char)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_char(OFFSET)                          \
-    *((char *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_char                          \
-    char returnValue = 
-#define STORE_RETURN_VALUE_TYPE_char(CMD)                                     \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_long(buffer.get<char>(), &index, returnValue))              \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_uchar(N)                                      \
-    sizeof(unsigned char)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_uchar(OFFSET)                         \
-    *((unsigned char *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_uchar                         \
-    unsigned char returnValue = 
-#define STORE_RETURN_VALUE_TYPE_uchar(CMD)                                    \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_char(buffer.get<char>(), &index, (char) returnValue))       \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_bool(N)                                       \
-    sizeof(uint8_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_bool(OFFSET)                          \
-    *((uint8_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_bool                          \
-    bool returnValue = 
-#define STORE_RETURN_VALUE_TYPE_bool(CMD)                                     \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_boolean(buffer.get<char>(), &index, (int) returnValue))     \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_int8_t(N)                                     \
-    sizeof(int8_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_int8_t(OFFSET)                        \
-    *((int8_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_int8_t                        \
-    int8_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_int8_t(CMD)                                   \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_long(buffer.get<char>(), &index, returnValue))              \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_uint8_t(N)                                    \
-    sizeof(uint8_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_uint8_t(OFFSET)                       \
-    *((uint8_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_uint8_t                       \
-    uint8_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_uint8_t(CMD)                                  \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, returnValue))             \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_int16_t(N)                                    \
-    sizeof(int16_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_int16_t(OFFSET)                       \
-    *((int16_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_int16_t                       \
-    int16_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_int16_t(CMD)                                  \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_long(buffer.get<char>(), &index, returnValue))              \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_uint16_t(N)                                   \
-    sizeof(uint16_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_uint16_t(OFFSET)                      \
-    *((uint16_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_uint16_t                      \
-    uint16_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_uint16_t(CMD)                                 \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, returnValue))             \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_int32_t(N)                                    \
-    sizeof(int32_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_int32_t(OFFSET)                       \
-    *((int32_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_int32_t                       \
-    int32_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_int32_t(CMD)                                  \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_long(buffer.get<char>(), &index, returnValue))              \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_uint32_t(N)                                   \
-    sizeof(uint32_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_uint32_t(OFFSET)                      \
-    *((uint32_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_uint32_t                      \
-    uint32_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_uint32_t(CMD)                                 \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, returnValue))             \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_int64_t(N)                                    \
-    sizeof(int64_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_int64_t(OFFSET)                       \
-    *((int64_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_int64_t                       \
-    int64_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_int64_t(CMD)                                  \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_longlong(buffer.get<char>(), &index, returnValue))          \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_uint64_t(N)                                   \
-    sizeof(uint64_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_uint64_t(OFFSET)                      \
-    *((uint64_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_uint64_t                      \
-    uint64_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_uint64_t(CMD)                                 \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulonglong(buffer.get<char>(), &index, returnValue))         \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_time_t(N)                                     \
-    sizeof(uint64_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_time_t(OFFSET)                        \
-    *((uint64_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_time_t                        \
-    uint64_t returnValue = 
-#define STORE_RETURN_VALUE_TYPE_time_t(CMD)                                   \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulonglong(buffer.get<char>(), &index, returnValue))         \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_float(N)                                      \
-    sizeof(double)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_float(OFFSET)                         \
-    ((float) *((double *) &(buffer[(OFFSET)])))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_float                         \
-    double returnValue =
-#define STORE_RETURN_VALUE_TYPE_float(CMD)                                    \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_double(buffer.get<char>(), &index, returnValue))            \
-        return GEPD::ExitStatus::ei_encode_error;
-
-#define GET_TYPE_SIZE_FROM_TYPE_double(N)                                     \
-    sizeof(double)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_double(OFFSET)                        \
-    *((double *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_double                        \
-    double returnValue =
-#define STORE_RETURN_VALUE_TYPE_double(CMD)                                   \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_double(buffer.get<char>(), &index, returnValue))            \
-        return GEPD::ExitStatus::ei_encode_error;
+#if PORT_ASYNC
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
 
-#define GET_TYPE_SIZE_FROM_TYPE_pchar_len(N)                                  \
-    sizeof(uint32_t) + *((uint32_t *) &(buffer[(                              \
-        BOOST_PP_CAT(offset_arg, N)                                           \
-    )]))
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_pchar_len(OFFSET)                     \
-    ((char *) &(buffer[(OFFSET + sizeof(uint32_t))])),                        \
-    *((uint32_t *) &(buffer[(OFFSET)]))
-#define CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_pchar                         \
-    char const * returnValue =
-#define STORE_RETURN_VALUE_TYPE_pchar(CMD)                                    \
-    if (ei_encode_version(buffer.get<char>(), &index))                        \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_tuple_header(buffer.get<char>(), &index, 2))                \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (ei_encode_ulong(buffer.get<char>(), &index, CMD))                     \
-        return GEPD::ExitStatus::ei_encode_error;                             \
-    if (buffer.reserve(index + strlen(returnValue) + 1) == false)             \
-        return GEPD::ExitStatus::write_overflow;                              \
-    if (ei_encode_string(buffer.get<char>(), &index, returnValue))            \
-        return GEPD::ExitStatus::ei_encode_error;
-    
-#define GET_TYPE_SIZE_FROM_TYPE_puint32_len(N)                                \
-    sizeof(uint32_t) + *((uint32_t *) &(buffer[(                              \
-        BOOST_PP_CAT(offset_arg, N)                                           \
-    )])) * sizeof(uint32_t)
-#define GET_FUNCTION_ARGUMENT_FROM_TYPE_puint32_len(OFFSET)                   \
-    ((uint32_t *) &(buffer[(OFFSET + sizeof(uint32_t))])),                    \
-    *((uint32_t *) &(buffer[(OFFSET)]))
-    
+// each PORT_FUNCTIONS argument type is decoded by the argument_TYPE class
+// (below, within the anonymous namespace) and is then passed to the
+// function call with the FUNCTION_ARGUMENT_FROM_TYPE_TYPE(N) expression
+
+#define FUNCTION_ARGUMENT_FROM_TYPE_char(N)                                   \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_uchar(N)                                  \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_bool(N)                                   \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_int8_t(N)                                 \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_uint8_t(N)                                \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_int16_t(N)                                \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_uint16_t(N)                               \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_int32_t(N)                                \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_uint32_t(N)                               \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_int64_t(N)                                \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_uint64_t(N)                               \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_time_t(N)                                 \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_float(N)                                  \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_double(N)                                 \
+    BOOST_PP_CAT(arg, N)
+#define FUNCTION_ARGUMENT_FROM_TYPE_pchar_len(N)                              \
+    BOOST_PP_CAT(arg, N).pchar, BOOST_PP_CAT(arg, N).length
+#define FUNCTION_ARGUMENT_FROM_TYPE_puint32_len(N)                            \
+    BOOST_PP_CAT(arg, N).puint32, BOOST_PP_CAT(arg, N).length
+
+// each PORT_FUNCTIONS return type determines how the function is called:
+// CALL_FUNCTION_VOID    function returns nothing, reply with 'ok'
+// CALL_FUNCTION_VALUE   function returns a value encoded by return_TYPE
+// CALL_FUNCTION_BINARY  function stores a binary with 2 out-params
+//                       (char const ** pchar, uint32_t * length) that
+//                       must remain valid until the function is called again
+//                       (an asynchronous function is called with a mutex
+//                        locked until its binary is copied for the reply)
+
+#define CALL_FUNCTION_FROM_TYPE_void        CALL_FUNCTION_VOID
+#define CALL_FUNCTION_FROM_TYPE_char        CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_uchar       CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_bool        CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_int8_t      CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_uint8_t     CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_int16_t     CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_uint16_t    CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_int32_t     CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_uint32_t    CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_int64_t     CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_uint64_t    CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_time_t      CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_float       CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_double      CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_pchar       CALL_FUNCTION_VALUE
+#define CALL_FUNCTION_FROM_TYPE_pchar_len   CALL_FUNCTION_BINARY
 namespace
 {
     // list of non-fatal errors that can be sent back
@@ -423,8 +261,20 @@ namespace
     namespace Error
     {
         char const * const invalid_function = "Invalid function call";
+        char const * const invalid_arguments = "Invalid function arguments";
     }
 
+#if PORT_ASYNC
+    // all writes to Erlang occur with the mutex locked, so that each
+    // reply from the async thread pool is written as a separate message
+    // (never deleted, like the async thread pool, so exit does not
+    //  destroy the mutex while an async thread might use it)
+    boost::mutex * write_mutex = new boost::mutex();
+#define WRITE_LOCK boost::mutex::scoped_lock write_lock(*write_mutex)
+#else
+#define WRITE_LOCK
+#endif
+
     int errno_read()
     {
         switch (errno)
@@ -570,6 +420,7 @@ namespace
     int write_exact(unsigned char const * const buffer,
                     uint32_t const length)
     {
+        WRITE_LOCK;
         uint32_t total = 0;
         while (total < length)
         {
@@ -589,17 +440,18 @@ namespace
         return GEPD::ExitStatus::success;
     }
     
-    int read_cmd(realloc_ptr<unsigned char> & buffer)
+    int read_cmd(realloc_ptr<unsigned char> & buffer, uint32_t & length)
     {
         unsigned char lengthData[4];
         int const status = read_exact(lengthData, 4);
         if (status)
             return status;
-        uint32_t const length = (lengthData[0] << 24) |
-                                (lengthData[1] << 16) |
-                                (lengthData[2] <<  8) |
-                                 lengthData[3];
-        buffer.reserve(length);
+        length = (lengthData[0] << 24) |
+                 (lengthData[1] << 16) |
+                 (lengthData[2] <<  8) |
+                  lengthData[3];
+        if (buffer.reserve(length) == false)
+            return GEPD::ExitStatus::read_overflow;
         return read_exact(buffer.get(), length);
     }
     
@@ -611,17 +463,76 @@ namespace
         buffer[3] =  length & 0x000000ff;
         return write_exact(buffer.get(), length + 4);
     }
+
+    // write the header and the data, without copying the data
+    int write_cmd_vector(unsigned char * const header, uint32_t header_length,
+                         unsigned char const * const data,
+                         uint32_t const data_length)
+    {
+        uint32_t const length = header_length - 4 + data_length;
+        header[0] = (length & 0xff000000) >> 24;
+        header[1] = (length & 0x00ff0000) >> 16;
+        header[2] = (length & 0x0000ff00) >> 8;
+        header[3] =  length & 0x000000ff;
+        struct iovec iov[2];
+        iov[0].iov_base = header;
+        iov[0].iov_len = header_length;
+        iov[1].iov_base = const_cast<unsigned char *>(data);
+        iov[1].iov_len = data_length;
+        int iov_index = 0;
+        WRITE_LOCK;
+        while (iov_index < 2)
+        {
+            ssize_t i = writev(PORT_WRITE_FILE_DESCRIPTOR,
+                               &iov[iov_index], 2 - iov_index);
+            if (i <= 0)
+            {
+                if (i == -1)
+                    return errno_write();
+                else
+                    return GEPD::ExitStatus::write_null;
+            }
+            while (iov_index < 2 &&
+                   static_cast<size_t>(i) >= iov[iov_index].iov_len)
+            {
+                i -= iov[iov_index].iov_len;
+                ++iov_index;
+            }
+            if (iov_index < 2)
+            {
+                iov[iov_index].iov_base =
+                    reinterpret_cast<char *>(iov[iov_index].iov_base) + i;
+                iov[iov_index].iov_len -= i;
+            }
+        }
+        return GEPD::ExitStatus::success;
+    }
     
+    // identifies the function call a reply is for
+    // (asynchronous function calls include an id from Erlang
+    //  because the replies may be sent in any order)
+    struct call_id
+    {
+        uint16_t cmd;
+        bool async;
+        uint32_t id;
+    };
+
     int reply_error_string(realloc_ptr<unsigned char> & buffer,
-                           int & index, uint16_t cmd, char const * const str)
+                           int & index, call_id const & call,
+                           char const * const str)
     {
         if (ei_encode_version(buffer.get<char>(), &index))
             return GEPD::ExitStatus::ei_encode_error;
-        if (ei_encode_tuple_header(buffer.get<char>(), &index, 3))
+        if (ei_encode_tuple_header(buffer.get<char>(), &index,
+                                   call.async ? 4 : 3))
             return GEPD::ExitStatus::ei_encode_error;
         if (ei_encode_atom(buffer.get<char>(), &index, "error"))
             return GEPD::ExitStatus::ei_encode_error;
-        if (ei_encode_ulong(buffer.get<char>(), &index, cmd))
+        if (ei_encode_ulong(buffer.get<char>(), &index, call.cmd))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (call.async &&
+            ei_encode_ulong(buffer.get<char>(), &index, call.id))
             return GEPD::ExitStatus::ei_encode_error;
         if (buffer.reserve(index + strlen(str) + 1) == false)
             return GEPD::ExitStatus::write_overflow;
@@ -630,71 +541,469 @@ namespace
         return GEPD::ExitStatus::success;
     }
 
-#define STORE_RETURN_VALUE(TYPE, CMD) \
-    BOOST_PP_CAT(STORE_RETURN_VALUE_TYPE_, TYPE)(CMD)
+    int reply_error(realloc_ptr<unsigned char> & buffer,
+                    call_id const & call, char const * const str)
+    {
+        int status;
+        int index = sizeof(OUTPUT_PREFIX_TYPE);
+        if ((status = reply_error_string(buffer, index, call, str)))
+            return status;
+        return write_cmd(buffer, index - sizeof(OUTPUT_PREFIX_TYPE));
+    }
 
-#define GET_FUNCTION_ARGUMENT(TYPE, OFFSET) \
-    BOOST_PP_CAT(\
-        GET_FUNCTION_ARGUMENT_FROM_TYPE_, TYPE \
-    )(OFFSET)
+    // argument decoding
+    // (all argument data is copied out of the buffer with memcpy,
+    //  so no unaligned access occurs, with the exception of pchar_len
+    //  which has no alignment requirement)
 
-#define CREATE_FUNCTION_RETURN_VALUE_STORE(TYPE) \
-    BOOST_PP_CAT(\
-        CREATE_FUNCTION_RETURN_VALUE_STORE_TYPE_, TYPE\
-    )
+    template <typename STORAGE, size_t BITS, typename VALUE = STORAGE>
+    class argument_scalar
+    {
+        // the Erlang code (cloudi_os_spawn_hrl.h) encodes each
+        // argument with BITS bits, which must match the storage type
+        BOOST_STATIC_ASSERT(sizeof(STORAGE) * CHAR_BIT == BITS);
+    public:
+        typedef VALUE value_type;
+
+        static bool decode(realloc_ptr<unsigned char> const & buffer,
+                           size_t & offset, size_t const length,
+                           value_type & value)
+        {
+            if (length < sizeof(STORAGE) || offset > length - sizeof(STORAGE))
+                return false;
+            STORAGE storage;
+            memcpy(&storage, &buffer[offset], sizeof(STORAGE));
+            value = static_cast<VALUE>(storage);
+            offset += sizeof(STORAGE);
+            return true;
+        }
+    };
 
-#define GET_TYPE_SIZE(TYPE, N) \
-    BOOST_PP_CAT(GET_TYPE_SIZE_FROM_TYPE_, TYPE)(N)
+    typedef argument_scalar<char, 8>                argument_char;
+    typedef argument_scalar<unsigned char, 8>       argument_uchar;
+    typedef argument_scalar<uint8_t, 8, bool>       argument_bool;
+    typedef argument_scalar<int8_t, 8>              argument_int8_t;
+    typedef argument_scalar<uint8_t, 8>             argument_uint8_t;
+    typedef argument_scalar<int16_t, 16>            argument_int16_t;
+    typedef argument_scalar<uint16_t, 16>           argument_uint16_t;
+    typedef argument_scalar<int32_t, 32>            argument_int32_t;
+    typedef argument_scalar<uint32_t, 32>           argument_uint32_t;
+    typedef argument_scalar<int64_t, 64>            argument_int64_t;
+    typedef argument_scalar<uint64_t, 64>           argument_uint64_t;
+    typedef argument_scalar<uint64_t, 64>           argument_time_t;
+    typedef argument_scalar<double, 64, float>      argument_float;
+    typedef argument_scalar<double, 64>             argument_double;
+
+    bool decode_array_length(realloc_ptr<unsigned char> const & buffer,
+                             size_t & offset, size_t const length,
+                             size_t const element_size, uint32_t & count)
+    {
+        if (length < sizeof(uint32_t) || offset > length - sizeof(uint32_t))
+            return false;
+        memcpy(&count, &buffer[offset], sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        if (static_cast<uint64_t>(count) * element_size > length - offset)
+            return false;
+        return true;
+    }
 
-#define STORE_FUNCTION_ARGUMENT_SIZE(TYPE, N, OFFSET) \
-    size_t const BOOST_PP_CAT(offset_arg, N) = OFFSET ;
+    class argument_pchar_len
+    {
+    public:
+        struct value_type
+        {
+            char * pchar;
+            uint32_t length;
+        };
 
-#define STORE_FUNCTION_ARGUMENTS(Z, N, DATA) \
-    STORE_FUNCTION_ARGUMENT_SIZE( \
-        BOOST_PP_SEQ_ELEM(N, BOOST_PP_SEQ_ELEM(0, DATA)), \
-        BOOST_PP_INC(N), \
-        BOOST_PP_CAT(offset_arg, N) \
-        + GET_TYPE_SIZE(BOOST_PP_SEQ_ELEM(N, BOOST_PP_SEQ_ELEM(0, DATA)), N) \
-    )
+        static bool decode(realloc_ptr<unsigned char> const & buffer,
+                           size_t & offset, size_t const length,
+                           value_type & value)
+        {
+            if (! decode_array_length(buffer, offset, length,
+                                      sizeof(char), value.length))
+                return false;
+            value.pchar = reinterpret_cast<char *>(&buffer[offset]);
+            offset += value.length;
+            return true;
+        }
+    };
 
-#define CREATE_FUNCTION_ARGUMENTS(Z, N, DATA) \
-    GET_FUNCTION_ARGUMENT(\
-        BOOST_PP_SEQ_ELEM(N, BOOST_PP_SEQ_ELEM(0, DATA)), \
-        BOOST_PP_CAT(offset_arg, N) \
-    )
+    class argument_puint32_len
+    {
+    public:
+        struct value_type
+        {
+            uint32_t * puint32;
+            uint32_t length;
+            std::vector<uint32_t> aligned;
+        };
+
+        static bool decode(realloc_ptr<unsigned char> const & buffer,
+                           size_t & offset, size_t const length,
+                           value_type & value)
+        {
+            if (! decode_array_length(buffer, offset, length,
+                                      sizeof(uint32_t), value.length))
+                return false;
+            unsigned char * const p = &buffer[offset];
+            if (reinterpret_cast<uintptr_t>(p) % sizeof(uint32_t) == 0)
+            {
+                value.puint32 = reinterpret_cast<uint32_t *>(p);
+            }
+            else
+            {
+                // only copy the array if it is not already aligned
+                value.aligned.resize(value.length + 1);
+                memcpy(&(value.aligned[0]), p,
+                       value.length * sizeof(uint32_t));
+                value.puint32 = &(value.aligned[0]);
+            }
+            offset += value.length * sizeof(uint32_t);
+            return true;
+        }
+    };
 
-#define CREATE_FUNCTION(I, OFFSETS, FUNCTION) \
-case BOOST_PP_DEC(I):\
-{\
-    BOOST_PP_IF(\
-        GET_ARGC(FUNCTION),\
-        size_t const offset_arg0 = BOOST_PP_SEQ_ELEM(0, OFFSETS);, \
-        BOOST_PP_EMPTY() \
-    )\
-    BOOST_PP_REPEAT_FROM_TO( \
-        0, \
-        BOOST_PP_DEC(GET_ARGC(FUNCTION)), \
-        STORE_FUNCTION_ARGUMENTS, \
-        (BOOST_PP_TUPLE_TO_SEQ(GET_ARGC(FUNCTION), GET_ARGV(FUNCTION)))\
-        (BOOST_PP_SEQ_ELEM(0, OFFSETS)) \
-    ) \
-    CREATE_FUNCTION_RETURN_VALUE_STORE(GET_RETURN(FUNCTION)) \
-    GET_NAME(FUNCTION) \
-    BOOST_PP_LPAREN() \
-    BOOST_PP_ENUM( \
-        GET_ARGC(FUNCTION), \
-        CREATE_FUNCTION_ARGUMENTS, \
-        (BOOST_PP_TUPLE_TO_SEQ(GET_ARGC(FUNCTION), GET_ARGV(FUNCTION)))\
-        (BOOST_PP_SEQ_ELEM(0, OFFSETS)) \
-    ) \
-    BOOST_PP_RPAREN() \
-    ; \
-    int index = BOOST_PP_SEQ_ELEM(1, OFFSETS); \
-    STORE_RETURN_VALUE(GET_RETURN(FUNCTION), BOOST_PP_DEC(I)) \
-    if ((status = write_cmd(buffer, index - BOOST_PP_SEQ_ELEM(1, OFFSETS)))) \
-        return status; \
-    return GEPD::ExitStatus::success;\
-}
+    // return value encoding
+
+    template <typename VALUE, typename ENCODE,
+              int (*F)(char *, int *, ENCODE)>
+    class return_value
+    {
+    public:
+        typedef VALUE value_type;
+
+        static int encode(realloc_ptr<unsigned char> & buffer, int & index,
+                          value_type const value)
+        {
+            if (F(buffer.get<char>(), &index, static_cast<ENCODE>(value)))
+                return GEPD::ExitStatus::ei_encode_error;
+            return GEPD::ExitStatus::success;
+        }
+    };
+
+    typedef return_value<char, long, ei_encode_long>            return_char;
+    typedef return_value<unsigned char, char, ei_encode_char>   return_uchar;
+    typedef return_value<bool, int, ei_encode_boolean>          return_bool;
+    typedef return_value<int8_t, long, ei_encode_long>          return_int8_t;
+    typedef return_value<uint8_t, unsigned long,
+                         ei_encode_ulong>                       return_uint8_t;
+    typedef return_value<int16_t, long, ei_encode_long>         return_int16_t;
+    typedef return_value<uint16_t, unsigned long,
+                         ei_encode_ulong>                       return_uint16_t;
+    typedef return_value<int32_t, long, ei_encode_long>         return_int32_t;
+    typedef return_value<uint32_t, unsigned long,
+                         ei_encode_ulong>                       return_uint32_t;
+    typedef return_value<int64_t, long long,
+                         ei_encode_longlong>                    return_int64_t;
+    typedef return_value<uint64_t, unsigned long long,
+                         ei_encode_ulonglong>                   return_uint64_t;
+    typedef return_value<uint64_t, unsigned long long,
+                         ei_encode_ulonglong>                   return_time_t;
+    typedef return_value<double, double, ei_encode_double>      return_float;
+    typedef return_value<double, double, ei_encode_double>      return_double;
+
+    class return_pchar
+    {
+    public:
+        typedef char const * value_type;
+
+        static int encode(realloc_ptr<unsigned char> & buffer, int & index,
+                          value_type const value)
+        {
+            // determine the encoded size, since a long string
+            // is encoded as a list
+            int size = index;
+            if (ei_encode_string(0, &size, value))
+                return GEPD::ExitStatus::ei_encode_error;
+            if (buffer.reserve(size) == false)
+                return GEPD::ExitStatus::write_overflow;
+            if (ei_encode_string(buffer.get<char>(), &index, value))
+                return GEPD::ExitStatus::ei_encode_error;
+            return GEPD::ExitStatus::success;
+        }
+    };
+
+    int reply_header(char * const header, int & index, call_id const & call)
+    {
+        if (ei_encode_version(header, &index))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (ei_encode_tuple_header(header, &index, call.async ? 3 : 2))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (ei_encode_ulong(header, &index, call.cmd))
+            return GEPD::ExitStatus::ei_encode_error;
+        if (call.async && ei_encode_ulong(header, &index, call.id))
+            return GEPD::ExitStatus::ei_encode_error;
+        return GEPD::ExitStatus::success;
+    }
+
+    // reply_ok and reply_binary are inline, since a port may have no
+    // function that uses them
+    inline int reply_ok(realloc_ptr<unsigned char> & buffer,
+                        call_id const & call)
+    {
+        int status;
+        int index = sizeof(OUTPUT_PREFIX_TYPE);
+        if ((status = reply_header(buffer.get<char>(), index, call)))
+            return status;
+        if (ei_encode_atom(buffer.get<char>(), &index, "ok"))
+            return GEPD::ExitStatus::ei_encode_error;
+        return write_cmd(buffer, index - sizeof(OUTPUT_PREFIX_TYPE));
+    }
+
+    template <typename R>
+    int reply_value(realloc_ptr<unsigned char> & buffer, call_id const & call,
+                    typename R::value_type const value)
+    {
+        int status;
+        int index = sizeof(OUTPUT_PREFIX_TYPE);
+        if ((status = reply_header(buffer.get<char>(), index, call)))
+            return status;
+        if ((status = R::encode(buffer, index, value)))
+            return status;
+        return write_cmd(buffer, index - sizeof(OUTPUT_PREFIX_TYPE));
+    }
+
+    // the binary is written directly from the function's memory
+    // with the Erlang binary term header (ERL_BINARY_EXT) separate
+    // (the header is not stored in the buffer because the binary
+    //  may reference the buffer, if it was provided as an argument)
+    inline int reply_binary(call_id const & call, char const * const pchar,
+                            uint32_t const length)
+    {
+        int status;
+        unsigned char header[32];
+        int index = sizeof(OUTPUT_PREFIX_TYPE);
+        if ((status = reply_header(reinterpret_cast<char *>(header),
+                                   index, call)))
+            return status;
+        header[index++] = ERL_BINARY_EXT;
+        header[index++] = (length & 0xff000000) >> 24;
+        header[index++] = (length & 0x00ff0000) >> 16;
+        header[index++] = (length & 0x0000ff00) >> 8;
+        header[index++] =  length & 0x000000ff;
+        return write_cmd_vector(header, index,
+                                reinterpret_cast<unsigned char const *>(pchar),
+                                length);
+    }
+
+    typedef int (*call_function_t)(realloc_ptr<unsigned char> & buffer,
+                                   size_t const length,
+                                   call_id const & call, size_t offset);
+
+#if PORT_ASYNC
+    // an asynchronous function call, with a copy of the request
+    // (the Erlang buffer is reused for the next request)
+    class async_call
+    {
+    public:
+        async_call(call_function_t const f, call_id const & call,
+                   realloc_ptr<unsigned char> const & buffer,
+                   size_t const length, size_t const offset) :
+            m_f(f),
+            m_call(call),
+            m_length(length),
+            m_offset(offset),
+            m_buffer(length < 1024 ? 1024 : length + 1,
+                     GEPD::buffer_size_max)
+        {
+            memcpy(m_buffer.get(), buffer.get(), length);
+        }
+
+        int run()
+        {
+            return (*m_f)(m_buffer, m_length, m_call, m_offset);
+        }
+
+    private:
+        call_function_t const m_f;
+        call_id const m_call;
+        size_t const m_length;
+        size_t const m_offset;
+        realloc_ptr<unsigned char> m_buffer;
+    };
+
+    class async_pool
+    {
+    public:
+        void start(size_t const count)
+        {
+            for (size_t i = 0; i < count; ++i)
+                m_threads.create_thread(boost::bind(&async_pool::run, this));
+        }
+
+        void push(async_call * const f)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_calls.push_back(f);
+            m_condition.notify_one();
+        }
+
+    private:
+        void run()
+        {
+            while (true)
+            {
+                async_call * f;
+                {
+                    boost::mutex::scoped_lock lock(m_mutex);
+                    while (m_calls.empty())
+                        m_condition.wait(lock);
+                    f = m_calls.front();
+                    m_calls.pop_front();
+                }
+                int const status = f->run();
+                delete f;
+                // a failed reply is fatal, as it is with the
+                // synchronous function calls in GEPD::wait
+                if (status)
+                    ::_exit(status);
+            }
+        }
+
+        boost::mutex m_mutex;
+        boost::condition_variable m_condition;
+        std::deque<async_call *> m_calls;
+        boost::thread_group m_threads;
+    };
+
+    // never deleted, so the threads are never left waiting on a
+    // destroyed condition variable during exit
+    async_pool * async_threads = 0;
+
+    int call_async(call_function_t const f, uint16_t const cmd,
+                   realloc_ptr<unsigned char> & buffer, uint32_t const length)
+    {
+        size_t const offset = sizeof(INPUT_PREFIX_TYPE) +
+                              sizeof(ASYNC_ID_TYPE);
+        call_id call = {cmd, true, 0};
+        if (length < offset)
+        {
+            // Erlang only matches an asynchronous reply, so the error
+            // uses whatever part of the id was received
+            memcpy(&call.id, &buffer[sizeof(INPUT_PREFIX_TYPE)],
+                   length - sizeof(INPUT_PREFIX_TYPE));
+            return reply_error(buffer, call, Error::invalid_arguments);
+        }
+        memcpy(&call.id, &buffer[sizeof(INPUT_PREFIX_TYPE)],
+               sizeof(ASYNC_ID_TYPE));
+        async_threads->push(new async_call(f, call, buffer, length, offset));
+        return GEPD::ExitStatus::success;
+    }
+#endif
+
+#define CALL_FUNCTION_ARGUMENT(Z, N, ARGV) \
+    BOOST_PP_CAT(FUNCTION_ARGUMENT_FROM_TYPE_, BOOST_PP_SEQ_ELEM(N, ARGV))(N)
+
+#define CALL_FUNCTION_ARGUMENTS(ARGC, ARGV) \
+    BOOST_PP_ENUM(ARGC, CALL_FUNCTION_ARGUMENT, ARGV)
+
+#define CALL_FUNCTION_VOID(NAME, RETURN, ARGC, ARGV, ASYNC) \
+    NAME(CALL_FUNCTION_ARGUMENTS(ARGC, ARGV)); \
+    return reply_ok(buffer, call);
+
+#define CALL_FUNCTION_VALUE(NAME, RETURN, ARGC, ARGV, ASYNC) \
+    return reply_value< BOOST_PP_CAT(return_, RETURN) >(buffer, call, \
+        NAME(CALL_FUNCTION_ARGUMENTS(ARGC, ARGV)));
+
+#define CALL_FUNCTION_BINARY(NAME, RETURN, ARGC, ARGV, ASYNC) \
+    BOOST_PP_IF(ASYNC, \
+                CALL_FUNCTION_BINARY_COPY, \
+                CALL_FUNCTION_BINARY_DIRECT)(NAME, ARGC, ARGV)
+
+#define CALL_FUNCTION_BINARY_DIRECT(NAME, ARGC, ARGV) \
+    char const * returnValue = 0; \
+    uint32_t returnLength = 0; \
+    NAME(CALL_FUNCTION_ARGUMENTS(ARGC, ARGV) BOOST_PP_COMMA_IF(ARGC) \
+         &returnValue, &returnLength); \
+    return reply_binary(call, returnValue, returnLength);
+
+// the binary of an asynchronous function call is copied before another
+// thread may call the function again (the mutex is never deleted,
+// like write_mutex)
+#define CALL_FUNCTION_BINARY_COPY(NAME, ARGC, ARGV) \
+    static boost::mutex * const returnMutex = new boost::mutex(); \
+    std::vector<char> returnCopy; \
+    { \
+        boost::mutex::scoped_lock returnLock(*returnMutex); \
+        char const * returnValue = 0; \
+        uint32_t returnLength = 0; \
+        NAME(CALL_FUNCTION_ARGUMENTS(ARGC, ARGV) BOOST_PP_COMMA_IF(ARGC) \
+             &returnValue, &returnLength); \
+        returnCopy.assign(returnValue, returnValue + returnLength); \
+    } \
+    return reply_binary(call, \
+                        returnCopy.empty() ? 0 : &(returnCopy[0]), \
+                        returnCopy.size());
+
+#define DECODE_FUNCTION_ARGUMENT(Z, N, ARGV) \
+    BOOST_PP_CAT(argument_, BOOST_PP_SEQ_ELEM(N, ARGV))::value_type \
+        BOOST_PP_CAT(arg, N); \
+    if (! BOOST_PP_CAT(argument_, BOOST_PP_SEQ_ELEM(N, ARGV))::decode( \
+            buffer, offset, length, BOOST_PP_CAT(arg, N))) \
+        return reply_error(buffer, call, Error::invalid_arguments);
+
+#define CREATE_FUNCTION_CALL(I, FUNCTION) \
+    int BOOST_PP_CAT(call_function_, I)(realloc_ptr<unsigned char> & buffer, \
+                                        size_t const length, \
+                                        call_id const & call, size_t offset) \
+    { \
+        BOOST_PP_REPEAT( \
+            GET_ARGC(FUNCTION), \
+            DECODE_FUNCTION_ARGUMENT, \
+            BOOST_PP_TUPLE_TO_SEQ(GET_ARGC(FUNCTION), GET_ARGV(FUNCTION)) \
+        ) \
+        if (offset != length) \
+            return reply_error(buffer, call, Error::invalid_arguments); \
+        BOOST_PP_CAT(CALL_FUNCTION_FROM_TYPE_, GET_RETURN(FUNCTION))( \
+            GET_NAME(FUNCTION), \
+            GET_RETURN(FUNCTION), \
+            GET_ARGC(FUNCTION), \
+            BOOST_PP_TUPLE_TO_SEQ(GET_ARGC(FUNCTION), GET_ARGV(FUNCTION)), \
+            GET_ASYNC(FUNCTION) \
+        ) \
+    }
+
+#define CREATE_FUNCTION_SYNC(I) \
+    int BOOST_PP_CAT(port_function_, I)(realloc_ptr<unsigned char> & buffer, \
+                                        uint32_t const length) \
+    { \
+        call_id const call = {BOOST_PP_INC(I), false, 0}; \
+        return BOOST_PP_CAT(call_function_, I)(buffer, length, call, \
+                                               sizeof(INPUT_PREFIX_TYPE)); \
+    }
+
+#define CREATE_FUNCTION_ASYNC(I) \
+    int BOOST_PP_CAT(port_function_, I)(realloc_ptr<unsigned char> & buffer, \
+                                        uint32_t const length) \
+    { \
+        return call_async(BOOST_PP_CAT(call_function_, I), \
+                          BOOST_PP_INC(I), buffer, length); \
+    }
+
+#define CREATE_FUNCTION(R, DATA, I, FUNCTION) \
+    CREATE_FUNCTION_CALL(I, FUNCTION) \
+    BOOST_PP_IF(GET_ASYNC(FUNCTION), \
+                CREATE_FUNCTION_ASYNC, \
+                CREATE_FUNCTION_SYNC)(I)
+
+#define CREATE_FUNCTION_TABLE_ENTRY(R, DATA, I, FUNCTION) \
+    BOOST_PP_COMMA_IF(I) BOOST_PP_CAT(port_function_, I)
+
+    BOOST_PP_SEQ_FOR_EACH_I(CREATE_FUNCTION, _, PORT_FUNCTIONS_SEQUENCE)
+
+    // dispatch table, indexed by (cmd - 1)
+    typedef int (*port_function_t)(realloc_ptr<unsigned char> & buffer,
+                                   uint32_t const length);
+    port_function_t const port_functions[] =
+    {
+        BOOST_PP_SEQ_FOR_EACH_I(CREATE_FUNCTION_TABLE_ENTRY, _,
+                                PORT_FUNCTIONS_SEQUENCE)
+    };
+    size_t const port_functions_count =
+        sizeof(port_functions) / sizeof(port_functions[0]);
+    BOOST_STATIC_ASSERT(sizeof(port_functions) / sizeof(port_functions[0]) ==
+                        BOOST_PP_SEQ_SIZE(PORT_FUNCTIONS_SEQUENCE));
 
     int consume_erlang(short & revents, realloc_ptr<unsigned char> & buffer)
     {
@@ -706,31 +1015,15 @@ case BOOST_PP_DEC(I):\
             return GEPD::ExitStatus::poll_NVAL;
         revents = 0;
         int status;
-        if ((status = read_cmd(buffer)))
-        {
+        uint32_t length;
+        if ((status = read_cmd(buffer, length)))
             return status;
-        }
-        else
-        {
-            INPUT_PREFIX_TYPE cmd = *((INPUT_PREFIX_TYPE *) buffer.get());
-            switch (cmd)
-            {
-                BOOST_PP_SEQ_FOR_EACH(CREATE_FUNCTION,
-                                      (sizeof(INPUT_PREFIX_TYPE))
-                                      (sizeof(OUTPUT_PREFIX_TYPE)),
-                                      PORT_FUNCTIONS)
-    
-                default:
-                    int index = sizeof(OUTPUT_PREFIX_TYPE);
-                    if ((status = reply_error_string(buffer, index, cmd, 
-                                                     Error::invalid_function)))
-                        return status;
-                    if ((status = write_cmd(buffer, index -
-                                            sizeof(OUTPUT_PREFIX_TYPE))))
-                        return status;
-                    return GEPD::ExitStatus::success;
-            }
-        }
+        call_id call = {0, false, 0};
+        if (length >= sizeof(INPUT_PREFIX_TYPE))
+            memcpy(&call.cmd, buffer.get(), sizeof(INPUT_PREFIX_TYPE));
+        if (call.cmd == 0 || call.cmd > port_functions_count)
+            return reply_error(buffer, call, Error::invalid_function);
+        return (*port_functions[call.cmd - 1])(buffer, length);
     }
 
     int store_standard_fd(int in, int & out)
@@ -806,6 +1099,12 @@ int GEPD::consume_stream(int fd, short & revents,
             iNewline = j;
         }
     }
+    if (! foundNewline && i == stream.size())
+    {
+        // a line longer than the maximum stream size is sent in chunks
+        foundNewline = true;
+        iNewline = i - 1;
+    }
 
     if (foundNewline)
     {
@@ -899,13 +1198,15 @@ nfds_t GEPD::nfds = 0;
 // (a linked-in Erlang port driver that makes synchronous calls with
 //  driver level locking should be similar to an Erlang port, except that
 //  the port driver is a VM process and the port is an OS process)
+// asynchronous function calls are only read by the main loop and
+// are then executed by the async thread pool, which writes the reply
 
 int GEPD::default_main()
 {
     int const timeout = -1; // milliseconds
     // use the option {packet, 4} for open_port/2
-    // (limited by 4MB buffer size below)
-    realloc_ptr<unsigned char> buffer(32768, 4194304);
+    realloc_ptr<unsigned char> buffer(GEPD::buffer_size_initial,
+                                      GEPD::buffer_size_max);
     realloc_ptr<unsigned char> stream1(1, 16384);
     realloc_ptr<unsigned char> stream2(1, 16384);
     int status;
@@ -933,6 +1234,13 @@ int GEPD::init()
     fds[INDEX_ERLANG].events = POLLIN | POLLPRI;
     fds[INDEX_ERLANG].revents = 0;
     nfds += 3;
+#if PORT_ASYNC
+    if (async_threads == 0)
+    {
+        async_threads = new async_pool();
+        async_threads->start(PORT_ASYNC_THREADS);
+    }
+#endif
     return GEPD::ExitStatus::success;
 }
 
@@ -951,6 +1259,8 @@ int GEPD::wait(int & count, int const timeout,
         {
             if ((status = consume_erlang(fds[INDEX_ERLANG].revents, buffer)))
                 return status;
+            if (buffer.size() > GEPD::buffer_size_retained)
+                buffer.shrink();
             --count;
         }
         fflush(stdout);
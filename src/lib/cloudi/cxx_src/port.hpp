@@ -109,6 +109,13 @@ namespace GEPD
         int const error_HUP         = poll_HUP;
     }
 
+    // Erlang buffer sizes, for messages with the {packet, 4} option
+    // (the buffer grows to fit each message, up to the maximum size,
+    //  and is shrunk after any message larger than the retained size)
+    size_t const buffer_size_initial = 32768;
+    size_t const buffer_size_retained = 4194304;
+    size_t const buffer_size_max = 2147483648U;
+
     int consume_stream(int fd, short & revents,
                        char const * const name, unsigned long const pid,
                        realloc_ptr<unsigned char> & send_buffer,
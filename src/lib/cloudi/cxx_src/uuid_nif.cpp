@@ -0,0 +1,170 @@
+// -*- coding: utf-8; Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*-
+// ex: set softtabstop=4 tabstop=4 shiftwidth=4 expandtab fileencoding=utf-8:
+//
+// BSD LICENSE
+// 
+// Copyright (c) 2012, Michael Truog <mjtruog at gmail dot com>
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in
+//       the documentation and/or other materials provided with the
+//       distribution.
+//     * All advertising materials mentioning features or use of this
+//       software must display the following acknowledgment:
+//         This product includes software developed by Michael Truog
+//     * The name of the author may not be used to endorse or promote
+//       products derived from this software without specific prior
+//       written permission
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+// NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+// DAMAGE.
+//
+
+extern "C"
+{
+#include <erl_nif.h>
+}
+#include <sys/time.h>
+#include <cstring>
+
+// version 1 UUID generation for the uuid module
+// (see uuid.erl for the layout of the UUID),
+// replacing uuid:get_v1/1 when the shared library is loaded
+
+namespace
+{
+    struct generator
+    {
+        // time of the last UUID generated in microseconds since the epoch,
+        // only updated with compare-and-swap so that a generator may be
+        // shared by any number of Erlang processes
+        ErlNifUInt64 volatile last_time;
+        // UUID bytes 8 - 15 (clock sequence, reserved bits and node id)
+        unsigned char clock_seq_and_node_id[8];
+    };
+
+    ErlNifResourceType * generator_type = 0;
+
+    ErlNifUInt64 next_time(generator * g)
+    {
+        struct timeval tv;
+        ::gettimeofday(&tv, 0);
+        ErlNifUInt64 const now =
+            static_cast<ErlNifUInt64>(tv.tv_sec) * 1000000 + tv.tv_usec;
+
+        // the time is strictly increasing, running ahead of the clock
+        // if UUIDs are requested faster than once per microsecond
+        ErlNifUInt64 old = g->last_time;
+        while (true)
+        {
+            ErlNifUInt64 const time = (now > old) ? now : old + 1;
+            ErlNifUInt64 const previous =
+                __sync_val_compare_and_swap(&g->last_time, old, time);
+            if (previous == old)
+                return time;
+            old = previous;
+        }
+    }
+
+    int open_generator_type(ErlNifEnv * env, ErlNifResourceFlags flags)
+    {
+        generator_type = ::enif_open_resource_type(env, 0, "uuid_generator",
+                                                   0, flags, 0);
+        return (generator_type == 0) ? -1 : 0;
+    }
+}
+
+extern "C"
+{
+
+static ERL_NIF_TERM nif_loaded(ErlNifEnv * env, int,
+                               ERL_NIF_TERM const *)
+{
+    return ::enif_make_atom(env, "true");
+}
+
+static ERL_NIF_TERM nif_new(ErlNifEnv * env, int,
+                            ERL_NIF_TERM const * argv)
+{
+    ErlNifBinary clock_seq_and_node_id;
+    if (! ::enif_inspect_binary(env, argv[0], &clock_seq_and_node_id) ||
+        clock_seq_and_node_id.size != 8)
+        return ::enif_make_badarg(env);
+    generator * g = reinterpret_cast<generator *>(
+        ::enif_alloc_resource(generator_type, sizeof(generator)));
+    g->last_time = 0;
+    ::memcpy(g->clock_seq_and_node_id, clock_seq_and_node_id.data, 8);
+    ERL_NIF_TERM const result = ::enif_make_resource(env, g);
+    ::enif_release_resource(g);
+    return result;
+}
+
+static ERL_NIF_TERM nif_get_v1(ErlNifEnv * env, int,
+                               ERL_NIF_TERM const * argv)
+{
+    void * resource;
+    if (! ::enif_get_resource(env, argv[0], generator_type, &resource))
+        return ::enif_make_badarg(env);
+    generator * g = reinterpret_cast<generator *>(resource);
+    ErlNifUInt64 const time = next_time(g);
+
+    // the same bytes as
+    // <<TimeHigh:12/little, TimeMid:16/little, TimeLow:32/little>> =
+    //     <<Time:60>>,
+    // <<TimeLow:32, TimeMid:16, TimeHigh:12, 0:1, 0:1, 0:1, 1:1, ...>>
+    unsigned int const low = static_cast<unsigned int>(time & 0xffffffff);
+    unsigned int const mid = static_cast<unsigned int>((time >> 32) & 0xffff);
+    unsigned int const high = static_cast<unsigned int>((time >> 48) & 0xfff);
+    ERL_NIF_TERM result;
+    unsigned char * uuid = ::enif_make_new_binary(env, 16, &result);
+    uuid[0] = low & 0xff;
+    uuid[1] = (low >> 8) & 0xff;
+    uuid[2] = (low >> 16) & 0xff;
+    uuid[3] = (low >> 24) & 0xff;
+    uuid[4] = mid & 0xff;
+    uuid[5] = (mid >> 8) & 0xff;
+    uuid[6] = ((high & 0xf) << 4) | ((high >> 8) & 0xf);
+    uuid[7] = (((high >> 4) & 0xf) << 4) | 0x1; // version 1 bits
+    ::memcpy(&uuid[8], g->clock_seq_and_node_id, 8);
+    return result;
+}
+
+static int on_load(ErlNifEnv * env, void **, ERL_NIF_TERM)
+{
+    return open_generator_type(env, ERL_NIF_RT_CREATE);
+}
+
+static int on_upgrade(ErlNifEnv * env, void **, void **, ERL_NIF_TERM)
+{
+    return open_generator_type(env, static_cast<ErlNifResourceFlags>(
+        ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER));
+}
+
+static ErlNifFunc nif_funcs[] =
+{
+    {"nif_loaded", 0, nif_loaded},
+    {"nif_new", 1, nif_new},
+    {"nif_get_v1", 1, nif_get_v1}
+};
+
+ERL_NIF_INIT(uuid, nif_funcs, on_load, 0, on_upgrade, 0)
+
+}
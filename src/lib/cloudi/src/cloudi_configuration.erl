@@ -469,6 +469,9 @@ jobs_validate(Output, [Job | L], UUID)
            (Job#internal.dest_list_allow == undefined),
     true = Job#internal.max_r >= 0,
     true = Job#internal.max_t >= 0,
+    Options = jobs_validate_options(Job#internal.options),
+    % warm OS processes only exist for external jobs
+    true = Options#config_job_options.warm_pool == 0,
     C = #config_job_internal{prefix = Job#internal.prefix,
                              module = Job#internal.module,
                              args = Job#internal.args,
@@ -481,9 +484,7 @@ jobs_validate(Output, [Job | L], UUID)
                              count_process = Job#internal.count_process,
                              max_r = Job#internal.max_r,
                              max_t = Job#internal.max_t,
-                             options = jobs_validate_options(
-                                 Job#internal.options
-                             ),
+                             options = Options,
                              uuid = uuid:get_v1(UUID)},
     jobs_validate([C | Output], L, UUID);
 jobs_validate(Output, [Job | L], UUID)
@@ -525,6 +526,7 @@ jobs_validate(Output, [Job | L], UUID)
            (Job#external.dest_list_allow == undefined),
     true = Job#external.max_r >= 0,
     true = Job#external.max_t >= 0,
+    Options = jobs_validate_options(Job#external.options),
     C = #config_job_external{prefix = Job#external.prefix,
                              file_path = Job#external.file_path,
                              args = Job#external.args,
@@ -541,9 +543,7 @@ jobs_validate(Output, [Job | L], UUID)
                              count_thread = Job#external.count_thread,
                              max_r = Job#external.max_r,
                              max_t = Job#external.max_t,
-                             options = jobs_validate_options(
-                                 Job#external.options
-                             ),
+                             options = Options,
                              uuid = uuid:get_v1(UUID)},
     jobs_validate([C | Output], L, UUID).
 
@@ -553,18 +553,48 @@ jobs_validate_options(OptionsList) ->
         {priority_default,     Options#config_job_options.priority_default},
         {queue_limit,          Options#config_job_options.queue_limit},
         {dest_refresh_start,   Options#config_job_options.dest_refresh_start},
-        {dest_refresh_delay,   Options#config_job_options.dest_refresh_delay}],
-    [PriorityDefault, QueueLimit, DestRefreshStart, DestRefreshDelay] =
+        {dest_refresh_delay,   Options#config_job_options.dest_refresh_delay},
+        {cpu_affinity,         Options#config_job_options.cpu_affinity},
+        {numa_node,            Options#config_job_options.numa_node},
+        {cgroup,               Options#config_job_options.cgroup},
+        {cgroup_cpu_quota,     Options#config_job_options.cgroup_cpu_quota},
+        {warm_pool,            Options#config_job_options.warm_pool}],
+    [PriorityDefault, QueueLimit, DestRefreshStart, DestRefreshDelay,
+     CpuAffinity, NumaNode, Cgroup, CgroupCpuQuota, WarmPool] =
         cloudi_proplists:take_values(Defaults, OptionsList),
     true = (PriorityDefault >= ?PRIORITY_HIGH) and
            (PriorityDefault =< ?PRIORITY_LOW),
     true = (QueueLimit =:= undefined) orelse is_integer(QueueLimit),
     true = is_integer(DestRefreshStart),
     true = is_integer(DestRefreshDelay),
+    true = (CpuAffinity =:= undefined) orelse
+           (is_list(CpuAffinity) andalso
+            lists:all(fun(Cpu) ->
+                is_integer(Cpu) andalso (Cpu >= 0)
+            end, CpuAffinity)),
+    true = (NumaNode =:= undefined) orelse
+           (is_integer(NumaNode) andalso (NumaNode >= 0)),
+    true = (Cgroup =:= undefined) orelse
+           (is_list(Cgroup) andalso (Cgroup /= [])),
+    true = (CgroupCpuQuota =:= undefined) orelse
+           (is_list(Cgroup) andalso
+            case CgroupCpuQuota of
+                {Quota, Period} when is_integer(Quota), Quota > 0,
+                                     is_integer(Period), Period > 0 ->
+                    true;
+                _ ->
+                    false
+            end),
+    true = is_integer(WarmPool) andalso (WarmPool >= 0),
     Options#config_job_options{priority_default = PriorityDefault,
                                queue_limit = QueueLimit,
                                dest_refresh_start = DestRefreshStart,
-                               dest_refresh_delay = DestRefreshDelay}.
+                               dest_refresh_delay = DestRefreshDelay,
+                               cpu_affinity = CpuAffinity,
+                               numa_node = NumaNode,
+                               cgroup = Cgroup,
+                               cgroup_cpu_quota = CgroupCpuQuota,
+                               warm_pool = WarmPool}.
 
 acl_lookup_new(L) ->
     acl_lookup_add(L, dict:new()).
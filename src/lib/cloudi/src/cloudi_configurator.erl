@@ -334,6 +334,22 @@ job_stop_external(Job)
             ?LOG_ERROR("error stopping external job (~p):~n ~p",
                        [Job#config_job_external.file_path, Reason]),
             ok
+    end,
+    case cloudi_spawn:stop_external(concurrency(
+                                        Job#config_job_external.count_thread
+                                    ),
+                                    Job#config_job_external.file_path,
+                                    Job#config_job_external.args,
+                                    Job#config_job_external.env,
+                                    Job#config_job_external.protocol,
+                                    Job#config_job_external.buffer_size,
+                                    Job#config_job_external.options) of
+        ok ->
+            ok;
+        {error, WarmReason} ->
+            ?LOG_ERROR("error stopping warm OS processes (~p):~n ~p",
+                       [Job#config_job_external.file_path, WarmReason]),
+            ok
     end.
 
 job_restart_internal(Job)
@@ -91,9 +91,11 @@ cloudi_job_init(Args, Prefix, Dispatcher) ->
     {RequestL, L3} = cloudi_proplists:partition(outbound, L2),
     {ReplyL, L4} = cloudi_proplists:partition(inbound, L3),
     {PullL, L5} = cloudi_proplists:partition(pull, L4),
-    {PushL, []} = cloudi_proplists:partition(push, L5),
+    {PushL, L6} = cloudi_proplists:partition(push, L5),
+    % polling threads handle the blocking ZeroMQ socket operations
+    {PollingThreads, []} = cloudi_proplists:take_value(polling_threads, L6, 1),
 
-    {ok, Context} = erlzmq:context(),
+    {ok, Context} = erlzmq:context([{polling_threads, PollingThreads}]),
     ReceivesZMQ1 = dict:new(),
     Publish = lists:foldl(fun({publish,
                                {[{[I1a | _], [I1b | _]} | _] = NamePairL,
@@ -66,6 +66,7 @@
 
 -record(state, {last_port_name,
                 replies = [],
+                async_id = 0,
                 port = undefined}).
 
 %%%------------------------------------------------------------------------
@@ -100,6 +101,23 @@ handle_call({call, Command, Msg}, Client,
             {reply, Error, State}
     end;
 
+%% handle asynchronous function calls on the port
+%% (executed by a thread pool, so the reply is matched with an id)
+handle_call({call_async, Command, [CommandBinary | Args]}, Client,
+            #state{port = Port,
+                   replies = Replies,
+                   async_id = Id} = State)
+    when is_port(Port) ->
+    case call_port(Port, [CommandBinary,
+                          <<Id:32/unsigned-integer-native>> | Args]) of
+        ok ->
+            {noreply, State#state{replies = [{{Command, Id}, Client} |
+                                             Replies],
+                                  async_id = (Id + 1) band 16#ffffffff}};
+        {error, _} = Error ->
+            {reply, Error, State}
+    end;
+
 handle_call(Request, _, State) ->
     ?LOG_ERROR("Unknown call \"~p\"~n", [Request]),
     {stop, "Unknown call", State}.
@@ -147,6 +165,15 @@ handle_info({Port, {data, Data}},
                     gen_server:reply(Client, {error, Reason}),
                     {noreply, State#state{replies = NewReplies}}
             end;
+        {error, Command, Id, Reason} ->
+            case lists:keytake({Command, Id}, 1, Replies) of
+                false ->
+                    catch erlang:port_close(Port),
+                    {stop, "invalid reply", State#state{port = undefined}};
+                {value, {_, Client}, NewReplies} ->
+                    gen_server:reply(Client, {error, Reason}),
+                    {noreply, State#state{replies = NewReplies}}
+            end;
         {Stream, OsPid, Output} when Stream == stdout; Stream == stderr ->
             FormattedOutput = lists:flatmap(fun(Line) ->
                 io_lib:format(" ~s~n", [Line])
@@ -160,6 +187,15 @@ handle_info({Port, {data, Data}},
                               [OsPid, FormattedOutput])
             end,
             {noreply, State};
+        {Command, Id, Success} when is_integer(Command) ->
+            case lists:keytake({Command, Id}, 1, Replies) of
+                false ->
+                    catch erlang:port_close(Port),
+                    {stop, "invalid reply", State#state{port = undefined}};
+                {value, {_, Client}, NewReplies} ->
+                    gen_server:reply(Client, {ok, Success}),
+                    {noreply, State#state{replies = NewReplies}}
+            end;
         {Command, Success} ->
             case lists:keytake(Command, 1, Replies) of
                 false ->
@@ -319,8 +355,7 @@ load_local_port(Name) when is_list(Name) ->
     end.
 transform_data(D) ->
     D.
-%% only a port driver can perform asynchronous function calls
-%% (you might be able to put a thread pool in an Erlang port, but why bother?)
+%% a port driver performs asynchronous function calls with the async pool
 call_port_async(Process, Command, Msg)
     when is_integer(Command), is_list(Msg) ->
     gen_server:cast(Process, {call, Command, Msg}).
@@ -338,8 +373,16 @@ load_local_port(Name) when is_list(Name) ->
                      [{packet, 4}, binary, exit_status, nouse_stdio]).
 transform_data(D) ->
     erlang:binary_to_term(D).
-%call_port_async(Process, Command, Msg) ->
-%    call_port_sync(Process, Command, Msg).
+-ifdef(ERL_PORT_ASYNC).
+%% a port performs asynchronous function calls with a thread pool
+call_port_async(Process, Command, Msg)
+    when is_integer(Command), is_list(Msg) ->
+    try gen_server:call(Process, {call_async, Command, Msg})
+    catch
+        _:Reason ->
+            {error, Reason}
+    end.
+-endif.
 -endif.
 -endif.
 
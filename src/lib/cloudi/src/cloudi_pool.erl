@@ -55,7 +55,8 @@
 
 %% external interface
 -export([start_link/3,
-         get/1]).
+         get/1,
+         get/2]).
 
 %% gen_server callbacks
 -export([init/1,
@@ -83,6 +84,12 @@ get(Name)
     when is_atom(Name) ->
     gen_server:call(Name, get).
 
+%% consistently get the same pool process for the same key
+%% (while the pool process remains alive)
+get(Name, Key)
+    when is_atom(Name) ->
+    gen_server:call(Name, {get, Key}).
+
 %%%------------------------------------------------------------------------
 %%% Callback functions from gen_server
 %%%------------------------------------------------------------------------
@@ -110,6 +117,23 @@ handle_call(get, _, #state{pool = Pool,
             end
     end;
 
+handle_call({get, Key}, _, #state{pool = Pool,
+                                  count = Count} = State) ->
+    I = erlang:phash2(Key, Count) + 1,
+    Pid = erlang:element(I, Pool),
+    case erlang:is_process_alive(Pid) of
+        true ->
+            {reply, Pid, State};
+        false ->
+            {NewI, NewState} = update(I, State),
+            if
+                NewState#state.count == 0 ->
+                    {stop, {error, noproc}, {error, noproc}, NewState};
+                true ->
+                    {reply, erlang:element(NewI, NewState#state.pool), NewState}
+            end
+    end;
+
 handle_call(Request, _, State) ->
     ?LOG_WARN("Unknown call \"~p\"", [Request]),
     {stop, cloudi_string:format("Unknown call \"~p\"", [Request]),
@@ -52,7 +52,8 @@
 
 %% external interface
 -export([start_internal/11,
-         start_external/14]).
+         start_external/14,
+         stop_external/7]).
 
 -include("cloudi_configuration.hrl").
 
@@ -149,25 +150,119 @@ start_external(ThreadsPerProcess,
             % an error occurred in cloudi_socket_sup:create_socket
             {error, Ports};
         true ->
-            SpawnProcess = cloudi_pool:get(cloudi_os_spawn),
+            SpawnProcess = if
+                ConfigOptions#config_job_options.warm_pool > 0 ->
+                    % warm OS processes are kept by a single os_spawn port
+                    cloudi_pool:get(cloudi_os_spawn,
+                                    {Filename, Arguments, Environment});
+                true ->
+                    cloudi_pool:get(cloudi_os_spawn)
+            end,
             ProtocolChar = if Protocol == tcp -> $t; Protocol == udp -> $u end,
-            case cloudi_os_spawn:spawn(SpawnProcess,
-                                       ProtocolChar,
-                                       Ports,
-                                       string_terminate(Filename),
-                                       arguments_parse(Arguments),
-                                       environment_format(NewEnvironment)) of
+            case os_spawn(SpawnProcess, ProtocolChar, Ports,
+                          string_terminate(Filename),
+                          arguments_parse(Arguments),
+                          environment_format(NewEnvironment),
+                          ConfigOptions) of
                 {ok, _} ->
                     {ok, Pids};
                 {error, _} = Error ->
+                    lists:foreach(fun(P) -> erlang:exit(P, kill) end, Pids),
                     Error
             end
     end.
 
+%% stop the warm OS processes kept for an external job that was removed
+stop_external(ThreadsPerProcess,
+              Filename, Arguments, Environment,
+              Protocol, BufferSize, ConfigOptions)
+    when is_integer(ThreadsPerProcess), ThreadsPerProcess > 0,
+         is_list(Filename), is_list(Arguments), is_list(Environment),
+         is_integer(BufferSize),
+         is_record(ConfigOptions, config_job_options) ->
+    true = (Protocol == tcp) or (Protocol == udp),
+    if
+        ConfigOptions#config_job_options.warm_pool > 0 ->
+            SpawnProcess = cloudi_pool:get(cloudi_os_spawn,
+                                           {Filename, Arguments, Environment}),
+            ProtocolChar = if Protocol == tcp -> $t; Protocol == udp -> $u end,
+            NewEnvironment = environment_update(Environment,
+                                                ThreadsPerProcess,
+                                                Protocol,
+                                                BufferSize),
+            {Cpus, Node, CgroupPath, Quota, Period} = placement(ConfigOptions),
+            case cloudi_os_spawn:spawn_warm_stop(SpawnProcess, ProtocolChar,
+                                                 ThreadsPerProcess,
+                                                 string_terminate(Filename),
+                                                 arguments_parse(Arguments),
+                                                 environment_format(
+                                                     NewEnvironment),
+                                                 Cpus, Node, CgroupPath,
+                                                 Quota, Period) of
+                {ok, _} ->
+                    ok;
+                {error, _} = Error ->
+                    Error
+            end;
+        true ->
+            ok
+    end.
+
 %%%------------------------------------------------------------------------
 %%% Private functions
 %%%------------------------------------------------------------------------
 
+os_spawn(SpawnProcess, ProtocolChar, Ports, Filename, Arguments, Environment,
+         #config_job_options{cpu_affinity = undefined,
+                             numa_node = undefined,
+                             cgroup = undefined,
+                             warm_pool = 0}) ->
+    cloudi_os_spawn:spawn(SpawnProcess, ProtocolChar, Ports,
+                          Filename, Arguments, Environment);
+os_spawn(SpawnProcess, ProtocolChar, Ports, Filename, Arguments, Environment,
+         #config_job_options{warm_pool = WarmPool} = ConfigOptions) ->
+    {Cpus, Node, CgroupPath, Quota, Period} = placement(ConfigOptions),
+    Result = if
+        WarmPool == 0 ->
+            cloudi_os_spawn:spawn_placed(SpawnProcess, ProtocolChar, Ports,
+                                         Filename, Arguments, Environment,
+                                         Cpus, Node, CgroupPath,
+                                         Quota, Period);
+        true ->
+            % a warm OS process that does not ask os_spawn for its sockets
+            % (a CloudI API without warm OS process support) is replaced
+            % by starting the OS process normally
+            cloudi_os_spawn:spawn_warm(SpawnProcess, ProtocolChar,
+                                       Ports, Filename, Arguments,
+                                       Environment,
+                                       Cpus, Node, CgroupPath,
+                                       Quota, Period, WarmPool)
+    end,
+    % a negative result is a placement error in the OS process
+    case Result of
+        {ok, Status} when Status < 0 ->
+            {error, {placement, Status}};
+        {ok, _} = Success ->
+            Success;
+        {error, _} = Error ->
+            Error
+    end.
+
+placement(#config_job_options{cpu_affinity = CpuAffinity,
+                               numa_node = NumaNode,
+                               cgroup = Cgroup,
+                               cgroup_cpu_quota = CgroupCpuQuota}) ->
+    Cpus = if CpuAffinity =:= undefined -> []; true -> CpuAffinity end,
+    Node = if NumaNode =:= undefined -> -1; true -> NumaNode end,
+    CgroupPath = if Cgroup =:= undefined -> [0]; true -> Cgroup ++ [0] end,
+    {Quota, Period} = if
+        CgroupCpuQuota =:= undefined ->
+            {0, 0};
+        true ->
+            CgroupCpuQuota
+    end,
+    {Cpus, Node, CgroupPath, Quota, Period}.
+
 string_terminate([_ | _] = L) ->
     L ++ [0].
 
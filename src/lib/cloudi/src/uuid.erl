@@ -15,6 +15,12 @@
 %%% The Erlang pid is bitwise-XORed from 72 bits down to 32 bits.
 %%% The version 3 (MD5), version 4 (random), and version 5 (SHA)
 %%% methods are provided as specified within the RFC.
+%%%
+%%% When the uuid_nif shared library is found in the cloudi priv directory,
+%%% version 1 UUIDs are created by a NIF instead.  The NIF takes the time
+%%% from the OS clock (for either timestamp type) and keeps it strictly
+%%% increasing per uuid_state without a lock, so a uuid_state may be
+%%% shared between processes.
 %%% @end
 %%%
 %%% BSD LICENSE
@@ -78,13 +84,16 @@
          string_to_uuid/1,
          increment/1]).
 
+-on_load(load_nif/0).
+
 -record(uuid_state,
     {
         node_id,
         clock_seq,
         clock_seq_high,
         clock_seq_low,
-        timestamp_type
+        timestamp_type,
+        generator % NIF resource or undefined
     }).
 
 %%%------------------------------------------------------------------------
@@ -140,18 +149,21 @@ new(Pid, TimestampType)
     PidByte4 = PidID4 bxor PidSR1,
     ClockSeq = random:uniform(16384) - 1,
     <<ClockSeqHigh:6, ClockSeqLow:8>> = <<ClockSeq:14>>,
-    #uuid_state{node_id = <<NodeByte1:8, NodeByte2:8,
-                            PidByte1:8, PidByte2:8,
-                            PidByte3:8, PidByte4:8>>,
+    NodeId = <<NodeByte1:8, NodeByte2:8,
+               PidByte1:8, PidByte2:8,
+               PidByte3:8, PidByte4:8>>,
+    #uuid_state{node_id = NodeId,
                 clock_seq = ClockSeq,
                 clock_seq_high = ClockSeqHigh,
                 clock_seq_low = ClockSeqLow,
-                timestamp_type = TimestampType}.
+                timestamp_type = TimestampType,
+                generator = generator(NodeId, ClockSeqHigh, ClockSeqLow)}.
 
 get_v1(#uuid_state{node_id = NodeId,
                    clock_seq_high = ClockSeqHigh,
                    clock_seq_low = ClockSeqLow,
-                   timestamp_type = TimestampType}) ->
+                   timestamp_type = TimestampType,
+                   generator = undefined}) ->
     {MegaSeconds, Seconds, MicroSeconds} = if
         TimestampType =:= erlang ->
             erlang:now();
@@ -165,7 +177,10 @@ get_v1(#uuid_state{node_id = NodeId,
       ClockSeqHigh:6,
       0:1, 1:1,            % reserved bits
       ClockSeqLow:8,
-      NodeId/binary>>.
+      NodeId/binary>>;
+
+get_v1(#uuid_state{generator = Generator}) ->
+    nif_get_v1(Generator).
 
 get_v1_time() ->
     get_v1_time(erlang).
@@ -382,7 +397,9 @@ string_to_uuid(N01, N02, N03, N04, N05, N06, N07, N08,
 % (i.e., in some situation that isn't handled by the Erlang VM, so
 %  possibly if an external distribution mechanism was used between
 %  Erlang VMs, not connected with distributed Erlang).
-increment(#uuid_state{clock_seq = ClockSeq} = State) ->
+increment(#uuid_state{node_id = NodeId,
+                      clock_seq = ClockSeq,
+                      generator = Generator} = State) ->
     NextClockSeq = ClockSeq + 1,
     NewClockSeq = if
         NextClockSeq == 16384 ->
@@ -391,14 +408,65 @@ increment(#uuid_state{clock_seq = ClockSeq} = State) ->
             NextClockSeq
     end,
     <<ClockSeqHigh:6, ClockSeqLow:8>> = <<NewClockSeq:14>>,
+    NewGenerator = if
+        Generator =:= undefined ->
+            undefined;
+        true ->
+            generator(NodeId, ClockSeqHigh, ClockSeqLow)
+    end,
     State#uuid_state{clock_seq = NewClockSeq,
                      clock_seq_high = ClockSeqHigh,
-                     clock_seq_low = ClockSeqLow}.
+                     clock_seq_low = ClockSeqLow,
+                     generator = NewGenerator}.
 
 %%%------------------------------------------------------------------------
 %%% Private functions
 %%%------------------------------------------------------------------------
 
+% the NIF holds the time of the last UUID and the UUID bytes that
+% follow the time (ClockSeqHigh:6, reserved bits, ClockSeqLow:8, NodeId)
+generator(NodeId, ClockSeqHigh, ClockSeqLow) ->
+    case nif_loaded() of
+        true ->
+            nif_new(<<ClockSeqHigh:6,
+                      0:1, 1:1,            % reserved bits
+                      ClockSeqLow:8,
+                      NodeId/binary>>);
+        false ->
+            undefined
+    end.
+
+load_nif() ->
+    PrivDir = case code:priv_dir(cloudi) of
+        {error, bad_name} ->
+            case code:which(?MODULE) of
+                Path when is_list(Path) ->
+                    filename:join([filename:dirname(Path), "..", "priv"]);
+                _ ->
+                    "priv"
+            end;
+        Dir ->
+            Dir
+    end,
+    % without the NIF, UUIDs are created in Erlang
+    case erlang:load_nif(filename:join(PrivDir, "uuid_nif"), []) of
+        ok ->
+            ok;
+        {error, _} ->
+            ok
+    end.
+
+% replaced by the NIF functions when uuid_nif is loaded
+
+nif_loaded() ->
+    false.
+
+nif_new(_ClockSeqAndNodeId) ->
+    erlang:nif_error(not_loaded).
+
+nif_get_v1(_Generator) ->
+    erlang:nif_error(not_loaded).
+
 -compile({inline, [{hex_to_int,1}]}).
 
 hex_to_int(C1, C2) ->